@@ -0,0 +1,136 @@
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <visualization_msgs/Marker.h>
+#include <visualization_msgs/MarkerArray.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <boost/shared_ptr.hpp>
+
+#include <find_moving_objects/MovingObject.h>
+#include <find_moving_objects/MovingObjectArray.h>
+#include <find_moving_objects/object_grid.h>
+#include <find_moving_objects/bank_message_ring.h>
+#include <find_moving_objects/bank_worker_pool.h>
+
+#ifdef NODELET
+#include <nodelet/nodelet.h>
+#endif
+
+namespace find_moving_objects
+{
+
+#ifdef NODELET
+class MovingObjectsConfidenceEnhancerNodelet : public nodelet::Nodelet
+#endif
+#ifdef NODE
+class MovingObjectsConfidenceEnhancerNode
+#endif
+{
+private:
+  /* DEFAULT PARAMETER VALUES */
+  #include "moving_objects_confidence_enhancer_default_parameter_values.h"
+
+  /* SUBSCRIBE INFO */
+  std::string subscribe_topic;
+  int subscribe_buffer_size;
+  int queue_size;
+  int nr_threads;
+
+  /* PARAMETERS */
+  bool verbose;
+  bool print_received_objects;
+  bool publish_objects;
+  bool publish_objects_closest_points_markers;
+  bool publish_objects_velocity_arrows;
+  bool velocity_arrows_use_full_gray_scale;
+  bool velocity_arrows_use_sensor_frame;
+  bool velocity_arrows_use_base_frame;
+  bool velocity_arrows_use_fixed_frame;
+  double threshold_min_confidence;
+  double threshold_max_delta_time_for_different_sources;
+  double threshold_max_delta_position;
+  double threshold_max_delta_velocity;
+  bool ignore_z_map_coordinate_for_position;
+  std::string node_name;
+
+  /* NODE HANDLES (ROS must be initialized when object is created) */
+  ros::NodeHandle nh;
+  ros::NodeHandle nh_priv;
+
+  /* PUBLISHERS AND SUBSCRIBER */
+  ros::Publisher pub_objects_closest_point_markers;
+  ros::Publisher pub_objects_velocity_arrows;
+  ros::Publisher pub_moaf;
+  ros::Subscriber sub;
+
+  /* MOVINGOBJECTARRAY MSG HANDLING */
+  // A msg of a sender and its objects indexed by position, not modified once it is in a slot or in the queue
+  typedef struct
+  {
+    find_moving_objects::MovingObjectArray::ConstPtr msg;
+    boost::shared_ptr<const ObjectGrid> grid;
+    unsigned int sender_index;
+  } SenderMessage;
+  // The slot of a sender, written by the callback and read by the worker thread using atomic operations
+  typedef struct
+  {
+    boost::shared_ptr<const SenderMessage> latest;
+  } SenderSlot;
+  typedef std::vector<boost::shared_ptr<SenderSlot> > SenderSlots;
+  std::unordered_map<std::string, unsigned int> sender_indices; // Only used by the callback
+  boost::shared_ptr<const SenderSlots> sender_slots;   // Replaced, atomically, when a sender is added
+  BankMessageRing queue; // Msgs waiting to be evaluated, pushed by the callback and popped by the worker thread
+  pthread_mutex_t mutex_moa;
+  pthread_cond_t cond_moa; // Signalled when a msg has been queued
+  bool available_moa;
+  bool stop_moa_handler;
+  unsigned long nr_dropped_messages; // Msgs that did not fit in the queue, only used by the callback
+  
+  /* EVALUATION OF A BATCH OF MSGS */
+  // The result of an evaluation, its buffer of candidate objects and the msgs published for the result
+  typedef struct
+  {
+    find_moving_objects::MovingObjectArray::Ptr moa; // NULL if there is nothing to publish
+    std::vector<unsigned int> candidates;
+    sensor_msgs::LaserScan::Ptr msg_objects_closest_point_markers;
+    visualization_msgs::Marker msg_objects_velocity_arrow;
+  } EvaluationWorkspace;
+  std::vector<boost::shared_ptr<const SenderMessage> *> batch;       // The queued msgs being evaluated
+  std::vector<boost::shared_ptr<const SenderMessage> > snapshot;     // The latest msg of each sender
+  std::vector<EvaluationWorkspace> workspaces;                       // One per msg of a batch
+  BankWorkerPool evaluation_pool;
+  unsigned int closest_point_markers_seq;
+  unsigned int velocity_arrows_seq;
+  void initWorkspace(EvaluationWorkspace * workspace);
+  static void evaluateTask(void * enhancer, const unsigned int index);
+  void evaluateMessage(const SenderMessage & message, EvaluationWorkspace * workspace);
+  void publishEvaluation(const SenderMessage & message, EvaluationWorkspace * workspace);
+
+  /* WORKER THREAD */
+  pthread_t moa_handler;
+  bool moa_handler_is_started;
+  static void * moaHandlerBody(void * enhancer);
+  void handleMovingObjectArrays();
+
+  /* CALLBACK */
+  void moaCallback(const find_moving_objects::MovingObjectArray::ConstPtr & msg);
+
+public:
+  /* CONSTRUCTOR & DESTRUCTOR */
+#ifdef NODELET
+  MovingObjectsConfidenceEnhancerNodelet();
+  ~MovingObjectsConfidenceEnhancerNodelet();
+
+  virtual void onInit();
+#endif
+#ifdef NODE
+  MovingObjectsConfidenceEnhancerNode();
+  ~MovingObjectsConfidenceEnhancerNode();
+
+  void onInit();
+#endif
+};
+
+} // namespace find_moving_objects
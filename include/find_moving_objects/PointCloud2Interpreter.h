@@ -9,6 +9,11 @@
 #endif
 
 #include <find_moving_objects/bank.h>
+#include <find_moving_objects/bank_pipeline.h>
+
+#ifdef PC2ARRAY
+#include <find_moving_objects/bank_worker_pool.h>
+#endif
 
 #ifdef NODELET
 #include <nodelet/nodelet.h>
@@ -52,6 +57,19 @@ private:
   std::vector<Bank *> banks;
   std::vector<BankArgument> bank_arguments;
   
+#ifdef PC2ARRAY
+  /* THREADS PROCESSING THE BANKS IN PARALLEL */
+  int nr_threads;
+  BankWorkerPool bank_worker_pool;
+#endif
+  
+  /* DETECTION AND PUBLISHING THREADS, USED IF pipeline_buffer_size > 0 */
+  int pipeline_buffer_size;
+  std::string pipeline_backpressure;
+  BankPipeline bank_pipeline;
+  unsigned long nr_dropped_messages_seen; // The number of msgs dropped by bank_pipeline, only used by the callback
+  BankPublisher bank_publisher;
+  
   /* TF LISTENER, BUFFER AND TARGET FRAME */
   tf2_ros::Buffer * tf_buffer;
   tf2_ros::TransformListener * tf_listener;
@@ -87,6 +105,15 @@ private:
   void pointCloud2Callback(const sensor_msgs::PointCloud2::ConstPtr & msg);
 #endif
   
+  /* MESSAGE PROCESSING, IN THE CALLBACK OR IN THE DETECTION THREAD */
+#ifdef PC2ARRAY
+  void processMessage(const find_moving_objects::PointCloud2Array * msg, const bool find_objects);
+#else
+  void processMessage(const sensor_msgs::PointCloud2 * msg, const bool find_objects);
+#endif
+  static void pipelineTask(void * interpreter, void * message, const bool is_newest);
+  void startPublisher(const int nr_banks);
+  
 public:
   /* CONSTRUCTOR & DESTRUCTOR */
 #ifdef NODELET
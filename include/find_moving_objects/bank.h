@@ -36,310 +36,28 @@
 
 #ifndef BANK_H
 #define BANK_H
+#include <boost/make_shared.hpp>
+#include <vector>
+#include <utility>
 #include <ros/ros.h>
 #include <tf2_ros/transform_listener.h>
+#include <tf2/LinearMath/Transform.h>
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <sensor_msgs/LaserScan.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <find_moving_objects/MovingObject.h>
 #include <find_moving_objects/MovingObjectArray.h>
+#include <find_moving_objects/MovingObjectCompactArray.h>
+#include <find_moving_objects/bank_argument.h>
+#include <find_moving_objects/bank_core.h>
+#include <find_moving_objects/bank_worker_pool.h>
+#include <find_moving_objects/bank_publisher.h>
 
 
 namespace find_moving_objects
 {
 
-/**
- * The member variables of this class define how the bank functions.
- * They are initialized to values that work for quite general cases but, 
- * they should be calibrated by the user for the best result.
- * An object of this class is taken as argument in the <code>init()</code> member function 
- * of the <code>Bank</code> class.
- */
-class BankArgument
-{
-public:
-  /** General (all apply to LaserScan) */
-  double ema_alpha; 
-  /**< The EMA weighting decrease coefficient---a value in <code>[0,1]</code>.
-   * Initialized to 1.0 (i.e. no EMA). */
-  
-  int nr_scans_in_bank; 
-  /**< The number of scan messages stored in the bank.
-   * Initialized to 11. */
-  
-  int points_per_scan;  
-  /**< The number of points per scan message. 
-   *   For <code>sensor_msgs::LaserScan</code>, <code>ranges.size()</code> is used and cannot be changed; for 
-   *   <code>sensor_msgs::PointCloud2</code>, a custom number, defining the resolution of the bank, should be specified.
-   *   Initialized to 360. */
-  
-  double angle_min; 
-  /**< The smallest angle (in radians) defined by the scan points in the bank. 
-   * For <code>sensor_msgs::LaserScan</code>, <code>angle_min</code> is used. 
-   * For <code>sensor_msgs::PointCloud2</code>, this should be specified 
-   * (if <code>angle_max-angle_min</code> is smaller than the view angle of the sensor, 
-   *  then the end points in the bank will be the smallest range of all points lying outside the view; 
-   *  if larger, then there will be "empty" ranges in the beginning and end of the bank). 
-   *  Initialized to -PI degrees*/
-  
-  double angle_max; 
-  /**< The largest angle (in radians) defined by the scan points in the bank. 
-   * For <code>sensor_msgs::LaserScan</code>, <code>angle_max</code> is used. 
-   * For <code>sensor_msgs::PointCloud2</code>, this should be specified 
-   * (if <code>angle_max-angle_min</code> is smaller than the view angle of the sensor, 
-   *  then the end points in the bank will be the smallest range of all points lying outside the view; 
-   *  if larger, then there will be "empty" ranges in the beginning and end of the bank).
-   * Initialized to PI. */
-  
-  bool sensor_frame_has_z_axis_forward;
-  /**< Set this to <code>true</code> in case the delivered data is given in a camera/optical frame with the Z-axis 
-   * pointing forward, instead of the X-axis (and the X-axis pointing right and the Y-axis pointing down).
-   * Note that setting this option to <code>true</code> causes the <code>ema</code> and 
-   * <code>objects_closest_point_markers</code> to be shown incorrectly since they are in fact 
-   * <code>sensor_msgs::LaserScan</code> messages.
-   * The <code>velocity_arrows</code> and <code>delta_position_lines</code> are still shown correctly, though.
-   * Initialized to <code>false</code>. */ 
-  
-  double object_threshold_edge_max_delta_range; 
-  /**< The maximum difference in range (meters) between two consecutive scan points belonging to the same object. 
-   * Initialized to 0.15. */
-  
-  int object_threshold_min_nr_points; 
-  /**< The minimum number of consecutive scan points defining an object.
-   * Initialized to 5. */
-  
-  double object_threshold_max_distance; 
-  /**< The maximum distance in meters from the sensor to the object, in order to report it.
-   * Initialized to 6.5. */
-  
-  double object_threshold_min_speed; 
-  /**< The minimum speed in meters per second an object must have, in order to report it.
-   * Initialized to 0.03. */
-  
-  int object_threshold_max_delta_width_in_points; 
-  /**< The maximum difference in width (in scan points) an object is allowed to have, 
-   * between the oldest and newest scans in the bank, in order to report it.
-   * Initialized to 5. */
-  
-  double object_threshold_min_confidence;
-  /**< The minimum confidence an object must have, in order to report it.
-   * Initialized to 0.67. */
-  
-  double object_threshold_bank_tracking_max_delta_distance; 
-  /**< Maximum distance an object is allowed to move in meters between two consecutive scans
-   * to continue tracking it through the bank.
-   * Initialized to 0.2. */
-  
-  double base_confidence; 
-  /**< The base confidence of the system/sensor. 
-   * Initialized to 0.3. */
-  
-  bool publish_objects; 
-  /**< Whether to publish <code>find_moving_objects::MovingObjectArray</code> messages, 
-   * containing the found objects.
-   * Initialized to <code>true</code>. */
-  
-  bool publish_ema; 
-  /**< Whether to publish <code>sensor_msgs::LaserScan</code> messages showing (using intensities) which scan points 
-   * define objects. 
-   * Initialized to <code>false</code>. */
-  
-  bool publish_objects_closest_point_markers; 
-  /**< Whether to publish the point on each found object closest to the sensor, 
-   * using <code>sensor_msgs::LaserScan</code> messages. 
-   * Initialized to <code>false</code>. */
-  
-  bool publish_objects_velocity_arrows; 
-  /**< Whether to publish arrows, using <code>visualization_msgs::MarkerArray</code> messages, 
-   * showing the position and velocity of each found object.
-   * Initialized to <code>false</code>. */
-  
-  bool publish_objects_delta_position_lines; 
-  /**< Whether to publish lines, using <code>visualization_msgs::MarkerArray</code> messages, 
-   * showing the change in position between the oldest and newest scans in the bank for each found object.
-   * Initialized to <code>false</code>.  */
-  
-  bool publish_objects_width_lines; 
-  /**< Whether to publish lines, using <code>visualization_msgs::MarkerArray</code> messages, 
-   * showing the width for each found object.
-   * Initialized to <code>false</code>.  */
-  
-  bool velocity_arrows_use_full_gray_scale; 
-  /**< Whether to color the arrows using the full gray scale 
-   * ([0,1];  0=low,  1=high confidence), 
-   * or to use the grayness [<code>object_threshold_min_confidence</code>,1]. 
-   * Initialized to <code>false</code>. */
-  
-  bool velocity_arrows_use_sensor_frame; 
-  /**< Show arrows in sensor frame 
-   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
-   * Initialized to <code>false</code>. */
-  
-  bool velocity_arrows_use_base_frame; 
-  /**< Show arrows in base frame 
-   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
-   * Initialized to <code>false</code>. */
-  
-  bool velocity_arrows_use_fixed_frame; 
-  /**< Show arrows in fixed frame 
-   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
-   * Initialized to <code>false</code>. */
-  
-  std::string velocity_arrow_ns; 
-  /**< Namespace of the velocity arrows. 
-   * Initialized to <code>"velocity_arrow_ns"</code>. */
-  
-  std::string delta_position_line_ns; 
-  /**< Namespace of the delta position lines. 
-   * Initialized to <code>"delta_position_line_ns"</code>. */
-  
-  std::string width_line_ns; 
-  /**< Namespace of the width lines. 
-   * Initialized to <code>"width_line_ns"</code>. */
-  
-  std::string topic_objects; 
-  /**< The topic on which to publish <code>find_moving_objects::MovingObjectArray</code> messages. 
-   * Initialized to <code>"/moving_objects_arrays"</code>. */
-  
-  std::string topic_ema;
-  /**< The topic on which to publish the messages showing which scan points define objects.
-   * Initialized to <code>"/ema;"</code>. */
-  
-  std::string topic_objects_closest_point_markers; 
-  /**< The topic on which to publish the messages showing the point on each found object closest to the sensor.
-   * Initialized to <code>"/objects_closest_point_markers"</code>. */
-  
-  std::string topic_objects_velocity_arrows; 
-  /**< The topic on which to publish the messages showing the position and velocity of each found object using arrows.
-   * Initialized to <code>"/objects_velocity_arrows"</code>. */
-  
-  std::string topic_objects_delta_position_lines;
-  /**< The topic on which to publish the messages showing the delta position of each found object using lines.
-   * Initialized to <code>"/objects_delta_position_lines"</code>. */
-  
-  std::string topic_objects_width_lines;
-  /**< The topic on which to publish the messages showing the width of each found object using lines.
-   * Initialized to <code>"/objects_width_lines"</code>. */
-  
-  int publish_buffer_size; 
-  /**< The size of each publish buffer. 
-   * Initialized to 10. */
-  
-  std::string map_frame; 
-  /**< The name of the map (i.e. the globally fixed) frame.
-   * Initialized to <code>"map"</code>. */
-  
-  std::string fixed_frame; 
-  /**< The name of the frame fixed for the robot but movable in the map frame.
-   * Initialized to <code>"odom"</code>. */
-  
-  std::string base_frame;
-  /**< The name of the frame fixed on the robot.
-   * Initialized to <code>"base_link"</code>. */
-  
-  
-//   // TODO: dox
-//   float merge_threshold_max_angle_gap;
-//   float merge_threshold_max_end_points_distance_delta;
-//   float merge_threshold_max_velocity_direction_delta;
-//   float merge_threshold_max_speed_delta;
-  
-  
-  /*
-   * PointCloud2 message-specific (none of these apply to LaserScan) 
-   */
-  std::string PC2_message_x_coordinate_field_name; 
-  /**< The name of the <code>sensor_msgs::PointField</code> specifying the X-coordinate.
-   * Initialized to <code>"x"</code>. */
-  
-  std::string PC2_message_y_coordinate_field_name;
-  /**< The name of the <code>sensor_msgs::PointField</code> specifying the Y-coordinate.
-   * Initialized to <code>"y"</code>. */
-  
-  std::string PC2_message_z_coordinate_field_name;
-  /**< The name of the <code>sensor_msgs::PointField</code> specifying the Z-coordinate.
-   * Initialized to <code>"z"</code>. */
-  
-  double PC2_voxel_leaf_size; 
-  /**< Approximate distance between two points (in meters) in the cloud. 
-   * Initialized to 0.02 but, should most likely be calibrated. */
-  
-  double PC2_threshold_z_min; 
-  /**< Do not account points with a Z-coordinate smaller than this. 
-   * If <code>sensor_frame_has_z_axis_forward</code> is set, then the negated Y-coordinate is considered instead of the
-   * Z-coordinate of the point, since the Y-axis is pointing down in that case.
-   * Initialized to 0.1. */
-  
-  double PC2_threshold_z_max; 
-  /**< Do not account points with a Z-coordinate larger than this. It is assumed that the Z-axis in the sensor frame is 
-   * pointing up.
-   * If <code>sensor_frame_has_z_axis_forward</code> is set, then the negated Y-coordinate is considered instead of the
-   * Z-coordinate of the point, since the Y-axis is pointing down in that case.
-   * Initialized to 1.0. */
-  
-  std::string node_name_suffix;
-  /**< Add a suffix to the reported node name in the <code>origin_node_name</code> field of the  
-   * <code>MovingObjectArray</code> messages.
-   * Initialized to the empty string <code>""</code>.
-   */
-  
-  /**
-   * Initializes the member variables to the stated values.
-   */
-  BankArgument();
-  
-  /**
-   * @brief Allow Bank to access private members of this class.
-   * @relates Bank
-   */
-  friend class Bank;
-  
-private:
-  friend std::ostream& operator<<(std::ostream& os, const BankArgument& ba);
-  std::string sensor_frame; 
-  /**< The name of the sensor frame. Set to the frame of the sensor. */
-  
-  float angle_increment; 
-  /**< The angular difference between two consecutive scan points. 
-   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
-   * For <code>sensor_msgs::PointCloud2</code>, this is calculated based on
-   * <code>angle_max</code>, <code>angle_min</code> and <code>points_per_scan</code>. */
-  
-  float time_increment; 
-  /**< The time difference between two consecutive scan points. 
-   * For <code>sensor_msgs::LaserScan</code>, 
-   * the corresponding value of the first message. 
-   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0. */
-  
-  float scan_time; 
-  /**< The time needed for each complete scan. 
-   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
-   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0. */
-  
-  float range_min;
-  /**< The minimum range the sensor can measure. 
-   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
-   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0.01. */
-  
-  float range_max; 
-  /**< The maximum range the sensor can measure. 
-   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
-   * For <code>sensor_msgs::PointCloud2</code>, this is set to <code>object_threshold_max_distance</code>. */
-  
-  bool sensor_is_360_degrees;
-  /**< Whether the sensor is scanning 360 degrees.
-   * This is determined based on the angle limits of the bank */
-  
-  void check(); 
-  /**< Validate the specified values. For numeric values, this could include a range check. */
-  
-  void check_PC2();
-  /**< Validate the specified <code>sensor_msgs::PointCloud2</code>-specific values. 
-   * For numeric values, this could include a range check. */
-};
-
-
 /**
  * The bank contains a number of scan messages 
  * and is able to find the position and velocity of moving objects based on these scans. 
@@ -360,23 +78,24 @@ private:
   BankArgument bank_argument;
   
   /* BANK */
-  float ** bank_ranges_ema;
-  double * bank_stamp;
+  BankCore core; // The ROS-independent storage, EMA and tracking of scans
+  std::vector<TrackedObject> tracked_objects; // Objects tracked by core, reused between calls
   unsigned int bank_ranges_bytes;
   bool bank_is_initialized;
-  bool bank_is_filled;
   double resolution;
   
-  /* INDICES FOR THE BANK */
-  int bank_index_newest;
-  int bank_index_put; // nr_scans_in_bank is/should be greater than 1!
-  
   /* HANDLE TO THIS NODE */
   ros::NodeHandle * node;
   
   /* TRANSFORM BUFFER PTR */
   tf2_ros::Buffer * tf_buffer;
   
+  /* TRANSFORM CACHE - transforms from sensor_frame into map, fixed and base frames, per bank slot */
+  std::vector<tf2::Transform> bank_transforms; // 3 per slot: map, fixed and base frames
+  std::vector<double> bank_transforms_stamp;   // The stamp the transforms of each slot were looked up for
+  std::vector<unsigned int> bank_nr_transforms; // The number of transforms of each slot that have been looked up
+  unsigned int lookupTransforms(const int slot, const double stamp);
+  
   /* PUBLISHERS */
   ros::Publisher pub_ema;
   ros::Publisher pub_objects_closest_point_markers;
@@ -384,19 +103,125 @@ private:
   ros::Publisher pub_objects_delta_position_lines;
   ros::Publisher pub_objects_width_lines;
   ros::Publisher pub_objects;
+  ros::Publisher pub_objects_compact;
+  BankPublisher * bank_publisher; // If not NULL, then the messages are published through it
+  
+  // The messages are published as shared pointers and must not be modified afterwards, since nodelets in the same 
+  // manager receive the very same message objects
+  template<typename M>
+  void publish(const ros::Publisher & publisher, const boost::shared_ptr<M> & msg)
+  {
+    const boost::shared_ptr<const M> const_msg(msg);
+    if (bank_publisher == NULL)
+    {
+      publisher.publish(const_msg);
+    }
+    else
+    {
+      bank_publisher->publish<M>(publisher, const_msg);
+    }
+  }
+  
+  /* MESSAGE BUFFERS */
+  // The published messages are reused once they are no longer held by a subscriber or by the publishing thread. 
+  // Each message is one of a pool, which only grows while all of its messages are in use, so that no message is 
+  // allocated per report once the pool has reached the number of messages in flight.
+  unsigned long nr_message_allocations; // Messages, and elements of messages, allocated while reporting
+  
+  // Make sure that msg can be modified, by letting it point to a message of pool that no one else holds, 
+  // msg itself if possible, otherwise a copy of msg that is added to the pool; msg must be a message of pool.
+  // Returns true if msg was kept, false if it points to another message whose contents are those of an earlier report.
+  template<typename M>
+  bool reuseMessage(std::vector<boost::shared_ptr<M> > & pool, boost::shared_ptr<M> & msg)
+  {
+    if (msg.use_count() == 2) // Only held by msg and the pool
+    {
+      return true;
+    }
+    const unsigned int pool_size = pool.size();
+    for (unsigned int i=0; i<pool_size; ++i)
+    {
+      if (pool[i].unique())
+      {
+        msg = pool[i];
+        return false;
+      }
+    }
+    msg = boost::make_shared<M>(*msg);
+    countAllocation(pool.capacity() == pool.size());
+    pool.push_back(msg);
+    nr_message_allocations++;
+    return false;
+  }
+  
+  // Resize elements, a vector of messages, without destroying the elements it shrinks by; they are kept in spare and 
+  // moved back when it grows, so that their strings and vectors keep their memory. New elements are copies of prototype.
+  template<typename T>
+  void resizeElements(std::vector<T> & elements, std::vector<T> & spare, const unsigned int size, const T & prototype)
+  {
+    while (size < elements.size())
+    {
+      countAllocation(spare.capacity() == spare.size());
+      spare.push_back(std::move(elements.back()));
+      elements.pop_back();
+    }
+    while (elements.size() < size)
+    {
+      countAllocation(elements.capacity() == elements.size());
+      if (spare.empty())
+      {
+        elements.push_back(prototype);
+        nr_message_allocations++;
+      }
+      else
+      {
+        elements.push_back(std::move(spare.back()));
+        spare.pop_back();
+      }
+    }
+  }
+  
+  // Count the allocation of a vector growing past its capacity
+  inline void countAllocation(const bool vector_is_full)
+  {
+    if (vector_is_full)
+    {
+      nr_message_allocations++;
+    }
+  }
   
   /* SEQUENCE NR */
   unsigned int moa_seq;
 
+  /* The moving objects message, its objects are copies of the prototype object until they are filled in */
+  MovingObjectArray::Ptr msg_objects;
+  std::vector<MovingObjectArray::Ptr> msg_objects_pool;
+  MovingObject object_prototype;
+  std::vector<MovingObject> spare_objects;
+  MovingObjectArray moa_old_positions; // The old positions of the objects of msg_objects, never published
+  
+  /* The compact moving objects message, the objects of msg_objects in one frame */
+  MovingObjectCompactArray::Ptr msg_objects_compact;
+  std::vector<MovingObjectCompactArray::Ptr> msg_objects_compact_pool;
+  void compactObject(const MovingObject & mo, MovingObjectCompact * compact_mo);
+  
   /* Additional messages to publish (not the actual moving objects message!) */
-  sensor_msgs::LaserScan msg_ema; // EMA-adapted LaserScan with marked moving objects
-  sensor_msgs::LaserScan msg_objects_closest_point_markers; // For visualizing objects as squares
-  visualization_msgs::MarkerArray msg_objects_velocity_arrows; // For visualizing velocity using arrows...
-  visualization_msgs::Marker msg_objects_velocity_arrow;       // ... one per object
-  visualization_msgs::MarkerArray msg_objects_delta_position_lines; // For visualizing delta positions using lines...
-  visualization_msgs::Marker msg_objects_delta_position_line;       // ... one per object
-  visualization_msgs::MarkerArray msg_objects_width_lines; // For visualizing width using lines...
-  visualization_msgs::Marker msg_objects_width_line;       // ... one per object
+  sensor_msgs::LaserScan::Ptr msg_ema; // EMA-adapted LaserScan with marked moving objects
+  sensor_msgs::LaserScan::Ptr msg_objects_closest_point_markers; // For visualizing objects as squares
+  visualization_msgs::MarkerArray::Ptr msg_objects_velocity_arrows; // For visualizing velocity using arrows...
+  visualization_msgs::Marker msg_objects_velocity_arrow;            // ... one per object, the prototype
+  visualization_msgs::MarkerArray::Ptr msg_objects_delta_position_lines; // For visualizing delta positions using lines...
+  visualization_msgs::Marker msg_objects_delta_position_line;            // ... one per object, the prototype
+  visualization_msgs::MarkerArray::Ptr msg_objects_width_lines; // For visualizing width using lines...
+  visualization_msgs::Marker msg_objects_width_line;            // ... one per object, the prototype
+  std::vector<sensor_msgs::LaserScan::Ptr> msg_ema_pool;
+  std::vector<sensor_msgs::LaserScan::Ptr> msg_objects_closest_point_markers_pool;
+  std::vector<visualization_msgs::MarkerArray::Ptr> msg_objects_velocity_arrows_pool;
+  std::vector<visualization_msgs::MarkerArray::Ptr> msg_objects_delta_position_lines_pool;
+  std::vector<visualization_msgs::MarkerArray::Ptr> msg_objects_width_lines_pool;
+  std::vector<visualization_msgs::Marker> spare_velocity_arrows; // Markers of the arrays, kept while not needed
+  std::vector<visualization_msgs::Marker> spare_delta_position_lines;
+  std::vector<visualization_msgs::Marker> spare_width_lines;
   
   /* Basic functionality used by the functions below*/
   void initBank(BankArgument bank_argument);
@@ -406,28 +231,7 @@ private:
   virtual long addFirstMessage(const sensor_msgs::LaserScan *);
   virtual long addFirstMessage(const sensor_msgs::PointCloud2 *, 
                                const bool discard_message_if_no_points_added);
-  inline void initIndex();
-  inline void advanceIndex();
 //   void mergeFoundObjects(MovingObjectArray * moa);
-  
-  /* 
-   * Recursive tracking of an object through history to get the indices of its middle, 
-   * left and right points in the oldest scans, along with the sum of all ranges etc.
-   */
-  void getOldIndices(const float range_min,
-                     const float range_max,
-                     const unsigned int object_width_in_points,
-                     const int          current_level,
-                     const unsigned int levels_searched,
-                     const unsigned int index_mean,
-                     const unsigned int consecutive_failures_to_find_object,
-                     const unsigned int threshold_consecutive_failures_to_find_object,
-                     int * index_min_old,
-                     int * index_mean_old,
-                     int * index_max_old,
-                     float * range_sum_old,
-                     float * range_at_min_index_old,
-                     float * range_at_max_index_old);
     
   /* PointCloud2 specifics */
   typedef uint8_t byte_t;
@@ -441,16 +245,54 @@ private:
   int getOffsetsAndBytes(BankArgument bank_argument, const sensor_msgs::PointCloud2 * msg);
   bool machine_is_little_endian; // set in constructor
   void reverseBytes(byte_t * bytes, unsigned int nr_bytes);
-  void readPoint(const byte_t * start_of_point,
-                 const bool must_reverse_bytes,
-                 double * x,
-                 double * y,
-                 double * z);
-  void resetPutPoints();
-  unsigned int putPoints(const sensor_msgs::PointCloud2::ConstPtr msg);
-  unsigned int putPoints(const sensor_msgs::PointCloud2 * msg);
-  void emaPutMessage();
-  std::string getStringPutPoints();
+  PointDecoderKernel PC2_decode_points;          // Selected from the layout by getOffsetsAndBytes
+  PointDecoderKernel PC2_decode_points_reversed; // Ditto, for messages in the reverse byte order
+  std::vector<double> PC2_bin_slopes;  // The slopes (tangents) of the boundaries between bank indices
+  std::vector<unsigned int> PC2_bin_slope_lut; // Start values for countBinBoundaries, for slopes of uniform width
+  double PC2_bin_slope_lut_min;
+  double PC2_bin_slope_lut_inverted_cell_width;
+  std::vector<int> PC2_column_index_min; // The bank indices covered by each column of an organized cloud
+  std::vector<int> PC2_column_index_max;
+  std::vector<bool> PC2_column_is_binned; // Whether the bank indices of each column have been found
+  unsigned int PC2_nr_columns_not_binned;
+  std::vector<double> PC2_column_slope_min; // The slopes of the edges of the points in each column, per message
+  std::vector<double> PC2_column_slope_max;
+  std::vector<double> PC2_column_squared_ranges; // The smallest squared range in each column, per message
+  // The points of a message are binned in slices of its columns, one slice per thread
+  struct PointBinningWorkspace
+  {
+    std::vector<double> points_x; // The decoded points of a row of the slice, reused between messages
+    std::vector<double> points_y;
+    std::vector<double> points_z;
+    std::vector<double> squared_ranges; // The smallest squared range in each bank index, per message
+    unsigned int added_points;
+  };
+  struct PointBinningTask
+  {
+    Bank * bank;
+    const sensor_msgs::PointCloud2 * msg;
+    PointDecoderKernel decode_points;
+    bool by_column;
+  };
+  std::vector<PointBinningWorkspace> PC2_binning_workspaces; // One per slice, the bins of all are merged into [0]
+  BankWorkerPool PC2_binning_pool;
+  void initPointBinning();
+  unsigned int countBinBoundaries(const double slope) const;
+  static void binPointsTask(void * task, const unsigned int slice);
+  unsigned int binPoints(const sensor_msgs::PointCloud2 * msg, 
+                         const PointDecoderKernel decode_points,
+                         const unsigned int column_begin,
+                         const unsigned int column_end,
+                         PointBinningWorkspace & workspace);
+  void startBinningByColumn(const unsigned int columns);
+  unsigned int binPointsByColumn(const sensor_msgs::PointCloud2 * msg, 
+                                 const PointDecoderKernel decode_points,
+                                 const unsigned int column_begin,
+                                 const unsigned int column_end,
+                                 PointBinningWorkspace & workspace);
+  void finishBinningByColumn(double * squared_ranges);
+  unsigned int putPoints(const sensor_msgs::PointCloud2::ConstPtr msg, float * bank_put);
+  unsigned int putPoints(const sensor_msgs::PointCloud2 * msg, float * bank_put);
   
   
   
@@ -467,7 +309,7 @@ public:
   Bank(tf2_ros::Buffer * buffer);
   
   /**
-   * De-allocates reserved memory for the bank.
+   * Destroys the bank; the memory reserved for the scans is de-allocated by its <code>BankCore</code>.
    */
   ~Bank();
   
@@ -563,6 +405,29 @@ public:
    */
   void findAndReportMovingObjects();
   
+  /**
+   * Hand the messages of this bank to a publisher stage, which publishes them in a thread of its own, 
+   * instead of publishing them in <code>findAndReportMovingObjects()</code>.
+   * 
+   * @param publisher The started publisher stage, or <code>NULL</code> to publish directly again.
+   */
+  void setPublisher(BankPublisher * publisher) { bank_publisher = publisher; }
+  
+  /**
+   * @param bank_argument The argument of a bank.
+   * @return The number of topics that the bank publishes on, i.e. the most messages that it publishes per report.
+   */
+  static unsigned int getNrPublishedTopics(const BankArgument & bank_argument);
+  
+  /**
+   * Messages are reused between reports, but a message that is still held by a subscriber or a publisher stage 
+   * cannot be reused, and a report with more objects than any earlier one needs room for them.
+   * 
+   * @return The number of messages, and elements of messages, that have been allocated while reporting; 
+   *         it stays the same from one report to the next once the bank has reached its steady state.
+   */
+  unsigned long getNrMessageAllocations() const { return nr_message_allocations; }
+  
   /**
    * Confidence calculation.
    * 
@@ -0,0 +1,413 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_ARGUMENT_H
+#define BANK_ARGUMENT_H
+#include <string>
+#include <ostream>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * The member variables of this class define how the bank functions.
+ * They are initialized to values that work for quite general cases but, 
+ * they should be calibrated by the user for the best result.
+ * An object of this class is taken as argument in the <code>init()</code> member function 
+ * of the <code>Bank</code> class.
+ */
+class BankArgument
+{
+public:
+  /** General (all apply to LaserScan) */
+  double ema_alpha; 
+  /**< The EMA weighting decrease coefficient---a value in <code>[0,1]</code>.
+   * Initialized to 1.0 (i.e. no EMA). */
+  
+  int nr_scans_in_bank; 
+  /**< The number of scan messages stored in the bank.
+   * Initialized to 11. */
+  
+  double adapt_nr_scans_in_bank_time; 
+  /**< If positive, then the time (in seconds) that the bank should cover. The rate of the scans is then estimated 
+   * from the time stamps of the scans in the bank each time a scan is added, and when it differs by more than 10% 
+   * from the rate that the number of scans was last adapted to, the bank is resized to cover this time at the new 
+   * rate, keeping the newest scans. 
+   * Initialized to 0.0 (i.e. the number of scans in the bank is fixed). */
+  
+  int max_nr_scans_in_bank; 
+  /**< The largest number of scans that the bank is resized to when <code>adapt_nr_scans_in_bank_time</code> is 
+   * positive. 
+   * Initialized to 100. */
+  
+  int points_per_scan;  
+  /**< The number of points per scan message. 
+   *   For <code>sensor_msgs::LaserScan</code>, <code>ranges.size()</code> is used and cannot be changed; for 
+   *   <code>sensor_msgs::PointCloud2</code>, a custom number, defining the resolution of the bank, should be specified.
+   *   Initialized to 360. */
+  
+  double angle_min; 
+  /**< The smallest angle (in radians) defined by the scan points in the bank. 
+   * For <code>sensor_msgs::LaserScan</code>, <code>angle_min</code> is used. 
+   * For <code>sensor_msgs::PointCloud2</code>, this should be specified 
+   * (if <code>angle_max-angle_min</code> is smaller than the view angle of the sensor, 
+   *  then the end points in the bank will be the smallest range of all points lying outside the view; 
+   *  if larger, then there will be "empty" ranges in the beginning and end of the bank). 
+   *  Initialized to -PI degrees*/
+  
+  double angle_max; 
+  /**< The largest angle (in radians) defined by the scan points in the bank. 
+   * For <code>sensor_msgs::LaserScan</code>, <code>angle_max</code> is used. 
+   * For <code>sensor_msgs::PointCloud2</code>, this should be specified 
+   * (if <code>angle_max-angle_min</code> is smaller than the view angle of the sensor, 
+   *  then the end points in the bank will be the smallest range of all points lying outside the view; 
+   *  if larger, then there will be "empty" ranges in the beginning and end of the bank).
+   * Initialized to PI. */
+  
+  bool sensor_frame_has_z_axis_forward;
+  /**< Set this to <code>true</code> in case the delivered data is given in a camera/optical frame with the Z-axis 
+   * pointing forward, instead of the X-axis (and the X-axis pointing right and the Y-axis pointing down).
+   * Note that setting this option to <code>true</code> causes the <code>ema</code> and 
+   * <code>objects_closest_point_markers</code> to be shown incorrectly since they are in fact 
+   * <code>sensor_msgs::LaserScan</code> messages.
+   * The <code>velocity_arrows</code> and <code>delta_position_lines</code> are still shown correctly, though.
+   * Initialized to <code>false</code>. */ 
+  
+  double object_threshold_edge_max_delta_range; 
+  /**< The maximum difference in range (meters) between two consecutive scan points belonging to the same object. 
+   * Initialized to 0.15. */
+  
+  int object_threshold_min_nr_points; 
+  /**< The minimum number of consecutive scan points defining an object.
+   * Initialized to 5. */
+  
+  double object_threshold_max_distance; 
+  /**< The maximum distance in meters from the sensor to the object, in order to report it.
+   * Initialized to 6.5. */
+  
+  double object_threshold_min_speed; 
+  /**< The minimum speed in meters per second an object must have, in order to report it.
+   * Initialized to 0.03. */
+  
+  int object_threshold_max_delta_width_in_points; 
+  /**< The maximum difference in width (in scan points) an object is allowed to have, 
+   * between the oldest and newest scans in the bank, in order to report it.
+   * Initialized to 5. */
+  
+  double object_threshold_min_confidence;
+  /**< The minimum confidence an object must have, in order to report it.
+   * Initialized to 0.67. */
+  
+  double object_threshold_bank_tracking_max_delta_distance; 
+  /**< Maximum distance an object is allowed to move in meters between two consecutive scans
+   * to continue tracking it through the bank.
+   * Initialized to 0.2. */
+  
+  double base_confidence; 
+  /**< The base confidence of the system/sensor. 
+   * Initialized to 0.3. */
+  
+  bool publish_objects; 
+  /**< Whether to publish <code>find_moving_objects::MovingObjectArray</code> messages, 
+   * containing the found objects.
+   * Initialized to <code>true</code>. */
+  
+  bool publish_ema; 
+  /**< Whether to publish <code>sensor_msgs::LaserScan</code> messages showing (using intensities) which scan points 
+   * define objects. 
+   * Initialized to <code>false</code>. */
+  
+  bool publish_objects_compact; 
+  /**< Whether to also publish <code>find_moving_objects::MovingObjectCompactArray</code> messages, 
+   * containing the found objects in single precision and in one frame only, see <code>objects_compact_use_*</code>.
+   * Initialized to <code>false</code>. */
+  
+  bool objects_compact_use_sensor_frame; 
+  /**< Give the compact objects in sensor frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  bool objects_compact_use_base_frame; 
+  /**< Give the compact objects in base frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  bool objects_compact_use_fixed_frame; 
+  /**< Give the compact objects in fixed frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  bool publish_objects_closest_point_markers; 
+  /**< Whether to publish the point on each found object closest to the sensor, 
+   * using <code>sensor_msgs::LaserScan</code> messages. 
+   * Initialized to <code>false</code>. */
+  
+  bool publish_objects_velocity_arrows; 
+  /**< Whether to publish arrows, using <code>visualization_msgs::MarkerArray</code> messages, 
+   * showing the position and velocity of each found object.
+   * Initialized to <code>false</code>. */
+  
+  bool publish_objects_delta_position_lines; 
+  /**< Whether to publish lines, using <code>visualization_msgs::MarkerArray</code> messages, 
+   * showing the change in position between the oldest and newest scans in the bank for each found object.
+   * Initialized to <code>false</code>.  */
+  
+  bool publish_objects_width_lines; 
+  /**< Whether to publish lines, using <code>visualization_msgs::MarkerArray</code> messages, 
+   * showing the width for each found object.
+   * Initialized to <code>false</code>.  */
+  
+  bool velocity_arrows_use_full_gray_scale; 
+  /**< Whether to color the arrows using the full gray scale 
+   * ([0,1];  0=low,  1=high confidence), 
+   * or to use the grayness [<code>object_threshold_min_confidence</code>,1]. 
+   * Initialized to <code>false</code>. */
+  
+  bool velocity_arrows_use_sensor_frame; 
+  /**< Show arrows in sensor frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  bool velocity_arrows_use_base_frame; 
+  /**< Show arrows in base frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  bool velocity_arrows_use_fixed_frame; 
+  /**< Show arrows in fixed frame 
+   * (if several frame options are true, then sensor, base, fixed, map (default) is the precedence order). 
+   * Initialized to <code>false</code>. */
+  
+  std::string velocity_arrow_ns; 
+  /**< Namespace of the velocity arrows. 
+   * Initialized to <code>"velocity_arrow_ns"</code>. */
+  
+  std::string delta_position_line_ns; 
+  /**< Namespace of the delta position lines. 
+   * Initialized to <code>"delta_position_line_ns"</code>. */
+  
+  std::string width_line_ns; 
+  /**< Namespace of the width lines. 
+   * Initialized to <code>"width_line_ns"</code>. */
+  
+  std::string topic_objects; 
+  /**< The topic on which to publish <code>find_moving_objects::MovingObjectArray</code> messages. 
+   * Initialized to <code>"/moving_objects_arrays"</code>. */
+  
+  std::string topic_objects_compact; 
+  /**< The topic on which to publish <code>find_moving_objects::MovingObjectCompactArray</code> messages. 
+   * Initialized to <code>"/moving_objects_compact_arrays"</code>. */
+  
+  std::string topic_ema;
+  /**< The topic on which to publish the messages showing which scan points define objects.
+   * Initialized to <code>"/ema;"</code>. */
+  
+  std::string topic_objects_closest_point_markers; 
+  /**< The topic on which to publish the messages showing the point on each found object closest to the sensor.
+   * Initialized to <code>"/objects_closest_point_markers"</code>. */
+  
+  std::string topic_objects_velocity_arrows; 
+  /**< The topic on which to publish the messages showing the position and velocity of each found object using arrows.
+   * Initialized to <code>"/objects_velocity_arrows"</code>. */
+  
+  std::string topic_objects_delta_position_lines;
+  /**< The topic on which to publish the messages showing the delta position of each found object using lines.
+   * Initialized to <code>"/objects_delta_position_lines"</code>. */
+  
+  std::string topic_objects_width_lines;
+  /**< The topic on which to publish the messages showing the width of each found object using lines.
+   * Initialized to <code>"/objects_width_lines"</code>. */
+  
+  int publish_buffer_size; 
+  /**< The size of each publish buffer. 
+   * Initialized to 10. */
+  
+  std::string map_frame; 
+  /**< The name of the map (i.e. the globally fixed) frame.
+   * Initialized to <code>"map"</code>. */
+  
+  std::string fixed_frame; 
+  /**< The name of the frame fixed for the robot but movable in the map frame.
+   * Initialized to <code>"odom"</code>. */
+  
+  std::string base_frame;
+  /**< The name of the frame fixed on the robot.
+   * Initialized to <code>"base_link"</code>. */
+  
+  bool compute_in_map_frame;
+  /**< Whether to give the position, velocity, speed, normalized velocity and closest point of each found object in 
+   * map frame. If not, then no transforms into map frame are looked up and these fields are left zeroed. 
+   * The objects are always given in sensor frame, in which they are found. 
+   * Must be set if the objects, or their compact version or velocity arrows, are to be used in map frame, e.g. by 
+   * the confidence enhancer. 
+   * Initialized to <code>true</code>. */
+  
+  bool compute_in_fixed_frame;
+  /**< Whether to give the position, velocity, speed, normalized velocity and closest point of each found object in 
+   * fixed frame. If not, then no transforms into fixed frame are looked up and these fields are left zeroed. 
+   * Initialized to <code>true</code>. */
+  
+  bool compute_in_base_frame;
+  /**< Whether to give the position, velocity, speed, normalized velocity and closest point of each found object in 
+   * base frame. If not, then no transforms into base frame are looked up and these fields are left zeroed. 
+   * Initialized to <code>true</code>. */
+  
+  
+//   // TODO: dox
+//   float merge_threshold_max_angle_gap;
+//   float merge_threshold_max_end_points_distance_delta;
+//   float merge_threshold_max_velocity_direction_delta;
+//   float merge_threshold_max_speed_delta;
+  
+  
+  /*
+   * PointCloud2 message-specific (none of these apply to LaserScan) 
+   */
+  std::string PC2_message_x_coordinate_field_name; 
+  /**< The name of the <code>sensor_msgs::PointField</code> specifying the X-coordinate.
+   * Initialized to <code>"x"</code>. */
+  
+  std::string PC2_message_y_coordinate_field_name;
+  /**< The name of the <code>sensor_msgs::PointField</code> specifying the Y-coordinate.
+   * Initialized to <code>"y"</code>. */
+  
+  std::string PC2_message_z_coordinate_field_name;
+  /**< The name of the <code>sensor_msgs::PointField</code> specifying the Z-coordinate.
+   * Initialized to <code>"z"</code>. */
+  
+  double PC2_voxel_leaf_size; 
+  /**< Approximate distance between two points (in meters) in the cloud. 
+   * Initialized to 0.02 but, should most likely be calibrated. */
+  
+  double PC2_threshold_z_min; 
+  /**< Do not account points with a Z-coordinate smaller than this. 
+   * If <code>sensor_frame_has_z_axis_forward</code> is set, then the negated Y-coordinate is considered instead of the
+   * Z-coordinate of the point, since the Y-axis is pointing down in that case.
+   * Initialized to 0.1. */
+  
+  double PC2_threshold_z_max; 
+  /**< Do not account points with a Z-coordinate larger than this. It is assumed that the Z-axis in the sensor frame is 
+   * pointing up.
+   * If <code>sensor_frame_has_z_axis_forward</code> is set, then the negated Y-coordinate is considered instead of the
+   * Z-coordinate of the point, since the Y-axis is pointing down in that case.
+   * Initialized to 1.0. */
+  
+  bool PC2_bin_organized_cloud_by_column;
+  /**< If set, then the points of organized clouds (clouds with more than one row, e.g. from depth cameras) are 
+   * binned by column: the closest point of each column among the rows that pass the Z-coordinate thresholds is put 
+   * in the bank indices that the column covers. These indices are calculated from the points of the column the 
+   * first time the column has any such points, assuming that each column of the camera looks in a (nearly) 
+   * constant direction. This avoids finding the bank indices of every point of every message.
+   * Initialized to <code>false</code>. */
+  
+  int PC2_nr_binning_threads;
+  /**< The number of threads that bin the points of each message, including the thread that adds the message. 
+   * The columns of the message are split evenly between the threads, so that dense clouds are binned in parallel 
+   * also when they have a single row (e.g. a lidar sweep). Each thread keeps the smallest squared range of its 
+   * points in each bank index, and these are merged when all threads are done.
+   * Initialized to 1. */
+  
+  std::string node_name_suffix;
+  /**< Add a suffix to the reported node name in the <code>origin_node_name</code> field of the  
+   * <code>MovingObjectArray</code> messages.
+   * Initialized to the empty string <code>""</code>.
+   */
+  
+  /**
+   * Initializes the member variables to the stated values.
+   */
+  BankArgument();
+  
+  /**
+   * @brief Allow Bank to access private members of this class.
+   * @relates Bank
+   */
+  friend class Bank;
+  
+  /**
+   * @brief Allow BankCore to access private members of this class.
+   * @relates BankCore
+   */
+  friend class BankCore;
+  
+private:
+  friend std::ostream& operator<<(std::ostream& os, const BankArgument& ba);
+  std::string sensor_frame; 
+  /**< The name of the sensor frame. Set to the frame of the sensor. */
+  
+  float angle_increment; 
+  /**< The angular difference between two consecutive scan points. 
+   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
+   * For <code>sensor_msgs::PointCloud2</code>, this is calculated based on
+   * <code>angle_max</code>, <code>angle_min</code> and <code>points_per_scan</code>. */
+  
+  float time_increment; 
+  /**< The time difference between two consecutive scan points. 
+   * For <code>sensor_msgs::LaserScan</code>, 
+   * the corresponding value of the first message. 
+   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0. */
+  
+  float scan_time; 
+  /**< The time needed for each complete scan. 
+   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
+   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0. */
+  
+  float range_min;
+  /**< The minimum range the sensor can measure. 
+   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
+   * For <code>sensor_msgs::PointCloud2</code>, this is set to 0.01. */
+  
+  float range_max; 
+  /**< The maximum range the sensor can measure. 
+   * For <code>sensor_msgs::LaserScan</code>, the corresponding value of the first message. 
+   * For <code>sensor_msgs::PointCloud2</code>, this is set to <code>object_threshold_max_distance</code>. */
+  
+  bool sensor_is_360_degrees;
+  /**< Whether the sensor is scanning 360 degrees.
+   * This is determined based on the angle limits of the bank */
+  
+  void check(); 
+  /**< Validate the specified values. For numeric values, this could include a range check. */
+  
+  void check_PC2();
+  /**< Validate the specified <code>sensor_msgs::PointCloud2</code>-specific values. 
+   * For numeric values, this could include a range check. */
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_ARGUMENT_H
@@ -0,0 +1,427 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_CORE_H
+#define BANK_CORE_H
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <find_moving_objects/bank_argument.h>
+#include <find_moving_objects/bank_storage.h>
+#include <find_moving_objects/bank_kernels.h>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * An object found in the newest scan of a <code>BankCore</code> that could be tracked back through the bank to the 
+ * oldest scan. 
+ * All positions, velocities and angles are given in the sensor frame, i.e. the frame in which the ranges were measured.
+ */
+class TrackedObject
+{
+public:
+  unsigned int seq;
+  /**< The number of valid objects found in the newest scan up to and including this one. */
+  
+  unsigned int index_min;
+  /**< Index of the scan point at <code>angle_begin</code>. */
+  
+  unsigned int index_mean;
+  /**< Index of the middle scan point of the object. */
+  
+  unsigned int index_max;
+  /**< Index of the scan point at <code>angle_end</code>. 
+   * Might be smaller than <code>index_min</code> for a 360 degree sensor. */
+  
+  unsigned int nr_points;
+  /**< The number of scan points defining the object. */
+  
+  double angle_begin;
+  /**< The angle at which the object begins. */
+  
+  double angle_end;
+  /**< The angle at which the object ends. */
+  
+  double angle_mean;
+  /**< The angle at which <code>distance</code> is found. */
+  
+  float distance_at_angle_begin;
+  /**< The range at <code>angle_begin</code>. */
+  
+  float distance_at_angle_end;
+  /**< The range at <code>angle_end</code>. */
+  
+  float distance;
+  /**< The average range of the object. */
+  
+  float seen_width;
+  /**< The width of the object as seen by the sensor (law of cosine). */
+  
+  double position[3];
+  /**< Position (x,y,z) of the object. */
+  
+  double angle_for_closest_distance;
+  /**< The angle at which the object is closest to the sensor. */
+  
+  float closest_distance;
+  /**< The smallest range of the object. */
+  
+  double closest_point[3];
+  /**< Position (x,y,z) of the point on the object closest to the sensor. */
+  
+  double position_old[3];
+  /**< Position (x,y,z) of the object in the oldest scan of the bank. */
+  
+  double seen_width_old;
+  /**< The width of the object in the oldest scan of the bank. */
+  
+  double dt;
+  /**< The difference in time between the oldest and newest scans in the bank. */
+  
+  double velocity[3];
+  /**< Velocity (x,y,z) of the object. */
+  
+  double speed;
+  /**< Speed of the object. */
+  
+  double velocity_normalized[3];
+  /**< The normalized velocity of the object, or zero if <code>speed</code> is zero. */
+};
+
+
+/**
+ * A segment of the newest scan of a <code>BankCore</code>, i.e. a maximal run of consecutive valid scan points 
+ * (within <code>[range_min,range_max]</code>) where neighbouring ranges differ by at most 
+ * <code>object_threshold_edge_max_delta_range</code>. Each segment is a candidate object.
+ */
+class Segment
+{
+public:
+  unsigned int index_begin;
+  /**< Index of the first scan point of the segment. 
+   * Might be larger than <code>index_end</code> for a 360 degree sensor. */
+  
+  unsigned int index_end;
+  /**< Index of the last scan point of the segment. */
+  
+  unsigned int nr_points;
+  /**< The number of scan points in the segment. */
+  
+  unsigned int index_mean;
+  /**< Index of the middle scan point of the segment. */
+  
+  float range_sum;
+  /**< The sum of the ranges of the segment. */
+  
+  float range_at_begin;
+  /**< The range at <code>index_begin</code>. */
+  
+  float range_at_end;
+  /**< The range at <code>index_end</code>. */
+  
+  float range_min;
+  /**< The smallest range of the segment. */
+  
+  unsigned int range_min_index;
+  /**< Index of the (first) scan point at which <code>range_min</code> is found. */
+  
+  float range_max;
+  /**< The largest range of the segment. */
+  
+  unsigned int range_max_index;
+  /**< Index of the (first) scan point at which <code>range_max</code> is found. */
+};
+
+
+/**
+ * The segments of one scan of a <code>BankCore</code>, in increasing index order.
+ */
+class SegmentTable
+{
+public:
+  std::vector<Segment> segments;
+  /**< The segments. */
+  
+  std::vector<unsigned int> index_begin;
+  /**< The <code>index_begin</code> of each segment, compact for searching. */
+  
+  bool wraps_around;
+  /**< Whether the last and first scan points are valid and within the edge threshold of each other, 
+   * i.e. whether a segment continues across the end of the scan. */
+  
+  unsigned int index_found;
+  /**< Position (in <code>segments</code>) of the segment found by the latest call to <code>find()</code>. */
+  
+  /**
+   * Find the segment containing a scan point. 
+   * The search is fastest if the scan points of consecutive calls are in increasing order.
+   * 
+   * @param index Index of a scan point.
+   * @return Pointer to the segment containing the scan point, or NULL if the scan point is not valid.
+   */
+  const Segment * find(const unsigned int index);
+};
+
+
+/**
+ * The ROS-independent part of the bank. 
+ * It stores a number of range scans, EMA-adapted, and finds and tracks objects through these scans. 
+ * The input is ranges and time stamps and the output is a list of <code>TrackedObject</code>s, so it can be used 
+ * without a running ROS master, e.g. for benchmarking or offline replay. 
+ * <code>Bank</code> adds the transformations into other frames and the publishing of the results.
+ * 
+ * The same restrictions as for <code>Bank</code> apply, i.e. only one single source is supposed to feed the core with 
+ * scans, all of which must have the same number of points and the same view angle.
+ */
+class BankCore
+{
+private:
+  /* BANK ARGUMENTS */
+  BankArgument bank_argument;
+  
+  /* BANK */
+  BankStorage bank_ranges_ema; // One row per scan, contiguous and aligned
+  std::vector<double> bank_stamp;
+  bool bank_is_initialized;
+  bool bank_is_filled;
+  BankKernels kernels; // Selected for this CPU in the constructor
+  
+  /* INDICES FOR THE BANK */
+  int bank_index_newest;
+  int bank_index_put; // nr_scans_in_bank is/should be greater than 1!
+  
+  /* ADAPTATION OF THE NUMBER OF SCANS TO THE RATE OF THE SCANS */
+  double adapted_rate; // The rate the number of scans was last adapted to, 0 if it has not been adapted
+  int nr_scans_since_adapted; // The number of scans added since then
+  void adaptToRate();
+  
+  /* SEGMENTATION OF THE SCANS, DONE ONCE WHEN A SCAN IS ADDED */
+  std::vector<uint64_t> segment_valid_bits; // One bit per scan point, see SegmentMaskKernel
+  std::vector<uint64_t> segment_link_bits;
+  float segment_max_delta_range; // Largest float not above object_threshold_edge_max_delta_range
+  float tracking_range_max; // Smallest of range_max and object_threshold_max_distance
+  std::vector<SegmentTable> row_segments; // One table per row of the bank, for ranges up to tracking_range_max
+  SegmentTable newest_segments; // For ranges up to range_max, if it differs from tracking_range_max
+  
+  /* Basic functionality used by the functions below */
+  inline void initIndex();
+  inline void advanceIndex();
+  void emaPutRanges();
+  
+  /* Split a row into segments of ranges within [range_min,range_max], in increasing index order */
+  void segmentRow(const int row, const float range_max, SegmentTable * segment_table);
+  
+  /* Segment a row that has just been written */
+  void segmentInsertedRow(const int row);
+  
+  /* 
+   * Tracking of an object through history to get the indices of its middle, 
+   * left and right points in the oldest scans, along with the sum of all ranges etc.
+   * One segment lookup per level of the bank.
+   */
+  void getOldIndices(const unsigned int object_width_in_points,
+                     const unsigned int index_mean,
+                     const unsigned int threshold_consecutive_failures_to_find_object,
+                     int * index_min_old,
+                     int * index_mean_old,
+                     int * index_max_old,
+                     float * range_sum_old,
+                     float * range_at_min_index_old,
+                     float * range_at_max_index_old);
+  
+public:
+  /**
+   * Creates an uninitialized instance of BankCore.
+   */
+  BankCore();
+  
+  /**
+   * Allocate the bank.
+   * 
+   * This function should only be called once.
+   * @param bank_argument An instance of <code>BankArgument</code>, specifying the behavior of the bank.
+   *                      <code>points_per_scan</code>, <code>angle_min</code> and <code>angle_max</code> must describe
+   *                      the scans that will be added.
+   * @param angle_increment The angular difference between two consecutive scan points.
+   * @param range_min The minimum range the sensor can measure.
+   * @param range_max The maximum range the sensor can measure.
+   * @return 0 on success, -1 if the bank is already initialized or could not be allocated.
+   */
+  long init(BankArgument bank_argument,
+            const float angle_increment,
+            const float range_min,
+            const float range_max);
+  
+  /**
+   * Resize the bank, keeping the newest scans in it. 
+   * If the bank is made smaller than the number of scans in it, then the oldest scans are dropped; if it is made 
+   * larger, then it is not filled until the missing scans have been added. 
+   * The scans are moved to other slots.
+   * 
+   * @param nr_scans_in_bank The new number of scans in the bank.
+   * @return 0 on success, -1 if the bank is not initialized, the number is smaller than 2 or if the bank could not be 
+   *         allocated, in which case the bank is left unchanged.
+   */
+  long resize(const int nr_scans_in_bank);
+  
+  /**
+   * The number of scans that a bank should hold to cover a time, given the rate of the scans. 
+   * 
+   * @param time The time, in seconds, that the bank should cover.
+   * @param rate The rate of the scans, in Hz.
+   * @return The number of scans, at least 2.
+   */
+  static int getNrScansForTime(const double time, const double rate);
+  
+  /**
+   * Add the first scan to the bank, no EMA is performed. 
+   * Infinite and NaN ranges are replaced by values outside <code>[range_min,range_max]</code>.
+   * 
+   * @param ranges Pointer to the <code>points_per_scan</code> ranges of the scan.
+   * @param stamp The time stamp of the scan in seconds.
+   * @return 0.
+   */
+  long addFirstScan(const float * ranges, const double stamp);
+  
+  /**
+   * Add a scan to the bank (replace the oldest scan) and perform EMA.
+   * Infinite and NaN ranges are replaced by values outside <code>[range_min,range_max]</code>.
+   * The bank is then adapted to the rate of the scans, if <code>adapt_nr_scans_in_bank_time</code> is positive.
+   * 
+   * @param ranges Pointer to the <code>points_per_scan</code> ranges of the scan.
+   * @param stamp The time stamp of the scan in seconds.
+   * @return 0.
+   */
+  long addScan(const float * ranges, const double stamp);
+  
+  /**
+   * Start filling the first scan of the bank point by point. 
+   * All ranges of the returned scan are reset to a value larger than <code>object_threshold_max_distance</code>.
+   * 
+   * @param stamp The time stamp of the scan in seconds.
+   * @return Pointer to the <code>points_per_scan</code> ranges to fill.
+   */
+  float * startFirstPut(const double stamp);
+  
+  /**
+   * Start filling a scan point by point, replacing the oldest scan of the bank. 
+   * All ranges of the returned scan are reset to a value larger than <code>object_threshold_max_distance</code>.
+   * 
+   * @param stamp The time stamp of the scan in seconds.
+   * @return Pointer to the <code>points_per_scan</code> ranges to fill.
+   */
+  float * startPut(const double stamp);
+  
+  /**
+   * Finish the first scan started using <code>startFirstPut()</code>.
+   */
+  void finishFirstPut();
+  
+  /**
+   * Finish the scan started using <code>startPut()</code>, and perform EMA.
+   * The bank is then adapted to the rate of the scans, if <code>adapt_nr_scans_in_bank_time</code> is positive.
+   */
+  void finishPut();
+  
+  /**
+   * Find objects in the newest scan of the bank and track them to the oldest scan.
+   * 
+   * @param tracked_objects Cleared and filled with the objects that could be tracked through the bank.
+   * @return 0 on success, -1 if the bank is not filled yet.
+   */
+  long findObjects(std::vector<TrackedObject> * tracked_objects);
+  
+  /**
+   * @return Whether <code>init()</code> has succeeded.
+   */
+  bool isInitialized() const { return bank_is_initialized; }
+  
+  /**
+   * @return Whether the bank is filled with scans, i.e. whether objects can be found.
+   */
+  bool isFilled() const { return bank_is_filled; }
+  
+  /**
+   * @return The number of scans in the bank, which changes if the bank is adapted to the rate of the scans.
+   */
+  int getNrScansInBank() const { return bank_argument.nr_scans_in_bank; }
+  
+  /**
+   * @return The EMA-adapted ranges of the newest scan in the bank.
+   */
+  const float * getNewestRanges() const { return bank_ranges_ema.row(bank_index_newest); }
+  
+  /**
+   * @return The time stamp (in seconds) of the newest scan in the bank.
+   */
+  double getNewestStamp() const { return bank_stamp[bank_index_newest]; }
+  
+  /**
+   * @return The time stamp (in seconds) of the oldest scan in the bank.
+   */
+  double getOldestStamp() const { return bank_stamp[bank_index_put]; }
+  
+  /**
+   * @return The slot (row) of the newest scan in the bank.
+   */
+  int getNewestIndex() const { return bank_index_newest; }
+  
+  /**
+   * @return The slot (row) of the oldest scan in the bank.
+   */
+  int getOldestIndex() const { return bank_index_put; }
+  
+  /**
+   * @return The name of the kernels used to add scans, e.g. "avx2".
+   */
+  const char * getKernelsName() const { return kernels.name; }
+  
+  /**
+   * @return The kernels selected for this CPU.
+   */
+  const BankKernels & getKernels() const { return kernels; }
+  
+  /**
+   * @return The ranges at the put index as a string, for debugging.
+   */
+  std::string getStringPutRanges();
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_CORE_H
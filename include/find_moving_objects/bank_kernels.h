@@ -0,0 +1,183 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_KERNELS_H
+#define BANK_KERNELS_H
+#include <stdint.h>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * Kernel that sanitizes the ranges of a new scan and EMA-adapts them in one pass, i.e. for each i, 
+ * <code>ranges_put[i]</code> is set to
+ *   <code>value_pos_inf_nan</code> if <code>ranges[i]</code> is +inf or NaN,
+ *   <code>value_neg_inf</code> if <code>ranges[i]</code> is -inf, and
+ *   <code>alpha * ranges[i] + alpha_prev * ranges_newest[i]</code> otherwise.
+ * 
+ * <code>ranges_newest</code> may be equal to <code>ranges</code> (with alpha=1 and alpha_prev=0) to only sanitize.
+ */
+typedef void (*SanitizeEmaKernel)(const float * ranges,
+                                  const float * ranges_newest,
+                                  float * ranges_put,
+                                  const unsigned int nr_ranges,
+                                  const float alpha,
+                                  const float alpha_prev,
+                                  const float value_pos_inf_nan,
+                                  const float value_neg_inf);
+
+/**
+ * Kernel that EMA-adapts a scan in place, i.e. for each i, 
+ * <code>ranges_put[i] = alpha * ranges_put[i] + alpha_prev * ranges_newest[i]</code>.
+ */
+typedef void (*EmaKernel)(float * ranges_put,
+                          const float * ranges_newest,
+                          const unsigned int nr_ranges,
+                          const float alpha,
+                          const float alpha_prev);
+
+/**
+ * Kernel that computes the segmentation masks of a scan. For each i, bit <code>i % 64</code> of word <code>i / 64</code> 
+ * is set in
+ *   <code>valid_bits</code> if <code>range_min <= ranges[i] <= range_max</code>, and in
+ *   <code>link_bits</code> if points i-1 and i are both valid and <code>|ranges[i] - ranges[i-1]| <= max_delta_range</code>.
+ * 
+ * Both masks must hold <code>nr_ranges / 64 + 1</code> words; all bits from <code>nr_ranges</code> and up are cleared.
+ */
+typedef void (*SegmentMaskKernel)(const float * ranges,
+                                  const unsigned int nr_ranges,
+                                  const float range_min,
+                                  const float range_max,
+                                  const float max_delta_range,
+                                  uint64_t * valid_bits,
+                                  uint64_t * link_bits);
+
+/**
+ * Kernel that computes the sum, the minimum and the maximum of the ranges of a segment, along with the index 
+ * (relative to <code>ranges</code>) of the first occurrence of the minimum and of the maximum. 
+ * The ranges are summed in eight interleaved partial sums that are added in a fixed order, then the remaining 
+ * ranges are added one by one, so fewer than eight ranges are summed in order.
+ */
+typedef void (*SegmentStatsKernel)(const float * ranges,
+                                   const unsigned int nr_ranges,
+                                   float * range_sum,
+                                   float * range_min,
+                                   unsigned int * range_min_index,
+                                   float * range_max,
+                                   unsigned int * range_max_index);
+
+/**
+ * Kernel that takes the element-wise minimum of two arrays in place, i.e. for each i, 
+ * <code>values[i]</code> is set to the smaller of <code>values[i]</code> and <code>other_values[i]</code>. 
+ * The values must not be NaN.
+ */
+typedef void (*MinimumKernel)(double * values,
+                              const double * other_values,
+                              const unsigned int nr_values);
+
+
+/**
+ * Kernel that decodes the coordinates of <code>nr_points</code> consecutive points of a PointCloud2 message, 
+ * <code>point_step</code> bytes apart and starting at <code>points</code>, into <code>x</code>, <code>y</code> 
+ * and <code>z</code>. The offsets are given in bytes from the start of each point.
+ */
+typedef void (*PointDecoderKernel)(const uint8_t * points,
+                                   const unsigned int nr_points,
+                                   const unsigned int point_step,
+                                   const unsigned int x_offset,
+                                   const unsigned int y_offset,
+                                   const unsigned int z_offset,
+                                   double * x,
+                                   double * y,
+                                   double * z);
+
+/**
+ * Select the point decoder for a PointCloud2 layout, i.e. for coordinates that are 4 (float) or 8 (double) bytes 
+ * and that are stored in the byte order of this CPU or in the reverse byte order. 
+ * A faster decoder is selected for the common case of packed float coordinates at offsets 0, 4 and 8.
+ * @return The decoder, or NULL if some coordinate has another size.
+ */
+PointDecoderKernel selectPointDecoder(const unsigned int x_bytes,
+                                      const unsigned int y_bytes,
+                                      const unsigned int z_bytes,
+                                      const unsigned int x_offset,
+                                      const unsigned int y_offset,
+                                      const unsigned int z_offset,
+                                      const bool must_reverse_bytes);
+
+
+/**
+ * The kernels used by <code>BankCore</code> to add scans to the bank and to segment them, and by <code>Bank</code> 
+ * to merge the bank indices of PointCloud2 messages that are binned by several threads. 
+ * The fastest implementation supported by the CPU (AVX2, SSE4.1, NEON or scalar) is selected at runtime. 
+ * All implementations give the same results.
+ */
+class BankKernels
+{
+public:
+  SanitizeEmaKernel sanitizeEma;
+  /**< Sanitize and EMA-adapt the ranges of a new scan. */
+  
+  EmaKernel ema;
+  /**< EMA-adapt a scan in place. */
+  
+  SegmentMaskKernel segmentMask;
+  /**< Compute the masks from which the segments (object candidates) of a scan are extracted. */
+  
+  SegmentStatsKernel segmentStats;
+  /**< Compute the sum, minimum and maximum of the ranges of a segment. */
+  
+  MinimumKernel minimum;
+  /**< Take the element-wise minimum of two arrays. */
+  
+  const char * name;
+  /**< The name of the selected implementation, e.g. "avx2". */
+  
+  /**
+   * @return The fastest kernels supported by this CPU.
+   */
+  static BankKernels select();
+  
+  /**
+   * @return The scalar kernels, supported by all CPUs.
+   */
+  static BankKernels scalar();
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_KERNELS_H
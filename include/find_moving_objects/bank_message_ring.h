@@ -0,0 +1,115 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_MESSAGE_RING_H
+#define BANK_MESSAGE_RING_H
+#include <atomic>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * A bounded, lock-free ring of messages (opaque pointers) from one producer thread, e.g. a subscriber callback, to 
+ * a consumer thread. 
+ * 
+ * Only the producer may push, but both the consumer and the producer may pop, so that the producer can drop the 
+ * oldest message to make room for a new one. Each cell carries a sequence number telling whether it is free or 
+ * holds a message of a given lap, so a message is only handed to the thread that claims its position. 
+ * The ring does not own the messages.
+ */
+class BankMessageRing
+{
+private:
+  struct Cell
+  {
+    std::atomic<unsigned long> sequence; // Position of the cell (free) or position+1 (holding a message)
+    void * message;
+  };
+  
+  Cell * cells;
+  unsigned long mask; // The capacity minus one, the capacity being a power of two
+  char padding_0[64]; // Keep head and tail on separate cache lines
+  std::atomic<unsigned long> head; // Position of the oldest message, claimed by pop()
+  char padding_1[64];
+  std::atomic<unsigned long> tail; // Position of the next message, only written by push()
+  
+  /* Not copyable */
+  BankMessageRing(const BankMessageRing &);
+  BankMessageRing & operator=(const BankMessageRing &);
+  
+public:
+  /**
+   * Creates a ring without cells; <code>init()</code> must be called before it is used.
+   */
+  BankMessageRing();
+  
+  /**
+   * Frees the cells, but not the messages in them.
+   */
+  ~BankMessageRing();
+  
+  /**
+   * Allocate the cells of the ring. Must not be called while the ring is used.
+   * 
+   * @param capacity The number of messages the ring can hold, rounded up to a power of two.
+   * @return 0 on success, -1 if the capacity is 0.
+   */
+  long init(const unsigned int capacity);
+  
+  /**
+   * Add a message to the ring. Must only be called by the producer thread.
+   * 
+   * @return <code>true</code> if the message was added, <code>false</code> if the ring is full.
+   */
+  bool push(void * message);
+  
+  /**
+   * Take the oldest message from the ring.
+   * 
+   * @return The message, or <code>NULL</code> if the ring is empty.
+   */
+  void * pop();
+  
+  /**
+   * @return The number of messages the ring can hold.
+   */
+  unsigned int getCapacity() const { return mask + 1; }
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_MESSAGE_RING_H
@@ -0,0 +1,171 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_PIPELINE_H
+#define BANK_PIPELINE_H
+#include <atomic>
+#include <string>
+#include <pthread.h>
+#include <find_moving_objects/bank_message_ring.h>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * A detection stage that takes the messages of a sensor from a <code>BankMessageRing</code> and runs a task for each 
+ * of them in a thread of its own, so that the thread pushing the messages (the subscriber callback) never waits for 
+ * the banks. 
+ * 
+ * The detection thread sleeps while the ring is empty. What happens when the ring is full is decided by the 
+ * backpressure policy. The messages are opaque pointers, which are given back through a release function once 
+ * they have been processed or dropped.
+ */
+class BankPipeline
+{
+public:
+  /**
+   * What to do when the detection thread cannot keep up with the messages.
+   */
+  typedef enum
+  {
+    DROP_OLDEST, /**< Drop the oldest queued message to make room for the new one. */
+    COALESCE,    /**< As <code>DROP_OLDEST</code>, and the detection thread also takes all queued messages at once, 
+                  *   running the task on the newest only after the older ones have been added. */
+    BLOCK        /**< Wait in <code>push()</code> until there is room, i.e. let the subscriber queue fill up. */
+  } Backpressure;
+  
+  /**
+   * A task, run as <code>task(argument, message, is_newest)</code> by the detection thread for each message in order. 
+   * If <code>is_newest</code> is <code>false</code>, then a newer message is already queued (<code>COALESCE</code> 
+   * only) and only the bank needs to be updated with the message.
+   */
+  typedef void (*Task)(void * argument, void * message, const bool is_newest);
+  
+  /**
+   * A function that frees a message that has been processed or dropped.
+   */
+  typedef void (*Release)(void * message);
+  
+private:
+  BankMessageRing ring;
+  Backpressure backpressure;
+  Task task;
+  Release release;
+  void * argument;
+  pthread_t thread;
+  bool is_started;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_message; // Signaled when a message is pushed while the detection thread waits for one
+  pthread_cond_t cond_space;   // Signaled when a message is taken while push() waits for room (BLOCK)
+  std::atomic<bool> is_stopping; // Set with mutex held
+  std::atomic<bool> detector_is_waiting;
+  std::atomic<bool> pusher_is_waiting;
+  std::atomic<unsigned long> nr_dropped_messages;
+  
+  /* Not copyable; the thread refers to this object */
+  BankPipeline(const BankPipeline &);
+  BankPipeline & operator=(const BankPipeline &);
+  
+  static void * threadBody(void * pipeline);
+  void * waitForMessage(); // NULL when stopped
+  void notifyPusher();
+  
+public:
+  /**
+   * Creates a pipeline without a detection thread.
+   */
+  BankPipeline();
+  
+  /**
+   * Stops the detection thread.
+   */
+  ~BankPipeline();
+  
+  /**
+   * Start the detection thread.
+   * 
+   * @param capacity The number of messages that can be queued, rounded up to a power of two.
+   * @param backpressure What to do when the queue is full.
+   * @param task Run by the detection thread for each message.
+   * @param release Frees a message after it has been processed or dropped.
+   * @param argument Passed to the task.
+   * @return 0 on success, -1 if the capacity is 0 or if the thread could not be started.
+   */
+  long start(const unsigned int capacity, 
+             const Backpressure backpressure, 
+             const Task task, 
+             const Release release, 
+             void * argument);
+  
+  /**
+   * Stop and join the detection thread, the messages that are still queued are released without being processed. 
+   * The pipeline can then be started again.
+   */
+  void stop();
+  
+  /**
+   * Queue a message for the detection thread. Must only be called by one thread, the one receiving the messages.
+   */
+  void push(void * message);
+  
+  /**
+   * @return Whether the detection thread has been started.
+   */
+  bool isStarted() const { return is_started; }
+  
+  /**
+   * @return The backpressure policy that the pipeline was started with.
+   */
+  Backpressure getBackpressure() const { return backpressure; }
+  
+  /**
+   * @return The number of messages that have been dropped since the pipeline was created.
+   */
+  unsigned long getNrDroppedMessages() const { return nr_dropped_messages.load(); }
+  
+  /**
+   * Parse the name of a backpressure policy, i.e. <code>"drop_oldest"</code>, <code>"coalesce"</code> or 
+   * <code>"block"</code>.
+   * 
+   * @return 0 on success, -1 if the name is unknown.
+   */
+  static long parseBackpressure(const std::string & name, Backpressure * backpressure);
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_PIPELINE_H
@@ -0,0 +1,141 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_PUBLISHER_H
+#define BANK_PUBLISHER_H
+#include <vector>
+#include <pthread.h>
+#include <boost/shared_ptr.hpp>
+#include <ros/ros.h>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * A publisher stage: a thread that publishes the messages handed to it by the banks, so that the serialization of 
+ * the messages does not delay the detection of moving objects. 
+ * 
+ * The messages are published in the order they were handed over, also when several banks use the same stage. 
+ * If the queue is full, then either the oldest queued message is dropped or the bank waits until there is room. 
+ * The queue is a ring of jobs that is allocated when the thread is started, so queueing a message allocates nothing.
+ */
+class BankPublisher
+{
+private:
+  pthread_t thread;
+  bool is_started;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_job;   // Signaled when a job is queued
+  pthread_cond_t cond_space; // Signaled when a job is taken, if the banks wait for room
+  bool is_stopping;
+  
+  // A job publishes a message of the type that publishMessage was instantiated for; the publisher is copied since 
+  // that only shares its implementation, and the message is only referred to
+  typedef void (*PublishFunction)(const ros::Publisher & publisher, const boost::shared_ptr<const void> & msg);
+  typedef struct
+  {
+    PublishFunction publish_function;
+    ros::Publisher publisher;
+    boost::shared_ptr<const void> msg;
+  } Job;
+  std::vector<Job> jobs;     // Ring of capacity jobs, the oldest one at index_first
+  unsigned int index_first;
+  unsigned int nr_jobs;
+  unsigned int capacity;
+  bool must_block;
+  unsigned long nr_dropped_messages;
+  
+  /* Not copyable; the thread refers to this object */
+  BankPublisher(const BankPublisher &);
+  BankPublisher & operator=(const BankPublisher &);
+  
+  static void * threadBody(void * publisher);
+  void push(const PublishFunction publish_function, 
+            const ros::Publisher & publisher, 
+            const boost::shared_ptr<const void> & msg);
+  
+  template<typename M>
+  static void publishMessage(const ros::Publisher & publisher, const boost::shared_ptr<const void> & msg)
+  {
+    publisher.publish(boost::static_pointer_cast<const M>(msg));
+  }
+  
+public:
+  /**
+   * Creates a publisher stage without a thread.
+   */
+  BankPublisher();
+  
+  /**
+   * Stops the thread.
+   */
+  ~BankPublisher();
+  
+  /**
+   * Start the thread.
+   * 
+   * @param capacity The number of messages that can be queued.
+   * @param must_block If set, then <code>publish()</code> waits while the queue is full, 
+   *                   otherwise the oldest queued message is dropped.
+   * @return 0 on success, -1 if the capacity is 0 or if the thread could not be started.
+   */
+  long start(const unsigned int capacity, const bool must_block);
+  
+  /**
+   * Stop and join the thread, the messages that are still queued are not published.
+   */
+  void stop();
+  
+  /**
+   * Queue <code>msg</code> to be published by <code>publisher</code> in the thread of this stage. 
+   * The message is not copied and must not be modified afterwards.
+   */
+  template<typename M>
+  void publish(const ros::Publisher & publisher, const boost::shared_ptr<const M> & msg)
+  {
+    push(&BankPublisher::publishMessage<M>, publisher, msg);
+  }
+  
+  /**
+   * @return Whether the thread has been started.
+   */
+  bool isStarted() const { return is_started; }
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_PUBLISHER_H
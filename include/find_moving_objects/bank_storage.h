@@ -0,0 +1,127 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_STORAGE_H
+#define BANK_STORAGE_H
+
+
+namespace find_moving_objects
+{
+
+/**
+ * Contiguous storage for the ranges of all scans in a bank, used as a ring buffer by <code>BankCore</code>. 
+ * 
+ * All scans (rows) are stored after each other in one single memory block, which is aligned to a cache line. 
+ * The row stride is rounded up to a multiple of <code>ALIGNMENT</code> bytes, so that every row is aligned as well 
+ * and can be processed using SIMD instructions without a scalar prologue. 
+ * The padding at the end of each row is zeroed and is not part of the scan. 
+ * The memory is released when the object is destroyed.
+ */
+class BankStorage
+{
+private:
+  float * ranges;
+  unsigned int nr_rows;
+  unsigned int row_stride; // in floats
+  
+  /* Not copyable; the storage is owned by exactly one object */
+  BankStorage(const BankStorage &);
+  BankStorage & operator=(const BankStorage &);
+  
+public:
+  /**
+   * The alignment, in bytes, of the storage and of each row. 
+   * This is the size of a cache line and the width of the widest (AVX-512) SIMD registers.
+   */
+  static const unsigned int ALIGNMENT = 64;
+  
+  /**
+   * Creates an empty storage.
+   */
+  BankStorage();
+  
+  /**
+   * De-allocates the storage.
+   */
+  ~BankStorage();
+  
+  /**
+   * Allocate (or re-allocate) the storage. The ranges are set to zero.
+   * 
+   * @param nr_rows The number of rows, i.e. the number of scans in the bank.
+   * @param points_per_row The number of points of each scan.
+   * @return 0 on success, -1 if the storage could not be allocated.
+   */
+  long allocate(const unsigned int nr_rows, const unsigned int points_per_row);
+  
+  /**
+   * Exchange the memory, and thereby the rows, of this storage with that of another storage.
+   * 
+   * @param other The other storage.
+   */
+  void swap(BankStorage & other);
+  
+  /**
+   * @param i Index of the row, must be smaller than the number of rows.
+   * @return Pointer to the first range of row <code>i</code>.
+   */
+  inline float * row(const unsigned int i) { return ranges + i * row_stride; }
+  
+  /**
+   * @param i Index of the row, must be smaller than the number of rows.
+   * @return Pointer to the first range of row <code>i</code>.
+   */
+  inline const float * row(const unsigned int i) const { return ranges + i * row_stride; }
+  
+  /**
+   * @return The distance, in floats, between the first ranges of two consecutive rows.
+   */
+  inline unsigned int getRowStride() const { return row_stride; }
+  
+  /**
+   * @return The number of rows.
+   */
+  inline unsigned int getNrRows() const { return nr_rows; }
+  
+  /**
+   * @return Whether the storage has been allocated.
+   */
+  inline bool isAllocated() const { return ranges != NULL; }
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_STORAGE_H
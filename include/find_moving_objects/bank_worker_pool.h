@@ -0,0 +1,116 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef BANK_WORKER_POOL_H
+#define BANK_WORKER_POOL_H
+#include <vector>
+#include <pthread.h>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * A persistent pool of worker threads that run the same task for a range of indices, e.g. one index per bank of a 
+ * <code>LaserScanArray</code> or <code>PointCloud2Array</code> message. 
+ * 
+ * The threads are started once and then wait for work, so no threads are created per message. 
+ * The thread calling <code>run()</code> takes part in the work, and <code>run()</code> returns when the task has 
+ * been run for all indices. The indices are handed out one by one, so a slow index does not hold up the others. 
+ * Tasks run concurrently for different indices and must hence not share state without protecting it.
+ */
+class BankWorkerPool
+{
+public:
+  /**
+   * A task, run as <code>task(argument, index)</code>.
+   */
+  typedef void (*Task)(void * argument, const unsigned int index);
+  
+private:
+  std::vector<pthread_t> threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_work;  // Signaled when there is new work, or when the threads must stop
+  pthread_cond_t cond_done;  // Signaled when the task has been run for all indices
+  bool stop;
+  unsigned long generation;  // Incremented for every call to run()
+  Task task;
+  void * argument;
+  unsigned int nr_indices;
+  unsigned int next_index;
+  unsigned int nr_indices_done;
+  
+  /* Not copyable; the threads refer to this object */
+  BankWorkerPool(const BankWorkerPool &);
+  BankWorkerPool & operator=(const BankWorkerPool &);
+  
+  static void * threadBody(void * pool);
+  void runIndices(); // Run the task for indices until all have been handed out, mutex must be held
+  
+public:
+  /**
+   * Creates a pool without threads; <code>run()</code> then runs all indices in the calling thread.
+   */
+  BankWorkerPool();
+  
+  /**
+   * Stops and joins the threads.
+   */
+  ~BankWorkerPool();
+  
+  /**
+   * Start the threads of the pool. 
+   * 
+   * @param nr_threads The number of threads that run tasks, including the thread calling <code>run()</code>, 
+   *                   i.e. <code>nr_threads-1</code> threads are started.
+   * @return 0 on success, -1 if a thread could not be started (the threads that were started are used).
+   */
+  long start(const unsigned int nr_threads);
+  
+  /**
+   * Run <code>task(argument, i)</code> for all i in [0,nr_indices), in parallel, and wait until all have returned.
+   */
+  void run(const Task task, void * argument, const unsigned int nr_indices);
+  
+  /**
+   * @return The number of threads that run tasks, including the thread calling <code>run()</code>.
+   */
+  unsigned int getNrThreads() const { return threads.size() + 1; }
+};
+
+} // namespace find_moving_objects
+
+#endif // BANK_WORKER_POOL_H
@@ -1,15 +1,24 @@
 /* DEFAULT PARAMETER VALUES */
 const std::string default_subscribe_topic                                   = "laserscan";
 const int         default_subscribe_buffer_size                             = 1;
+const int         default_nr_threads                                        = 0; // one per bank, at most one per CPU
+const int         default_pipeline_buffer_size                              = 0; // 0 = process messages in the callback
+const std::string default_pipeline_backpressure                             = "drop_oldest";
 const double      default_ema_alpha                                         = 1.0; // no EMA
 const std::string default_map_frame                                         = "map";
 const std::string default_fixed_frame                                       = "odom";
 const std::string default_base_frame                                        = "base_link";
+const bool        default_compute_in_map_frame                              = true;
+const bool        default_compute_in_fixed_frame                            = true;
+const bool        default_compute_in_base_frame                             = true;
 const int         default_nr_scans_in_bank                                  = 0;
 const double      default_optimize_nr_scans_in_bank                         = 0.3; // seconds
+const bool        default_adapt_nr_scans_in_bank                            = false; // to changes in the rate
+const int         default_max_nr_scans_in_bank                              = 100;
 const double      default_max_confidence_for_dt_match                       = 0.5;
 const double      default_delta_width_confidence_decrease_factor            = 0.5;
 const bool        default_publish_objects                                   = true;
+const bool        default_publish_objects_compact                           = false;
 const bool        default_publish_ema                                       = true;
 const bool        default_publish_objects_closest_points_markers            = true;
 const bool        default_publish_objects_velocity_arrows                   = true;
@@ -17,6 +26,7 @@ const bool        default_publish_objects_delta_position_lines              = tr
 const bool        default_publish_objects_width_lines                       = true;
 const int         default_publish_buffer_size                               = 1;
 const std::string default_topic_objects                                     = "moving_objects";
+const std::string default_topic_objects_compact                             = "moving_objects_compact";
 const std::string default_topic_ema                                         = "ema";
 const std::string default_topic_objects_closest_points_markers              = "objects_closest_point_markers";
 const std::string default_topic_objects_velocity_arrows                     = "objects_velocity_arrows";
@@ -29,6 +39,9 @@ const bool        default_velocity_arrows_use_full_gray_scale               = fa
 const bool        default_velocity_arrows_use_sensor_frame                  = false;
 const bool        default_velocity_arrows_use_base_frame                    = false;
 const bool        default_velocity_arrows_use_fixed_frame                   = false;
+const bool        default_objects_compact_use_sensor_frame                  = false;
+const bool        default_objects_compact_use_base_frame                    = false;
+const bool        default_objects_compact_use_fixed_frame                   = false;
 const double      default_object_threshold_edge_max_delta_range             = 0.15;
 const int         default_object_threshold_min_nr_points                    = 3;
 const double      default_object_threshold_max_distance                     = 6.5;
@@ -0,0 +1,23 @@
+/* DEFAULT PARAMETER VALUES */
+const std::string default_subscribe_topic                                   = "moving_objects";
+const int         default_subscribe_buffer_size                             = 10;
+const int         default_queue_size                                        = 16; // msgs waiting to be evaluated
+const int         default_nr_threads                                        = 0; // at most one per CPU
+const bool        default_verbose                                           = false;
+const bool        default_print_received_objects                            = false;
+const bool        default_publish_objects                                   = true;
+const bool        default_publish_objects_closest_points_markers            = true;
+const bool        default_publish_objects_velocity_arrows                   = true;
+const bool        default_velocity_arrows_use_full_gray_scale               = false;
+const bool        default_velocity_arrows_use_sensor_frame                  = false;
+const bool        default_velocity_arrows_use_base_frame                    = false;
+const bool        default_velocity_arrows_use_fixed_frame                   = false;
+const double      default_threshold_min_confidence                          = 0.0;
+const double      default_threshold_max_delta_time_for_different_sources    = 0.2;
+const double      default_threshold_max_delta_position                      = 0.1;
+const double      default_threshold_max_delta_velocity                      = 0.1;
+const bool        default_ignore_z_map_coordinate_for_position              = true;
+const std::string default_topic_moving_objects_enhanced                     = "moving_objects_enhanced";
+const std::string default_topic_objects_velocity_arrows                     = "objects_velocity_arrows";
+const std::string default_topic_objects_closest_points_markers              = "objects_closest_points_markers";
+const int         default_publish_buffer_size                               = 2;
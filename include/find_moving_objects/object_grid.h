@@ -0,0 +1,118 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+#ifndef OBJECT_GRID_H
+#define OBJECT_GRID_H
+#include <vector>
+
+
+namespace find_moving_objects
+{
+
+/**
+ * A uniform grid over the XY plane that indexes objects by position, so that the objects close to a given position 
+ * can be found without comparing against all objects. 
+ * 
+ * The objects are inserted with their index (e.g. into the <code>objects</code> of a 
+ * <code>MovingObjectArray</code> message), then the grid is finalized once and can be queried any number of times. 
+ * A query returns every object in the cell of the given position and in the eight cells around it, i.e. at least 
+ * all objects within one cell size in both X and Y. A finalized grid is not modified by queries and can be shared 
+ * between threads.
+ */
+class ObjectGrid
+{
+private:
+  typedef struct
+  {
+    long long cell_x;
+    long long cell_y;
+    unsigned int index;
+  } Entry;
+  
+  double inverted_cell_size;
+  std::vector<Entry> entries;          // Sorted on cell, then index, after finalize()
+  std::vector<unsigned int> unindexed; // Objects without a cell (e.g. NaN positions), returned by every query
+  
+  static bool isBefore(const Entry & a, const Entry & b);
+  bool getCell(const double x, const double y, long long * cell_x, long long * cell_y) const; // false if no cell
+  
+public:
+  /**
+   * Creates an empty grid, which must be initialized before objects are inserted.
+   */
+  ObjectGrid();
+  
+  /**
+   * Initialize the grid, removing all objects.
+   * 
+   * @param cell_size The length of the sides of the cells.
+   * @return 0 on success, -1 if <code>cell_size</code> is not a positive number.
+   */
+  long init(const double cell_size);
+  
+  /**
+   * Insert an object.
+   * 
+   * @param x The X coordinate of the object.
+   * @param y The Y coordinate of the object.
+   * @param index The index returned for the object by <code>query()</code>.
+   */
+  void insert(const double x, const double y, const unsigned int index);
+  
+  /**
+   * Prepare the grid for queries, must be called after the last object has been inserted.
+   */
+  void finalize();
+  
+  /**
+   * Append the indices of the objects in the neighbourhood of a position to a vector. 
+   * The indices are not sorted.
+   * 
+   * @param x The X coordinate of the position.
+   * @param y The Y coordinate of the position.
+   * @param indices The vector the indices are appended to.
+   */
+  void query(const double x, const double y, std::vector<unsigned int> * indices) const;
+  
+  /**
+   * @return The number of objects in the grid.
+   */
+  unsigned int getNrObjects() const { return entries.size() + unindexed.size(); }
+};
+
+} // namespace find_moving_objects
+
+#endif // OBJECT_GRID_H
@@ -58,6 +58,8 @@
 #include <string>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 // #include <pthread.h>
 
 /* Local includes */
@@ -108,125 +110,16 @@ namespace find_moving_objects
 
 const float TWO_PI = 2*M_PI;
 
-/*
- * Constructors
- */
-BankArgument::BankArgument()
-{
-  ema_alpha = 1.0;
-  nr_scans_in_bank = 11;
-  points_per_scan = 360;
-  angle_min = -M_PI;
-  angle_max = M_PI;
-  sensor_frame_has_z_axis_forward = false;
-  object_threshold_edge_max_delta_range = 0.15;
-  object_threshold_min_nr_points = 5;
-  object_threshold_max_distance = 6.5;
-  object_threshold_min_speed = 0.03;
-  object_threshold_max_delta_width_in_points = 5;
-  object_threshold_min_confidence = 0.67;
-  object_threshold_bank_tracking_max_delta_distance = 0.2;
-  base_confidence = 0.3;
-  publish_objects = true;
-  publish_ema = true;
-  publish_objects_closest_point_markers = false;
-  publish_objects_velocity_arrows = false;
-  publish_objects_delta_position_lines = false;
-  publish_objects_width_lines = false;
-  velocity_arrows_use_full_gray_scale = false;
-  velocity_arrows_use_sensor_frame = false;
-  velocity_arrows_use_base_frame = false;
-  velocity_arrows_use_fixed_frame = false;
-  velocity_arrow_ns = "velocity_arrow_ns";
-  delta_position_line_ns = "delta_position_line_ns";
-  width_line_ns = "width_line_ns";
-  topic_objects = "moving_objects_arrays";
-  topic_ema = "ema";
-  topic_objects_closest_point_markers = "objects_closest_point_markers";
-  topic_objects_velocity_arrows = "objects_velocity_arrows";
-  topic_objects_delta_position_lines = "objects_delta_position_lines";
-  topic_objects_width_lines = "objects_width_lines";
-  publish_buffer_size = 10;
-  map_frame = "map";
-  fixed_frame = "odom";
-  base_frame = "base_link";
-//   merge_threshold_max_angle_gap = 0.0 / 180.0 * M_PI;
-//   merge_threshold_max_end_points_distance_delta = 0.2;
-//   merge_threshold_max_velocity_direction_delta = 25.0 / 180.0 * M_PI;
-//   merge_threshold_max_speed_delta = 0.2;
-  PC2_message_x_coordinate_field_name = "x";
-  PC2_message_y_coordinate_field_name = "y";
-  PC2_message_z_coordinate_field_name = "z";
-  PC2_voxel_leaf_size = 0.02;
-  PC2_threshold_z_min = 0.1;
-  PC2_threshold_z_max = 1.0;
-  
-  node_name_suffix = "";
-}
-
-std::ostream& operator<<(std::ostream & os, const BankArgument & ba)
+// Transform a point using a transform that has already been looked up
+static inline geometry_msgs::Point transformPoint(const tf2::Transform & transform, 
+                                                  const geometry_msgs::Point & point)
 {
-  os << "Bank Arguments:" << std::endl <<
-    "  ema_alpha = " << ba.ema_alpha << std::endl <<
-    "  nr_scans_in_bank = " << ba.nr_scans_in_bank << std::endl <<
-    "  points_per_scan = " << ba.points_per_scan << std::endl <<
-    "  angle_min = " << ba.angle_min << std::endl <<
-    "  angle_max = " << ba.angle_max << std::endl <<
-    "  sensor_frame_has_z_axis_forward = " << ba.sensor_frame_has_z_axis_forward << std::endl <<
-    "  object_threshold_edge_max_delta_range = " << ba.object_threshold_edge_max_delta_range << std::endl <<
-    "  object_threshold_min_nr_points = " << ba.object_threshold_min_nr_points << std::endl <<
-    "  object_threshold_max_distance = " << ba.object_threshold_max_distance << std::endl <<
-    "  object_threshold_min_speed = " << ba.object_threshold_min_speed << std::endl <<
-    "  object_threshold_max_delta_width_in_points = " << ba.object_threshold_max_delta_width_in_points << std::endl <<
-    "  object_threshold_min_confidence = " << ba.object_threshold_min_confidence << std::endl <<
-    "  object_threshold_bank_tracking_max_delta_distance = " <<
-    ba.object_threshold_bank_tracking_max_delta_distance << std::endl <<
-    "  base_confidence = " << ba.base_confidence << std::endl <<
-    "  publish_objects = " << ba.publish_objects << std::endl <<
-    "  publish_ema = " << ba.publish_ema << std::endl <<
-    "  publish_objects_closest_point_markers = " << ba.publish_objects_closest_point_markers << std::endl <<
-    "  publish_objects_velocity_arrows = " << ba.publish_objects_velocity_arrows << std::endl <<
-    "  publish_objects_delta_position_lines = " << ba.publish_objects_delta_position_lines << std::endl <<
-    "  publish_objects_width_lines = " << ba.publish_objects_width_lines << std::endl <<
-    "  velocity_arrows_use_full_gray_scale = " << ba.velocity_arrows_use_full_gray_scale << std::endl <<
-    "  velocity_arrows_use_sensor_frame = " << ba.velocity_arrows_use_sensor_frame << std::endl <<
-    "  velocity_arrows_use_base_frame = " << ba.velocity_arrows_use_base_frame << std::endl <<
-    "  velocity_arrows_use_fixed_frame = " << ba.velocity_arrows_use_fixed_frame << std::endl <<
-    "  velocity_arrow_ns = " << ba.velocity_arrow_ns << std::endl <<
-    "  delta_position_line_ns = " << ba.delta_position_line_ns << std::endl <<
-    "  width_line_ns = " << ba.width_line_ns << std::endl <<
-    "  topic_objects = " << ba.topic_objects << std::endl <<
-    "  topic_ema = " << ba.topic_ema << std::endl <<
-    "  topic_objects_closest_point_markers = " << ba.topic_objects_closest_point_markers << std::endl <<
-    "  topic_objects_velocity_arrows = " << ba.topic_objects_velocity_arrows << std::endl <<
-    "  topic_objects_delta_position_lines = " << ba.topic_objects_delta_position_lines << std::endl <<
-    "  topic_objects_width_lines = " << ba.topic_objects_width_lines << std::endl <<
-    "  publish_buffer_size = " << ba.publish_buffer_size << std::endl <<
-    "  map_frame = " << ba.map_frame << std::endl <<
-    "  fixed_frame = " << ba.fixed_frame << std::endl <<
-    "  base_frame = " << ba.base_frame << std::endl <<
-//     "  merge_threshold_max_angle_gap = " << ba.merge_threshold_max_angle_gap << std::endl <<
-//     "  merge_threshold_max_end_points_distance_delta = " << 
-//     ba.merge_threshold_max_end_points_distance_delta << std::endl <<
-//     "  merge_threshold_max_velocity_direction_delta = " << 
-//     ba.merge_threshold_max_velocity_direction_delta << std::endl <<
-//     "  merge_threshold_max_speed_delta = " << ba.merge_threshold_max_speed_delta << std::endl <<
-    "  PC2_message_x_coordinate_field_name = " << ba.PC2_message_x_coordinate_field_name << std::endl <<
-    "  PC2_message_y_coordinate_field_name = " << ba.PC2_message_y_coordinate_field_name << std::endl <<
-    "  PC2_message_z_coordinate_field_name = " << ba.PC2_message_z_coordinate_field_name << std::endl <<
-    "  PC2_voxel_leaf_size = " << ba.PC2_voxel_leaf_size << std::endl <<
-    "  PC2_threshold_z_min = " << ba.PC2_threshold_z_min << std::endl <<
-    "  PC2_threshold_z_max = " << ba.PC2_threshold_z_max << std::endl;
-  os << "Private Bank Arguments:" << std::endl <<
-    "  sensor_frame = " << ba.sensor_frame << std::endl <<
-    "  angle_increment = " << ba.angle_increment << std::endl << 
-    "  time_increment = " << ba.time_increment << std::endl << 
-    "  scan_time = " << ba.scan_time << std::endl << 
-    "  range_min = " << ba.range_min << std::endl <<
-    "  range_max = " << ba.range_max << std::endl <<
-    "  node_name_suffix = " << ba.node_name_suffix << std::endl;
-  
-  return os;
+  const tf2::Vector3 v = transform * tf2::Vector3(point.x, point.y, point.z);
+  geometry_msgs::Point out;
+  out.x = v.x();
+  out.y = v.y();
+  out.z = v.z();
+  return out;
 }
 
 // Bank::Bank()
@@ -245,14 +138,20 @@ std::ostream& operator<<(std::ostream & os, const BankArgument & ba)
 //   tf_listener = new tf::TransformListener;
 // }
 
+/*
+ * Constructor
+ */
 Bank::Bank(tf2_ros::Buffer * buffer)
 {
   bank_is_initialized = false;
-  bank_is_filled = false;
   
   /* Check endianness in case of PointCloud2 */
   volatile uint32_t dummy = 0x01234567; // If little endian, then 0x67 is the value at the lowest memory address
   machine_is_little_endian = (*((uint8_t*)(&dummy))) == 0x67;
+  PC2_decode_points = NULL;
+  PC2_decode_points_reversed = NULL;
+  bank_publisher = NULL;
+  nr_message_allocations = 0;
   
   /* Create handle to this node */
   node = new ros::NodeHandle;
@@ -267,12 +166,7 @@ Bank::Bank(tf2_ros::Buffer * buffer)
  */
 Bank::~Bank()
 {
-  for (int i=0; i<bank_argument.nr_scans_in_bank; ++i)
-  {
-    free(bank_ranges_ema[i]);
-  }
-  free(bank_ranges_ema);
-  free(bank_stamp);
+  // The scans are de-allocated by core
 }
 
 
@@ -287,6 +181,12 @@ void BankArgument::check()
   ROS_ASSERT_MSG(2 <= nr_scans_in_bank, 
                  "There must be at least 2 messages in the bank. Otherwise, velocities cannot be calculated."); 
   
+  ROS_ASSERT_MSG(0.0 <= adapt_nr_scans_in_bank_time, 
+                 "The time to adapt the number of messages in the bank to cannot be negative."); 
+  
+  ROS_ASSERT_MSG(adapt_nr_scans_in_bank_time == 0.0 || 2 <= max_nr_scans_in_bank, 
+                 "If adapting the number of messages in the bank, then the largest number must be at least 2."); 
+  
   ROS_ASSERT_MSG(0 < points_per_scan, 
                  "There must be at least 1 point per scan.");
   
@@ -334,6 +234,9 @@ void BankArgument::check()
   ROS_ASSERT_MSG(!publish_objects || topic_objects != "", 
                  "If publishing MovingObjectArray messages, then a topic for that must be given."); 
   
+  ROS_ASSERT_MSG(!publish_objects_compact || topic_objects_compact != "", 
+                 "If publishing MovingObjectCompactArray messages, then a topic for that must be given."); 
+  
   ROS_ASSERT_MSG(!publish_ema || topic_ema != "", 
                  "If publishing object points via LaserScan visualization messages, "
                  "then a topic for that must be given."); 
@@ -366,6 +269,17 @@ void BankArgument::check()
   ROS_ASSERT_MSG(base_frame != "", 
                  "Please specify base frame."); 
   
+  ROS_ASSERT_MSG(!publish_objects_velocity_arrows || velocity_arrows_use_sensor_frame ||
+                 (velocity_arrows_use_base_frame ? compute_in_base_frame : 
+                  velocity_arrows_use_fixed_frame ? compute_in_fixed_frame : compute_in_map_frame), 
+                 "If publishing velocity arrows, then the objects must be computed in the frame of the arrows."); 
+  
+  ROS_ASSERT_MSG(!publish_objects_compact || objects_compact_use_sensor_frame ||
+                 (objects_compact_use_base_frame ? compute_in_base_frame : 
+                  objects_compact_use_fixed_frame ? compute_in_fixed_frame : compute_in_map_frame), 
+                 "If publishing MovingObjectCompactArray messages, then the objects must be computed in the frame "
+                 "of these messages."); 
+  
 //   ROS_ASSERT_MSG(0.0 <= merge_threshold_max_angle_gap && merge_threshold_max_angle_gap <= angle_max - angle_min,
 //                  "Invalid gap angle.");
 //   
@@ -399,6 +313,9 @@ void BankArgument::check_PC2()
   
   ROS_ASSERT_MSG(PC2_threshold_z_min <= PC2_threshold_z_max, 
                  "Invalid thresholds."); 
+  
+  ROS_ASSERT_MSG(1 <= PC2_nr_binning_threads, 
+                 "At least one thread must bin the points."); 
 }
 
 
@@ -414,9 +331,6 @@ void Bank::initBank(BankArgument bank_argument)
   
   bank_argument.check();
   
-  bank_index_put = -1;
-  bank_index_newest = -1;
-  
   /* Create publishers */
   pub_ema = 
     node->advertise<sensor_msgs::LaserScan>(bank_argument.topic_ema, 
@@ -436,36 +350,49 @@ void Bank::initBank(BankArgument bank_argument)
   pub_objects = 
     node->advertise<MovingObjectArray>(bank_argument.topic_objects, 
                                        bank_argument.publish_buffer_size);
+  pub_objects_compact = 
+    node->advertise<MovingObjectCompactArray>(bank_argument.topic_objects_compact, 
+                                              bank_argument.publish_buffer_size);
   
   /* Init bank */
   this->bank_argument = bank_argument;
   this->bank_argument.sensor_is_360_degrees = fabsf(bank_argument.angle_max - bank_argument.angle_min - TWO_PI) <= 
                                               2.0 * bank_argument.angle_increment; // Safety margin
   
-  bank_stamp = (double *) malloc(bank_argument.nr_scans_in_bank * sizeof(double));
-  bank_ranges_ema = (float **) malloc(bank_argument.nr_scans_in_bank * sizeof(float*));
-  ROS_ASSERT_MSG(bank_ranges_ema != NULL, "Could not allocate buffer space for messages.");
-  for (unsigned int i=0; i<bank_argument.nr_scans_in_bank; ++i)
-  {
-    bank_ranges_ema[i] = (float *) malloc(bank_argument.points_per_scan * sizeof(float));
-    ROS_ASSERT_MSG(bank_ranges_ema[i] != NULL, "Could not allocate buffer space message %d.", i);
-  }
+  const long core_init_result = core.init(bank_argument, 
+                                          bank_argument.angle_increment,
+                                          bank_argument.range_min,
+                                          bank_argument.range_max);
+  ROS_ASSERT_MSG(core_init_result == 0, "Could not allocate buffer space for messages.");
+  ROS_DEBUG("Bank kernels: %s", core.getKernelsName());
+  
+  /* Init transform cache - no transforms have been looked up for any slot */
+  bank_transforms.assign(3 * bank_argument.nr_scans_in_bank, tf2::Transform::getIdentity());
+  bank_transforms_stamp.assign(bank_argument.nr_scans_in_bank, -1.0);
+  bank_nr_transforms.assign(bank_argument.nr_scans_in_bank, 0);
   
   /* Init messages to publish - init constant fields */
+  // The messages are published as shared pointers, allowing nodelets in the same manager to receive them without 
+  // serialization
+  msg_ema = boost::make_shared<sensor_msgs::LaserScan>();
+  msg_objects_closest_point_markers = boost::make_shared<sensor_msgs::LaserScan>();
+  msg_objects_velocity_arrows = boost::make_shared<visualization_msgs::MarkerArray>();
+  msg_objects_delta_position_lines = boost::make_shared<visualization_msgs::MarkerArray>();
+  msg_objects_width_lines = boost::make_shared<visualization_msgs::MarkerArray>();
   // EMA (with detected moving objects/objects)
   if (bank_argument.publish_ema)
   {
-    msg_ema.header.frame_id = bank_argument.sensor_frame;
-    msg_ema.angle_min       = bank_argument.angle_min;
-    msg_ema.angle_max       = bank_argument.angle_max;
-    msg_ema.angle_increment = bank_argument.angle_increment;
-    msg_ema.time_increment  = bank_argument.time_increment;
-    msg_ema.scan_time       = bank_argument.scan_time;
-    msg_ema.range_min       = bank_argument.range_min;
-    msg_ema.range_max       = bank_argument.range_max;
-    msg_ema.ranges.resize(bank_argument.points_per_scan); 
-    msg_ema.intensities.resize(bank_argument.points_per_scan);
-    bzero(&msg_ema.intensities[0], bank_argument.points_per_scan * sizeof(float));
+    msg_ema->header.frame_id = bank_argument.sensor_frame;
+    msg_ema->angle_min       = bank_argument.angle_min;
+    msg_ema->angle_max       = bank_argument.angle_max;
+    msg_ema->angle_increment = bank_argument.angle_increment;
+    msg_ema->time_increment  = bank_argument.time_increment;
+    msg_ema->scan_time       = bank_argument.scan_time;
+    msg_ema->range_min       = bank_argument.range_min;
+    msg_ema->range_max       = bank_argument.range_max;
+    msg_ema->ranges.resize(bank_argument.points_per_scan); 
+    msg_ema->intensities.resize(bank_argument.points_per_scan);
+    bzero(&msg_ema->intensities[0], bank_argument.points_per_scan * sizeof(float));
   }
   // Arrows for position and velocity
   if (bank_argument.publish_objects_velocity_arrows)
@@ -566,224 +493,71 @@ void Bank::initBank(BankArgument bank_argument)
   // Laserscan points for closest points
   if (bank_argument.publish_objects_closest_point_markers)
   {
-    msg_objects_closest_point_markers.header.frame_id = bank_argument.sensor_frame;
-    msg_objects_closest_point_markers.angle_min = bank_argument.angle_min;
-    msg_objects_closest_point_markers.angle_max = bank_argument.angle_max;
-    msg_objects_closest_point_markers.angle_increment = bank_argument.angle_increment;
-    msg_objects_closest_point_markers.time_increment = bank_argument.time_increment;
-    msg_objects_closest_point_markers.scan_time = bank_argument.scan_time;
-    msg_objects_closest_point_markers.range_min = bank_argument.range_min;
-    msg_objects_closest_point_markers.range_max = bank_argument.range_max;
-    msg_objects_closest_point_markers.intensities.resize(bank_argument.points_per_scan);
-    msg_objects_closest_point_markers.ranges.resize(bank_argument.points_per_scan);
+    msg_objects_closest_point_markers->header.frame_id = bank_argument.sensor_frame;
+    msg_objects_closest_point_markers->angle_min = bank_argument.angle_min;
+    msg_objects_closest_point_markers->angle_max = bank_argument.angle_max;
+    msg_objects_closest_point_markers->angle_increment = bank_argument.angle_increment;
+    msg_objects_closest_point_markers->time_increment = bank_argument.time_increment;
+    msg_objects_closest_point_markers->scan_time = bank_argument.scan_time;
+    msg_objects_closest_point_markers->range_min = bank_argument.range_min;
+    msg_objects_closest_point_markers->range_max = bank_argument.range_max;
+    msg_objects_closest_point_markers->intensities.resize(bank_argument.points_per_scan);
+    msg_objects_closest_point_markers->ranges.resize(bank_argument.points_per_scan);
     for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
     {
-      msg_objects_closest_point_markers.ranges[i] = msg_objects_closest_point_markers.range_max + 10.0;
-      msg_objects_closest_point_markers.intensities[i] = 0.0;
+      msg_objects_closest_point_markers->ranges[i] = msg_objects_closest_point_markers->range_max + 10.0;
+      msg_objects_closest_point_markers->intensities[i] = 0.0;
     }
   }
   
   // Nr scan points
   bank_ranges_bytes = sizeof(float) * bank_argument.points_per_scan;
   
-  // Init sequence nr
-  moa_seq = 0;
+  // The moving objects message and the prototype of its objects
+  msg_objects = boost::make_shared<MovingObjectArray>();
+  msg_objects->origin_node_name = ros::this_node::getName() + bank_argument.node_name_suffix;
+  object_prototype.map_frame = bank_argument.map_frame;
+  object_prototype.fixed_frame = bank_argument.fixed_frame;
+  object_prototype.base_frame = bank_argument.base_frame;
+  object_prototype.header.frame_id = bank_argument.sensor_frame;
   
-  bank_is_initialized = true;
-}
-
-
-/* 
- * Recursive tracking of an object through history to get the indices of its middle, 
- * left and right points in the oldest scans, along with the sum of all ranges etc.
- */
-void Bank::getOldIndices(const float range_min,
-                         const float range_max,
-                         const unsigned int object_width_in_points,
-                         const int          current_level,
-                         const unsigned int levels_searched,
-                         const unsigned int index_mean,
-                         const unsigned int consecutive_failures_to_find_object,
-                         const unsigned int threshold_consecutive_failures_to_find_object,
-                         int * index_min_old,
-                         int * index_mean_old,
-                         int * index_max_old,
-                         float * range_sum_old,
-                         float * range_at_min_index_old,
-                         float * range_at_max_index_old)
-{
-  // Base case reached?
-  if (levels_searched == bank_argument.nr_scans_in_bank)
+  // The compact moving objects message, with the frames of the objects
+  msg_objects_compact = boost::make_shared<MovingObjectCompactArray>();
+  msg_objects_compact->origin_node_name = msg_objects->origin_node_name;
+  msg_objects_compact->sensor_frame = bank_argument.sensor_frame;
+  msg_objects_compact->map_frame = bank_argument.map_frame;
+  msg_objects_compact->fixed_frame = bank_argument.fixed_frame;
+  msg_objects_compact->base_frame = bank_argument.base_frame;
+  if (bank_argument.objects_compact_use_sensor_frame)
   {
-    return;
+    msg_objects_compact->header.frame_id = bank_argument.sensor_frame;
   }
-  
-  // To find the end indices of the object,
-  int left = index_mean;
-  float prev_range = bank_ranges_ema[current_level][index_mean];
-  float range_sum = prev_range;
-  int right_upper_limit_out_of_bounds = bank_argument.points_per_scan;
-  unsigned int width_in_points = 1; // prev_rang = range at index_mean
-  
-  // Check range
-  if (prev_range < range_min ||
-      range_max < prev_range)
+  else if (bank_argument.objects_compact_use_base_frame)
   {
-    *index_min_old = -1;
-    *index_mean_old = -1;
-    *index_max_old = -1;
-    *range_sum_old = 0;
-    *range_at_min_index_old = 0;
-    *range_at_max_index_old = 0;
-    return;
+    msg_objects_compact->header.frame_id = bank_argument.base_frame;
   }
-  
-  // Search lower index side, with possible wrap around
-  bool stopped = false;
-  for (int i=index_mean-1; 0<=i; --i)
+  else if (bank_argument.objects_compact_use_fixed_frame)
   {
-    // Same type of range check as in the main code
-    const float range = bank_ranges_ema[current_level][i];
-    if (range_min <= range &&
-        range <= range_max &&
-        fabsf(range - prev_range) <= bank_argument.object_threshold_edge_max_delta_range)
-    {
-      left = i;
-      prev_range = range;
-      range_sum += range;
-      width_in_points++;
-    }
-    else
-    {
-      stopped = true;
-      break;
-    }
+    msg_objects_compact->header.frame_id = bank_argument.fixed_frame;
   }
-  if (!stopped)
+  else // map frame
   {
-    // Continue from highest index
-    for (int i=bank_argument.points_per_scan-1; index_mean<i; --i)
-    {
-      // Same type of range check as in the main code
-      const float range = bank_ranges_ema[current_level][i];
-      if (range_min <= range &&
-          range <= range_max &&
-          fabsf(range - prev_range) <= bank_argument.object_threshold_edge_max_delta_range)
-      {
-        left = i;
-        prev_range = range;
-        range_sum += range;
-        right_upper_limit_out_of_bounds--;
-        width_in_points++;
-      }
-      else
-      {
-        break;
-      }
-    }
+    msg_objects_compact->header.frame_id = bank_argument.map_frame;
   }
-  // prev_range holds the range at left
-  *range_at_min_index_old = prev_range;
   
-  // Search higher index side
-  stopped = false;
-  int right = index_mean;
-  prev_range = bank_ranges_ema[current_level][index_mean];
-  for (int i=index_mean+1; i<right_upper_limit_out_of_bounds; ++i)
-  {
-    // Same type of range check as in the main code
-    const float range = bank_ranges_ema[current_level][i];
-    if (range_min <= range &&
-        range <= range_max &&
-        fabsf(range - prev_range) <= bank_argument.object_threshold_edge_max_delta_range)
-    {
-      right = i;
-      prev_range = range;
-      range_sum += range;
-      width_in_points++;
-    }
-    else
-    {
-      stopped = true;
-      break;
-    }
-  }
-  // Here we must make sure that we have not already wrapped around while going left
-  if (!stopped && right_upper_limit_out_of_bounds == bank_argument.points_per_scan)
-  {
-    // Continue from lowest index (0) - we did not wrap around while going left
-    for (int i=0; i<left; ++i)
-    {
-      // Same type of range check as in the main code
-      const float range = bank_ranges_ema[current_level][i];
-      if (range_min <= range &&
-          range <= range_max &&
-          fabsf(range - prev_range) <= bank_argument.object_threshold_edge_max_delta_range)
-      {
-        right = i;
-        prev_range = range;
-        range_sum += range;
-        width_in_points++;
-      }
-      else
-      {
-        break;
-      }
-    }
-  }
-  // prev_range holds the range at right
-  *range_at_max_index_old = prev_range;
+  // Each message starts as the only message of its pool
+  msg_objects_pool.assign(1, msg_objects);
+  msg_objects_compact_pool.assign(1, msg_objects_compact);
+  msg_ema_pool.assign(1, msg_ema);
+  msg_objects_closest_point_markers_pool.assign(1, msg_objects_closest_point_markers);
+  msg_objects_velocity_arrows_pool.assign(1, msg_objects_velocity_arrows);
+  msg_objects_delta_position_lines_pool.assign(1, msg_objects_delta_position_lines);
+  msg_objects_width_lines_pool.assign(1, msg_objects_width_lines);
   
-  // Did we find a valid object?
-  unsigned int misses = consecutive_failures_to_find_object;
-  if (width_in_points < bank_argument.object_threshold_min_nr_points  ||
-      bank_argument.object_threshold_max_delta_width_in_points < abs(width_in_points - object_width_in_points)  ||
-      bank_argument.object_threshold_bank_tracking_max_delta_distance  < 
-        fabs(range_sum / width_in_points - *range_sum_old / object_width_in_points))
-    // range_sum_old holds the range sum of the previous (newer) scanned object
-  {
-    // No
-    misses++;
-    if (threshold_consecutive_failures_to_find_object < misses)
-    {
-      // Return -1 to signal that no index_mean was found
-      *index_min_old = -1;
-      *index_mean_old = -1;
-      *index_max_old = -1;
-      *range_sum_old = 0;
-      *range_at_min_index_old = 0;
-      *range_at_max_index_old = 0;
-      return;
-    }
-  }
-  else
-  {
-    // Yes
-    misses = 0;
-  }
-  
-  // If reaching this point, a valid object was found
-  // Update end points
-  *index_min_old = left;
-  *index_mean_old = (left + (width_in_points-1) / 2) % bank_argument.points_per_scan;
-  *index_max_old = right;
-  *range_sum_old = range_sum;
-  
-  // Continue searching based on the new index_mean
-  getOldIndices(range_min,
-                range_max,
-                width_in_points,
-                (current_level - 1) < 0 ? bank_argument.nr_scans_in_bank - 1 : current_level - 1, // wrap around
-                levels_searched + 1,
-                *index_mean_old,
-                misses,
-                threshold_consecutive_failures_to_find_object,
-                index_min_old,
-                index_mean_old,
-                index_max_old,
-                range_sum_old, // *range_sum_old was set to range_sum above
-                range_at_min_index_old,
-                range_at_max_index_old);
+  // Init sequence nr
+  moa_seq = 0;
+  
+  bank_is_initialized = true;
 }
 
 
@@ -915,1014 +689,801 @@ void Bank::getOldIndices(const float range_min,
 //   }
 // }
 
+/*
+ * Look up the transforms from sensor_frame into the map, fixed and base frames for the scan in the given bank slot, 
+ * unless they have already been looked up for the stamp of that scan. The transforms into the frames that the 
+ * objects are not computed in are skipped. 
+ * Returns the number of transforms, in this order, that are available or skipped.
+ */
+unsigned int Bank::lookupTransforms(const int slot, const double stamp)
+{
+  // A new scan has been put in this slot since the transforms were looked up
+  if (bank_transforms_stamp[slot] != stamp)
+  {
+    bank_transforms_stamp[slot] = stamp;
+    bank_nr_transforms[slot] = 0;
+  }
+  
+  unsigned int & nr_transforms = bank_nr_transforms[slot];
+  if (nr_transforms < 3)
+  {
+    const std::string * target_frames[3] = {&bank_argument.map_frame, 
+                                            &bank_argument.fixed_frame, 
+                                            &bank_argument.base_frame};
+    const bool compute_in_frames[3] = {bank_argument.compute_in_map_frame, 
+                                       bank_argument.compute_in_fixed_frame, 
+                                       bank_argument.compute_in_base_frame};
+    const ros::Time time(stamp);
+    try {
+      for (; nr_transforms<3; ++nr_transforms)
+      {
+        if (!compute_in_frames[nr_transforms])
+        {
+          continue;
+        }
+        // Both ends are at the same time, so no fixed frame is needed, which might not even exist if it is not used
+        tf2::fromMsg(tf_buffer->lookupTransform(*target_frames[nr_transforms], 
+                                                bank_argument.sensor_frame,
+                                                time).transform,
+                     bank_transforms[3 * slot + nr_transforms]);
+      }
+    }
+    catch (tf2::TransformException & e)
+    {
+      ROS_ERROR_STREAM("Caught some exception: " << e.what());
+    }
+  }
+  
+  return nr_transforms;
+}
+
+/*
+ * The number of topics that are published on, one message per topic and report
+ */
+unsigned int Bank::getNrPublishedTopics(const BankArgument & bank_argument)
+{
+  return (bank_argument.publish_objects ? 1 : 0) + 
+         (bank_argument.publish_objects_compact ? 1 : 0) + 
+         (bank_argument.publish_ema ? 1 : 0) + 
+         (bank_argument.publish_objects_closest_point_markers ? 1 : 0) + 
+         (bank_argument.publish_objects_velocity_arrows ? 1 : 0) + 
+         (bank_argument.publish_objects_delta_position_lines ? 1 : 0) + 
+         (bank_argument.publish_objects_width_lines ? 1 : 0);
+}
+
 /*
  * Find and report moving objects based on the current content of the bank
  */
 void Bank::findAndReportMovingObjects()
 {
-  // Is the bank filled with scans?
-  if (!bank_is_filled)
+  // Find objects and track them through the bank
+  if (core.findObjects(&tracked_objects) != 0)
   {
     ROS_WARN("Bank is not filled yet-cannot report objects!");
     return;
   }
   
-  // Moving object array message
-  MovingObjectArray moa;
+  // The visualization messages are only built for the topics that are subscribed to, which is checked once per 
+  // report; a subscriber connecting in the middle of a report gets the messages of the next one
+  const bool report_ema = 
+    bank_argument.publish_ema && 0 < pub_ema.getNumSubscribers();
+  const bool report_closest_point_markers = 
+    bank_argument.publish_objects_closest_point_markers && 0 < pub_objects_closest_point_markers.getNumSubscribers();
+  const bool report_velocity_arrows = 
+    bank_argument.publish_objects_velocity_arrows && 0 < pub_objects_velocity_arrows.getNumSubscribers();
+  const bool report_delta_position_lines = 
+    bank_argument.publish_objects_delta_position_lines && 0 < pub_objects_delta_position_lines.getNumSubscribers();
+  const bool report_width_lines = 
+    bank_argument.publish_objects_width_lines && 0 < pub_objects_width_lines.getNumSubscribers();
+  
+  // Moving object array message, it is not modified after it has been published, so the one of the previous call 
+  // is only reused if no one holds it any longer. 
+  // There is room for all tracked objects, the ones that are not reported are removed below
+  reuseMessage(msg_objects_pool, msg_objects);
+  const MovingObjectArray::Ptr & moa = msg_objects;
+  const unsigned int nr_tracked_objects = tracked_objects.size();
+  resizeElements(moa->objects, spare_objects, nr_tracked_objects, object_prototype);
   
   // Old positions of the objects in moa
-  MovingObjectArray moa_old_positions;
-  
-  /* Find objects in the new scans */
-  unsigned int nr_objects_found = 0;
-  unsigned int nr_object_points = 0;
-  const float range_max = (bank_argument.range_max < bank_argument.object_threshold_max_distance  ?
-                           bank_argument.range_max : bank_argument.object_threshold_max_distance);
-  const float range_min = bank_argument.range_min;
-  unsigned int i=0;
+  resizeElements(moa_old_positions.objects, spare_objects, nr_tracked_objects, object_prototype);
+  unsigned int nr_reported_objects = 0;
   
   // Stamps
-  ros::Time old_time = ros::Time(bank_stamp[bank_index_put]);
-  ros::Time new_time = ros::Time(bank_stamp[bank_index_newest]);
+  ros::Time new_time = ros::Time(core.getNewestStamp());
+  
+  // If the bank has been adapted to the rate of the scans, then its scans have been moved to other slots, so the 
+  // cache is set up again for the new number of slots
+  if (bank_argument.nr_scans_in_bank != core.getNrScansInBank())
+  {
+    ROS_INFO("Bank size adapted from %d to %d scans", bank_argument.nr_scans_in_bank, core.getNrScansInBank());
+    bank_argument.nr_scans_in_bank = core.getNrScansInBank();
+    bank_transforms.assign(3 * bank_argument.nr_scans_in_bank, tf2::Transform::getIdentity());
+    bank_transforms_stamp.assign(bank_argument.nr_scans_in_bank, -1.0);
+    bank_nr_transforms.assign(bank_argument.nr_scans_in_bank, 0);
+  }
+  
+  // The transforms from sensor_frame into the map, fixed and base frames at old_time and at new_time are the same 
+  // for all objects. They are cached per bank slot, so the transforms at new_time are reused when the slot of the 
+  // newest scan has become the slot of the oldest scan. 
+  // If a lookup fails, then the transforms looked up before it are still used, like when transforming point by point.
+  // The objects are only given in the map, fixed and base frames that they are computed in, the fields of the other 
+  // frames are left zeroed by the prototype.
+  const bool compute_in_frames[3] = {bank_argument.compute_in_map_frame, 
+                                     bank_argument.compute_in_fixed_frame, 
+                                     bank_argument.compute_in_base_frame};
+  const tf2::Transform * transforms_old = &bank_transforms[3 * core.getOldestIndex()];
+  const tf2::Transform * transforms_new = &bank_transforms[3 * core.getNewestIndex()];
+  unsigned int nr_transforms = 0; // map, fixed and base frames at old_time, then at new_time
+  if (0 < nr_tracked_objects)
+  {
+    nr_transforms = lookupTransforms(core.getOldestIndex(), core.getOldestStamp());
+    if (nr_transforms == 3)
+    {
+      nr_transforms += lookupTransforms(core.getNewestIndex(), core.getNewestStamp());
+    }
+  }
   
-  // Handle 360 degrees sensors!
-  unsigned int upper_limit_out_of_bounds_scan_point = bank_argument.points_per_scan;
-  while(i<upper_limit_out_of_bounds_scan_point)
+  // Go through the objects that could be tracked
+  for (unsigned int t=0; t<nr_tracked_objects; ++t)
   {
-    /* Find first valid scan from where we currently are */
-    const float range_i = bank_ranges_ema[bank_index_newest][i];
-    float object_range_sum = range_i;
+    const TrackedObject & to = tracked_objects[t];
     
-    // Is i out-of-range?
-    if (range_i < bank_argument.range_min ||
-        bank_argument.range_max < range_i)
-    {
-      i++;
-      continue;
-    }
+    // Fill in the next Moving Object of moa, starting from the prototype; the assignments reuse the memory of 
+    // the strings of the object
+    MovingObject & mo = moa->objects[nr_reported_objects];
+    MovingObject & mo_old_positions = moa_old_positions.objects[nr_reported_objects];
+    mo = object_prototype;
+    mo_old_positions = object_prototype;
+    
+    // Set the expected information
+    mo.header.seq = to.seq;
+    mo.header.stamp = new_time;
+    mo.seen_width = to.seen_width;
+    mo.angle_begin = to.angle_begin;
+    mo.angle_end   = to.angle_end;
+    mo.distance_at_angle_begin = to.distance_at_angle_begin;
+    mo.distance_at_angle_end   = to.distance_at_angle_end;
+    mo.distance = to.distance;
+    mo.position.x = to.position[0];
+    mo.position.y = to.position[1];
+    mo.position.z = to.position[2];
+    mo.angle_for_closest_distance = to.angle_for_closest_distance;
+    mo.closest_distance = to.closest_distance;
+    mo.closest_point.x = to.closest_point[0];
+    mo.closest_point.y = to.closest_point[1];
+    mo.closest_point.z = to.closest_point[2];
     
-    // i is a valid scan
-    nr_object_points = 1;
-    float object_range_min = range_i;
-    float object_range_max = range_i;
-    unsigned int object_range_min_index = i;
-    unsigned int object_range_max_index = i;
+    // Coordinates at old time
+    mo_old_positions.position.x = to.position_old[0];
+    mo_old_positions.position.y = to.position_old[1];
+    mo_old_positions.position.z = to.position_old[2];
     
-    // Count valid scans that are within the object threshold
+    // Lookup transformation from old position of sensor_frame to new location of sensor_frame
+//     bool transform_old_time_map_frame_success = false;
+//     bool transform_new_time_map_frame_success = false;
+// //     tf::StampedTransform transform_map_frame_old_time;
+// //     tf::StampedTransform transform_map_frame_new_time;
+//     geometry_msgs::TransformStamped transform_map_frame_old_time;
+//     geometry_msgs::TransformStamped transform_map_frame_new_time;
+//     bool transform_old_time_fixed_frame_success = false;
+//     bool transform_new_time_fixed_frame_success = false;
+// //     tf::StampedTransform transform_fixed_frame_old_time;
+// //     tf::StampedTransform transform_fixed_frame_new_time;
+//     geometry_msgs::TransformStamped transform_fixed_frame_old_time;
+//     geometry_msgs::TransformStamped transform_fixed_frame_new_time;
+//     bool transform_old_time_base_frame_success = false;
+//     bool transform_new_time_base_frame_success = false;
+// //     tf::StampedTransform transform_base_frame_old_time;
+// //     tf::StampedTransform transform_base_frame_new_time;
+//     geometry_msgs::TransformStamped transform_base_frame_old_time;
+//     geometry_msgs::TransformStamped transform_base_frame_new_time;
+    
+//     // Map frame
+//     // OLD time
+//     try
+//     {
+// //       const bool transform_available = 
+// //       tf_listener->waitForTransform(bank_argument.map_frame,  // Target
+// //                                    bank_argument.sensor_frame, // Source
+// //                                    ros::Time(bank_stamp[bank_index_put]), 
+// //                                    ros::Duration(1.0)); // Timeout
+// //       if (transform_available)
+// //       {
+// //         tf_listener->lookupTransform(bank_argument.map_frame, 
+// //                                     bank_argument.sensor_frame, 
+// //                                     ros::Time(bank_stamp[bank_index_put]),
+// //                                     transform_map_frame_old_time); // Resulting transform
+//       transform_map_frame_old_time = tf_buffer->lookupTransform(bank_argument.map_frame, 
+//                                                                bank_argument.sensor_frame, 
+//                                                                ros::Time(bank_stamp[bank_index_put]));
+//       transform_old_time_map_frame_success = true;
+// //       }
+//         
+// //       else
+// //       {
+// //         ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
+// //                   bank_argument.map_frame.c_str(), bank_stamp[bank_index_put]);
+// //       }
+//       
+//     }
+//     catch (tf2::TransformException ex)
+//     {
+//       ROS_ERROR("Cannot determine transform from %s to %s at old time %f.\n%s",
+//                 bank_argument.sensor_frame.c_str(), 
+//                 bank_argument.map_frame.c_str(), 
+//                 bank_stamp[bank_index_put], 
+//                 ex.what());
+// //       ROS_ERROR("%s", ex.what());
+// //       transform_old_time_map_frame_success = false;
+//     }
+//     
+//     // NEW time
+//     try
+//     {
+//       const bool transform_available = 
+//       tf_listener->waitForTransform(bank_argument.map_frame,  // Target
+//                                    bank_argument.sensor_frame, // Source
+//                                    ros::Time(bank_stamp[bank_index_newest]), 
+//                                    ros::Duration(1.0)); // Timeout
+//       if (transform_available)
+//       {
+//         tf_listener->lookupTransform(bank_argument.map_frame, 
+//                                     bank_argument.sensor_frame, 
+//                                     ros::Time(bank_stamp[bank_index_newest]),
+//                                     transform_map_frame_new_time); // Resulting transform
+//       }
+//       else
+//       {
+//         ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), \
+//                   bank_argument.map_frame.c_str(), bank_stamp[bank_index_newest]);
+//       }
+//     }
+//     catch (tf::TransformException ex)
+//     {
+//       ROS_ERROR("%s", ex.what());
+//       transform_new_time_map_frame_success = false;
+//     }
+//     
+//     // Fixed frame
+//     // OLD time
+//     try
+//     {
+//       const bool transform_available = 
+//       tf_listener->waitForTransform(bank_argument.fixed_frame,  // Target
+//                                    bank_argument.sensor_frame, // Source
+//                                    ros::Time(bank_stamp[bank_index_put]), 
+//                                    ros::Duration(1.0)); // Timeout
+//       if (transform_available)
+//       {
+//         tf_listener->lookupTransform(bank_argument.fixed_frame, 
+//                                     bank_argument.sensor_frame, 
+//                                     ros::Time(bank_stamp[bank_index_put]),
+//                                     transform_fixed_frame_old_time); // Resulting transform
+//       }
+//       else
+//       {
+//         ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
+//                   bank_argument.fixed_frame.c_str(), bank_stamp[bank_index_put]);
+//       }
+//     }
+//     catch (tf::TransformException ex)
+//     {
+//       ROS_ERROR("%s", ex.what());
+//       transform_old_time_fixed_frame_success = false;
+//     }
+//     
+//     // NEW time
+//     try
+//     {
+//       const bool transform_available = 
+//       tf_listener->waitForTransform(bank_argument.fixed_frame,  // Target
+//                                    bank_argument.sensor_frame, // Source
+//                                    ros::Time(bank_stamp[bank_index_newest]), 
+//                                    ros::Duration(1.0)); // Timeout
+//       if (transform_available)
+//       {
+//         tf_listener->lookupTransform(bank_argument.fixed_frame, 
+//                                     bank_argument.sensor_frame, 
+//                                     ros::Time(bank_stamp[bank_index_newest]),
+//                                     transform_fixed_frame_new_time); // Resulting transform
+//       }
+//       else
+//       {
+//         ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), \
+//                   bank_argument.fixed_frame.c_str(), bank_stamp[bank_index_newest]);
+//       }
+//     }
+//     catch (tf::TransformException ex)
+//     {
+//       ROS_ERROR("%s", ex.what());
+//       transform_new_time_fixed_frame_success = false;
+//     }
+//     
+//     // Base frame
+//     // OLD time
+//     try
+//     {
+//       const bool transform_available = 
+//       tf_listener->waitForTransform(bank_argument.base_frame,  // Target
+//                                    bank_argument.sensor_frame, // Source
+//                                    ros::Time(bank_stamp[bank_index_put]), 
+//                                    ros::Duration(1.0)); // Timeout
+//       if (transform_available)
+//       {
+//         tf_listener->lookupTransform(bank_argument.base_frame, 
+//                                     bank_argument.sensor_frame, 
+//                                     ros::Time(bank_stamp[bank_index_put]),
+//                                     transform_base_frame_old_time); // Resulting transform
+//       }
+//       else
+//       {
+//         ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
+//                   bank_argument.base_frame.c_str(), bank_stamp[bank_index_put]);
+//       }
+//     }
+//     catch (tf::TransformException ex)
+//     {
+//       ROS_ERROR("%s", ex.what());
+//       transform_old_time_base_frame_success = false;
+//     }
+//     
+//     // NEW time
+//     try
+//     {
+//       const bool transform_available = 
+//       tf_listener->waitForTransform(bank_argument.base_frame,  // Target
+//                                    bank_argument.sensor_frame, // Source
+//                                    ros::Time(bank_stamp[bank_index_newest]), 
+//                                    ros::Duration(1.0)); // Timeout
+//       if (transform_available)
+//       {
+//         tf_listener->lookupTransform(bank_argument.base_frame, 
+//                                     bank_argument.sensor_frame, 
+//                                     ros::Time(bank_stamp[bank_index_newest]),
+//                                     transform_base_frame_new_time); // Resulting transform
+//       }
+//       else
+//       {
+//         ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), 
+//                   bank_argument.base_frame.c_str(), bank_stamp[bank_index_newest]);
+//       }
+//     }
+//     catch (tf::TransformException ex)
+//     {
+//       ROS_ERROR("%s", ex.what());
+//       transform_new_time_base_frame_success = false;
+//     }
+//     
+//     // Coordinates translated
+//     tf::Stamped<tf::Point> old_point(tf::Point(x_old, y_old, z_old), 
+//                                      ros::Time(bank_stamp[bank_index_put]), 
+//                                      bank_argument.sensor_frame);
+//     tf::Stamped<tf::Point> new_point(tf::Point(mo.position.x, mo.position.y, mo.position.z), 
+//                                      ros::Time(bank_stamp[bank_index_newest]), 
+//                                      bank_argument.sensor_frame);
+//     tf::Stamped<tf::Point> closest_point(tf::Point(mo.closest_point.x, mo.closest_point.y, mo.closest_point.z), 
+//                                          ros::Time(bank_stamp[bank_index_newest]), 
+//                                          bank_argument.sensor_frame);
+//     
+//     tf::Point old_point_in_map_frame;
+//     tf::Point new_point_in_map_frame;
+//     tf::Point closest_point_in_map_frame;
+//     
+//     tf::Point old_point_in_fixed_frame;
+//     tf::Point new_point_in_fixed_frame;
+//     tf::Point closest_point_in_fixed_frame;
+//     
+//     tf::Point old_point_in_base_frame;
+//     tf::Point new_point_in_base_frame;
+//     tf::Point closest_point_in_base_frame;
+//     
+//     if (transform_old_time_map_frame_success && transform_new_time_map_frame_success)
+//     {
+//       old_point_in_map_frame = transform_map_frame_old_time * old_point;
+//       new_point_in_map_frame = transform_map_frame_new_time * new_point;
+//       closest_point_in_map_frame = transform_map_frame_new_time * closest_point;
+//     }
+//     else
+//     {
+//       old_point_in_map_frame = old_point;
+//       new_point_in_map_frame = new_point;
+//       closest_point_in_map_frame = closest_point;
+//     }
+//     
+//     if (transform_old_time_fixed_frame_success && transform_new_time_fixed_frame_success)
+//     {
+//       old_point_in_fixed_frame = transform_fixed_frame_old_time * old_point;
+//       new_point_in_fixed_frame = transform_fixed_frame_new_time * new_point;
+//       closest_point_in_fixed_frame = transform_fixed_frame_new_time * closest_point;
+//     }
+//     else
+//     {
+//       old_point_in_fixed_frame = old_point;
+//       new_point_in_fixed_frame = new_point;
+//       closest_point_in_fixed_frame = closest_point;
+//     }
+//     
+//     if (transform_old_time_base_frame_success && transform_new_time_base_frame_success)
+//     {
+//       old_point_in_base_frame = transform_base_frame_old_time * old_point;
+//       new_point_in_base_frame = transform_base_frame_new_time * new_point;
+//       closest_point_in_base_frame = transform_base_frame_new_time * closest_point;
+//     }
+//     else
+//     {
+//       old_point_in_base_frame = old_point;
+//       new_point_in_base_frame = new_point;
+//       closest_point_in_base_frame = closest_point;
+//     }
     
-    float range_at_angle_begin = range_i; // Might be updated later
-    float range_at_angle_end;             // Updated later
-    unsigned int index_at_angle_begin = i; // Might be updated later
-    unsigned int index_at_angle_end;       // Updated later
-    float prev_range = range_i;
-    unsigned int j=i+1;
-    for (; j<bank_argument.points_per_scan; ++j)
+    // Transform old point into map, fixed and base frames at old_time, and 
+    // new point and closest point into map, fixed and base frames at new_time
+    geometry_msgs::Point * old_positions_out[3] = {&mo_old_positions.position_in_map_frame,
+                                                   &mo_old_positions.position_in_fixed_frame,
+                                                   &mo_old_positions.position_in_base_frame};
+    geometry_msgs::Point * positions_out[3] = {&mo.position_in_map_frame,
+                                               &mo.position_in_fixed_frame,
+                                               &mo.position_in_base_frame};
+    geometry_msgs::Point * closest_points_out[3] = {&mo.closest_point_in_map_frame,
+                                                    &mo.closest_point_in_fixed_frame,
+                                                    &mo.closest_point_in_base_frame};
+    for (unsigned int f=0; f<3; ++f)
     {
-      const float range_j = bank_ranges_ema[bank_index_newest][j];
-      
-      // Range check
-      if (bank_argument.range_min <= range_j  &&
-          range_j <= bank_argument.range_max  &&
-          fabsf(prev_range - range_j) <= bank_argument.object_threshold_edge_max_delta_range)
+      if (!compute_in_frames[f])
       {
-        // j is part of the current object
-        nr_object_points++;
-        object_range_sum += range_j;
-        
-        // Update min and max ranges
-        if (range_j < object_range_min) 
-        {
-          object_range_min = range_j;
-          object_range_min_index = j;
-        }
-        else if (object_range_max < range_j) 
-        {
-          object_range_max = range_j;
-          object_range_max_index = j;
-        }
-        prev_range = range_j;
+        continue;
       }
-      else
+      if (f < nr_transforms)
+      {
+        *old_positions_out[f] = transformPoint(transforms_old[f], mo_old_positions.position);
+      }
+      if (3 + f < nr_transforms)
+      {
+        *positions_out[f] = transformPoint(transforms_new[f], mo.position);
+      }
+      if (nr_transforms == 6)
       {
-        // j is not part of this object
-        break;
+        *closest_points_out[f] = transformPoint(transforms_new[f], mo.closest_point);
       }
     }
     
-    // Update range at end
-    range_at_angle_end = prev_range;
-    index_at_angle_end = j-1; // j is not part of the object
     
-    // If i is 0 and sensor is 360 deg, then we must also search higher end of scan points and account for these
-    if (i == 0 && bank_argument.sensor_is_360_degrees)
+//     // Set old position in map_frame
+//     mo_old_positions.position_in_map_frame.x = old_point_in_map_frame.x();
+//     mo_old_positions.position_in_map_frame.y = old_point_in_map_frame.y();
+//     mo_old_positions.position_in_map_frame.z = old_point_in_map_frame.z();
+//     
+//     // Set old position in fixed_frame
+//     mo_old_positions.position_in_fixed_frame.x = old_point_in_fixed_frame.x();
+//     mo_old_positions.position_in_fixed_frame.y = old_point_in_fixed_frame.y();
+//     mo_old_positions.position_in_fixed_frame.z = old_point_in_fixed_frame.z();
+//     
+//     // Set old position in base_frame
+//     mo_old_positions.position_in_base_frame.x = old_point_in_base_frame.x();
+//     mo_old_positions.position_in_base_frame.y = old_point_in_base_frame.y();
+//     mo_old_positions.position_in_base_frame.z = old_point_in_base_frame.z();
+//     
+//     // Set position in map_frame
+//     mo.position_in_map_frame.x = new_point_in_map_frame.x();
+//     mo.position_in_map_frame.y = new_point_in_map_frame.y();
+//     mo.position_in_map_frame.z = new_point_in_map_frame.z();
+//     
+//     // Set position in fixed_frame
+//     mo.position_in_fixed_frame.x = new_point_in_fixed_frame.x();
+//     mo.position_in_fixed_frame.y = new_point_in_fixed_frame.y();
+//     mo.position_in_fixed_frame.z = new_point_in_fixed_frame.z();
+//     
+//     // Set position in base_frame
+//     mo.position_in_base_frame.x = new_point_in_base_frame.x();
+//     mo.position_in_base_frame.y = new_point_in_base_frame.y();
+//     mo.position_in_base_frame.z = new_point_in_base_frame.z();
+//     
+//     // Set closest point in map_frame
+//     mo.closest_point_in_map_frame.x = closest_point_in_map_frame.x();
+//     mo.closest_point_in_map_frame.y = closest_point_in_map_frame.y();
+//     mo.closest_point_in_map_frame.z = closest_point_in_map_frame.z();
+//     
+//     // Set closest point in fixed_frame
+//     mo.closest_point_in_fixed_frame.x = closest_point_in_fixed_frame.x();
+//     mo.closest_point_in_fixed_frame.y = closest_point_in_fixed_frame.y();
+//     mo.closest_point_in_fixed_frame.z = closest_point_in_fixed_frame.z();
+//     
+//     // Set closest point in base_frame
+//     mo.closest_point_in_base_frame.x = closest_point_in_base_frame.x();
+//     mo.closest_point_in_base_frame.y = closest_point_in_base_frame.y();
+//     mo.closest_point_in_base_frame.z = closest_point_in_base_frame.z();
+//     
+//     // Check how object has moved
+//     const float dx_map =   new_point_in_map_frame.x() -   old_point_in_map_frame.x();
+//     const float dy_map =   new_point_in_map_frame.y() -   old_point_in_map_frame.y();
+//     const float dz_map =   new_point_in_map_frame.z() -   old_point_in_map_frame.z();
+//     const float dx_fixed = new_point_in_fixed_frame.x() - old_point_in_fixed_frame.x();
+//     const float dy_fixed = new_point_in_fixed_frame.y() - old_point_in_fixed_frame.y();
+//     const float dz_fixed = new_point_in_fixed_frame.z() - old_point_in_fixed_frame.z();
+//     const float dx_base =  new_point_in_base_frame.x() -  old_point_in_base_frame.x();
+//     const float dy_base =  new_point_in_base_frame.y() -  old_point_in_base_frame.y();
+//     const float dz_base =  new_point_in_base_frame.z() -  old_point_in_base_frame.z();
+//     const float dx_sensor = mo.position.x - x_old;
+//     const float dy_sensor = mo.position.y - y_old;
+//     const float dz_sensor = mo.position.z - z_old;
+    
+    // And with what velocity
+//     const double dt = bank_stamp[bank_index_newest] - bank_stamp[bank_index_put];
+    const double dt = to.dt;
+//     ROS_ERROR_STREAM("newest stamp = " << mo.header.stamp.toSec() << std::endl << "oldest stamp = " << bank_stamp[bank_index_put] << std::endl << "dt = " << dt << std::endl);
+    mo.velocity.x = to.velocity[0];
+    mo.velocity.y = to.velocity[1];
+    mo.velocity.z = to.velocity[2];
+    mo.speed = to.speed;
+    mo.velocity_normalized.x = to.velocity_normalized[0];
+    mo.velocity_normalized.y = to.velocity_normalized[1];
+    mo.velocity_normalized.z = to.velocity_normalized[2];
+    
+    // Check how object has moved in the map, fixed and base frames, and calculate the speed and normalized velocity
+    geometry_msgs::Vector3 * velocities_out[3] = {&mo.velocity_in_map_frame,
+                                                  &mo.velocity_in_fixed_frame,
+                                                  &mo.velocity_in_base_frame};
+    geometry_msgs::Vector3 * velocities_normalized_out[3] = {&mo.velocity_normalized_in_map_frame,
+                                                             &mo.velocity_normalized_in_fixed_frame,
+                                                             &mo.velocity_normalized_in_base_frame};
+    double * speeds_out[3] = {&mo.speed_in_map_frame,
+                              &mo.speed_in_fixed_frame,
+                              &mo.speed_in_base_frame};
+    for (unsigned int f=0; f<3; ++f)
     {
-      // Start from i again
-      prev_range = range_i;
-      //Save prev_range so we can restore it?
-      
-      // Do not step all the way to j again - it has already been considered
-      for (unsigned int k=bank_argument.points_per_scan-1; j<k; k--)
+      if (!compute_in_frames[f])
       {
-        const float range_k = bank_ranges_ema[bank_index_newest][k];
-        
-        // Range check
-        if (bank_argument.range_min <= range_k  &&
-            range_k <= bank_argument.range_max  &&
-            fabsf(prev_range - range_k) <= bank_argument.object_threshold_edge_max_delta_range)
-        {
-          // k is part of the current object
-          nr_object_points++;
-          object_range_sum += range_k;
-          
-          // Adapt the loop upper limit
-          upper_limit_out_of_bounds_scan_point--;
-          
-          // Update min and max ranges
-          if (range_k < object_range_min) 
-          {
-            object_range_min = range_k;
-            object_range_min_index = k;
-          }
-          else if (object_range_max < range_k) 
-          {
-            object_range_max = range_k;
-            object_range_max_index = k;
-          }
-          prev_range = range_k;
-        }
-        else
-        {
-          // k is not part of this object
-          break;
-        }
+        continue;
       }
+      geometry_msgs::Vector3 & velocity = *velocities_out[f];
+      velocity.x = (positions_out[f]->x - old_positions_out[f]->x) / dt;
+      velocity.y = (positions_out[f]->y - old_positions_out[f]->y) / dt;
+      velocity.z = (positions_out[f]->z - old_positions_out[f]->z) / dt;
       
-      // Update range at begin; it might not be range_i anymore
-      range_at_angle_begin = prev_range;
-      index_at_angle_begin = upper_limit_out_of_bounds_scan_point;
+      const double speed = sqrt(velocity.x * velocity.x  +
+                                velocity.y * velocity.y  +
+                                velocity.z * velocity.z);
+      *speeds_out[f] = speed;
+      
+      // Avoid division by 0, the normalized velocity is already zeroed
+      if (0 < speed)
+      {
+        velocities_normalized_out[f]->x = velocity.x / speed;
+        velocities_normalized_out[f]->y = velocity.y / speed;
+        velocities_normalized_out[f]->z = velocity.z / speed;
+      }
     }
     
-    /* Evaluate the found object (it consists of at least the ith scan) */
-    const float distance = object_range_sum / nr_object_points; // Average distance
-    const float object_seen_width = sqrt( range_at_angle_begin * 
-                                          range_at_angle_begin + 
-                                          range_at_angle_end * 
-                                          range_at_angle_end - 
-                                          2 * range_at_angle_begin * 
-                                              range_at_angle_end * 
-                                              cosf (bank_argument.angle_increment * nr_object_points)
-                                          ); // This is the seen object width using the law of cosine
-    
     // Threshold check
-    if (bank_argument.object_threshold_min_nr_points <= nr_object_points)
+    if (bank_argument.object_threshold_min_speed <= mo.speed || 
+        bank_argument.object_threshold_min_speed <= mo.speed_in_map_frame || 
+        bank_argument.object_threshold_min_speed <= mo.speed_in_fixed_frame || 
+        bank_argument.object_threshold_min_speed <= mo.speed_in_base_frame)
     {
-      // Valid object
-      nr_objects_found++;
+      // We believe that the object is moving in relation to at least one of the frames
+      ROS_DEBUG_STREAM("Moving object:" << std::endl \
+                    << "               (sensor)  x=" << std::setw(12) << std::left << mo.position.x \
+                    <<                       "   y=" << std::setw(12) << std::left << mo.position.y \
+                    <<                       "   z=" << std::setw(12) << std::left << mo.position.z \
+                    <<                       std::endl \
+                    << "                        vx=" << std::setw(12) << std::left << mo.velocity.x \
+                    <<                       "  vy=" << std::setw(12) << std::left << mo.velocity.y \
+                    <<                       "  vz=" << std::setw(12) << std::left << mo.velocity.z \
+                    <<                       "  speed=" << mo.speed \
+                    <<                       std::endl \
+                    << "               (map)     x=" << std::setw(12) << std::left << mo.position_in_map_frame.x  \
+                    <<                       "   y=" << std::setw(12) << std::left << mo.position_in_map_frame.y \
+                    <<                       "   z=" << std::setw(12) << std::left << mo.position_in_map_frame.z \
+                    <<                       std::endl \
+                    << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_map_frame.x \
+                    <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_map_frame.y \
+                    <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_map_frame.z  \
+                    <<                       "  speed=" << mo.speed_in_map_frame \
+                    <<                       std::endl \
+                    << "               (fixed)   x=" << std::setw(12) << std::left << mo.position_in_fixed_frame.x \
+                    <<                       "   y=" << std::setw(12) << std::left << mo.position_in_fixed_frame.y \
+                    <<                       "   z=" << std::setw(12) << std::left << mo.position_in_fixed_frame.z \
+                    <<                       std::endl \
+                    << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.x \
+                    <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.y \
+                    <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.z \
+                    <<                       "  speed=" << mo.speed_in_fixed_frame \
+                    <<                       std::endl \
+                    << "               (base)    x=" << std::setw(12) << std::left << mo.position_in_base_frame.x \
+                    <<                       "   y=" << std::setw(12) << std::left << mo.position_in_base_frame.y \
+                    <<                       "   z=" << std::setw(12) << std::left << mo.position_in_base_frame.z \
+                    <<                       std::endl \
+                    << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_base_frame.x \
+                    <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_base_frame.y \
+                    <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_base_frame.z \
+                    <<                       "  speed=" << mo.speed_in_base_frame \
+                    <<                       std::endl);
       
-      // Recursively derive the min, mean and max indices and the sum of all ranges of the object (if found) 
-      // in the oldest scans in the bank
-      const unsigned int index_min = index_at_angle_begin;
-      const unsigned int index_max = index_at_angle_end;
-      const unsigned int index_mean = (index_min + (nr_object_points-1) / 2) % bank_argument.points_per_scan;
-                                      // Accounts for 360 deg sensor => i==0 could mean that index_max < index_min
-      int index_min_old = -1;
-      int index_mean_old = -1;
-      int index_max_old = -1;
-      float range_sum_old = object_range_sum;
-      float range_at_min_index_old = 0;
-      float range_at_max_index_old = 0;
-      getOldIndices(range_min,
-                    range_max,
-                    nr_object_points,
-                    (bank_index_newest - 1) < 0 ? bank_argument.nr_scans_in_bank - 1 : bank_index_newest - 1,
-                    1, // levels searched
-                    index_mean,
-                    0, // consecutive misses
-                    0, // threshold for consecutive misses; 0 -> allow no misses
-                    &index_min_old,
-                    &index_mean_old,
-                    &index_max_old,
-                    &range_sum_old,
-                    &range_at_min_index_old,
-                    &range_at_max_index_old);
+      // Calculate confidence value using the user-defined function
+      mo.confidence = calculateConfidence(mo, 
+                                          bank_argument, 
+                                          dt, 
+                                          to.seen_width_old);
       
-      // Could we track object?
-      if (0 <= index_mean_old)
+      // Bound the value to [0,1]
+      mo.confidence = (mo.confidence < 0.0  ?  0.0  :  mo.confidence);
+      mo.confidence = (mo.confidence < 1.0  ?  mo.confidence  :  1.0);
+      
+      // Are we confident enough to report this object?
+      if (bank_argument.object_threshold_min_confidence <= mo.confidence)
       {
-        // YES!
-        // Create a Moving Object
-        MovingObject mo;
-        MovingObject mo_old_positions;
-        
-        // Set the expected information
-        mo.map_frame = bank_argument.map_frame;
-        mo.fixed_frame = bank_argument.fixed_frame;
-        mo.base_frame = bank_argument.base_frame;
-        mo.header.frame_id = bank_argument.sensor_frame;
-        mo.header.seq = nr_objects_found;
-        mo.header.stamp = new_time; // ros::Time(bank_stamp[bank_index_newest]);
-        mo.seen_width = object_seen_width;
-        mo.angle_begin = index_min * bank_argument.angle_increment + bank_argument.angle_min;
-        mo.angle_end   = index_max * bank_argument.angle_increment + bank_argument.angle_min;
-        const double angle_mean = index_mean * bank_argument.angle_increment + bank_argument.angle_min;
-        mo.distance_at_angle_begin = range_at_angle_begin;
-        mo.distance_at_angle_end   = range_at_angle_end;
-        // Position is dependent on the distance and angle_mean
-        // Reference coordinate system (relation to the Lidar):
-        //   x: forward
-        //   y: left
-        //   z: up        
-        mo.distance = distance;
-        
-        // Optical frame?
-        if (bank_argument.sensor_frame_has_z_axis_forward)
-        {
-          // Yes, Z-axis forward, X-axis right, Y-axis down
-          mo.position.x = (double) - distance * sinf(angle_mean);
-          mo.position.y = 0.0;
-          mo.position.z = (double) distance * cosf(angle_mean);
-        }
-        else
-        {
-          // No, X-axis forward, Y-axis left, Z-axis up
-          mo.position.x = (double) distance * cosf(angle_mean);
-          mo.position.y = (double) distance * sinf(angle_mean);
-          mo.position.z = 0.0;
-        }
-        
-        // This will be negated rotation around the Y-axis in the case of an optical frame!
-        mo.angle_for_closest_distance = object_range_min_index * bank_argument.angle_increment + 
-                                        bank_argument.angle_min;
-        mo.closest_distance = object_range_min;
-        
-        // Optical frame?
-        if (bank_argument.sensor_frame_has_z_axis_forward)
-        {
-          // Yes, Z-axis forward, X-axis right, Y-axis down
-          mo.closest_point.x = - object_range_min * sinf(mo.angle_for_closest_distance);
-          mo.closest_point.y = 0.0;
-          mo.closest_point.z = object_range_min * cosf(mo.angle_for_closest_distance);
-        }
-        else
-        {
-          // No, X-axis forward, Y-axis left, Z-axis up
-          mo.closest_point.x = object_range_min * cosf(mo.angle_for_closest_distance);
-          mo.closest_point.y = object_range_min * sinf(mo.angle_for_closest_distance);
-          mo.closest_point.z = 0.0;
-        }
-        
-        // Distance from sensor to object at old time
-        const unsigned int nr_object_points_old = (index_min_old <= index_max_old) ? 
-                                                  (index_max_old - index_min_old + 1) :
-                                                  bank_argument.points_per_scan - (index_min_old - index_max_old) + 1;
-        const float distance_old = range_sum_old / nr_object_points_old;
-        // distance is found at index_mean_old, this is the angle at which distance is found
-        const double distance_angle_old = index_mean_old * bank_argument.angle_increment + bank_argument.angle_min;
-        // Covered angle
-        const double covered_angle_old = nr_object_points_old * bank_argument.angle_increment;
-        // Width of old object
-        const double object_seen_width_old = sqrt( range_at_min_index_old * 
-                                                   range_at_min_index_old + 
-                                                   range_at_max_index_old * 
-                                                   range_at_max_index_old - 
-                                                   2 * range_at_min_index_old * 
-                                                       range_at_max_index_old * 
-                                                       cosf (covered_angle_old)
-                                                 ); // This is the seen object width using the law of cosine
-        // Coordinates at old time
-        double x_old;
-        double y_old;
-        double z_old;
-        
-        if (bank_argument.sensor_frame_has_z_axis_forward)
-        {
-          // Yes, Z-axis forward, X-axis right, Y-axis down
-          x_old = - distance_old * sinf(distance_angle_old);
-          y_old = 0.0;
-          z_old = distance_old * cosf(distance_angle_old);
-        }
-        else
+        // Adapt EMA message intensities
+        if (report_ema)
         {
-          x_old = distance_old * cosf(distance_angle_old);
-          y_old = distance_old * sinf(distance_angle_old);
-          z_old = 0.0;
+          // Are we avoiding wrapping around the bank edges?
+          if (to.index_min <= to.index_max)
+          {
+            // YES
+            for (unsigned int k=to.index_min; k<=to.index_max; ++k)
+            {
+              msg_ema->intensities[k] = 300.0f;
+            }
+          }
+          else
+          {
+            // NO - we are wrapping around
+            // index_max < index_min
+            for (unsigned int k=to.index_min; k<bank_argument.points_per_scan; ++k)
+            {
+              msg_ema->intensities[k] = 300.0f;
+            }
+            for (unsigned int k=0; k<to.index_max; ++k)
+            {
+              msg_ema->intensities[k] = 300.0f;
+            }
+          }
         }
         
-        mo_old_positions.position.x = x_old;
-        mo_old_positions.position.y = y_old;
-        mo_old_positions.position.z = z_old;
-        
-        // Lookup transformation from old position of sensor_frame to new location of sensor_frame
-//         bool transform_old_time_map_frame_success = false;
-//         bool transform_new_time_map_frame_success = false;
-// //         tf::StampedTransform transform_map_frame_old_time;
-// //         tf::StampedTransform transform_map_frame_new_time;
-//         geometry_msgs::TransformStamped transform_map_frame_old_time;
-//         geometry_msgs::TransformStamped transform_map_frame_new_time;
-//         bool transform_old_time_fixed_frame_success = false;
-//         bool transform_new_time_fixed_frame_success = false;
-// //         tf::StampedTransform transform_fixed_frame_old_time;
-// //         tf::StampedTransform transform_fixed_frame_new_time;
-//         geometry_msgs::TransformStamped transform_fixed_frame_old_time;
-//         geometry_msgs::TransformStamped transform_fixed_frame_new_time;
-//         bool transform_old_time_base_frame_success = false;
-//         bool transform_new_time_base_frame_success = false;
-// //         tf::StampedTransform transform_base_frame_old_time;
-// //         tf::StampedTransform transform_base_frame_new_time;
-//         geometry_msgs::TransformStamped transform_base_frame_old_time;
-//         geometry_msgs::TransformStamped transform_base_frame_new_time;
-        
-//         // Map frame
-//         // OLD time
-//         try
-//         {
-// //           const bool transform_available = 
-// //           tf_listener->waitForTransform(bank_argument.map_frame,  // Target
-// //                                        bank_argument.sensor_frame, // Source
-// //                                        ros::Time(bank_stamp[bank_index_put]), 
-// //                                        ros::Duration(1.0)); // Timeout
-// //           if (transform_available)
-// //           {
-// //             tf_listener->lookupTransform(bank_argument.map_frame, 
-// //                                         bank_argument.sensor_frame, 
-// //                                         ros::Time(bank_stamp[bank_index_put]),
-// //                                         transform_map_frame_old_time); // Resulting transform
-//           transform_map_frame_old_time = tf_buffer->lookupTransform(bank_argument.map_frame, 
-//                                                                    bank_argument.sensor_frame, 
-//                                                                    ros::Time(bank_stamp[bank_index_put]));
-//           transform_old_time_map_frame_success = true;
-// //           }
-//             
-// //           else
-// //           {
-// //             ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
-// //                       bank_argument.map_frame.c_str(), bank_stamp[bank_index_put]);
-// //           }
-//           
-//         }
-//         catch (tf2::TransformException ex)
-//         {
-//           ROS_ERROR("Cannot determine transform from %s to %s at old time %f.\n%s",
-//                     bank_argument.sensor_frame.c_str(), 
-//                     bank_argument.map_frame.c_str(), 
-//                     bank_stamp[bank_index_put], 
-//                     ex.what());
-// //           ROS_ERROR("%s", ex.what());
-// //           transform_old_time_map_frame_success = false;
-//         }
-//         
-//         // NEW time
-//         try
-//         {
-//           const bool transform_available = 
-//           tf_listener->waitForTransform(bank_argument.map_frame,  // Target
-//                                        bank_argument.sensor_frame, // Source
-//                                        ros::Time(bank_stamp[bank_index_newest]), 
-//                                        ros::Duration(1.0)); // Timeout
-//           if (transform_available)
-//           {
-//             tf_listener->lookupTransform(bank_argument.map_frame, 
-//                                         bank_argument.sensor_frame, 
-//                                         ros::Time(bank_stamp[bank_index_newest]),
-//                                         transform_map_frame_new_time); // Resulting transform
-//           }
-//           else
-//           {
-//             ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), \
-//                       bank_argument.map_frame.c_str(), bank_stamp[bank_index_newest]);
-//           }
-//         }
-//         catch (tf::TransformException ex)
-//         {
-//           ROS_ERROR("%s", ex.what());
-//           transform_new_time_map_frame_success = false;
-//         }
-//         
-//         // Fixed frame
-//         // OLD time
-//         try
-//         {
-//           const bool transform_available = 
-//           tf_listener->waitForTransform(bank_argument.fixed_frame,  // Target
-//                                        bank_argument.sensor_frame, // Source
-//                                        ros::Time(bank_stamp[bank_index_put]), 
-//                                        ros::Duration(1.0)); // Timeout
-//           if (transform_available)
-//           {
-//             tf_listener->lookupTransform(bank_argument.fixed_frame, 
-//                                         bank_argument.sensor_frame, 
-//                                         ros::Time(bank_stamp[bank_index_put]),
-//                                         transform_fixed_frame_old_time); // Resulting transform
-//           }
-//           else
-//           {
-//             ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
-//                       bank_argument.fixed_frame.c_str(), bank_stamp[bank_index_put]);
-//           }
-//         }
-//         catch (tf::TransformException ex)
-//         {
-//           ROS_ERROR("%s", ex.what());
-//           transform_old_time_fixed_frame_success = false;
-//         }
-//         
-//         // NEW time
-//         try
-//         {
-//           const bool transform_available = 
-//           tf_listener->waitForTransform(bank_argument.fixed_frame,  // Target
-//                                        bank_argument.sensor_frame, // Source
-//                                        ros::Time(bank_stamp[bank_index_newest]), 
-//                                        ros::Duration(1.0)); // Timeout
-//           if (transform_available)
-//           {
-//             tf_listener->lookupTransform(bank_argument.fixed_frame, 
-//                                         bank_argument.sensor_frame, 
-//                                         ros::Time(bank_stamp[bank_index_newest]),
-//                                         transform_fixed_frame_new_time); // Resulting transform
-//           }
-//           else
-//           {
-//             ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), \
-//                       bank_argument.fixed_frame.c_str(), bank_stamp[bank_index_newest]);
-//           }
-//         }
-//         catch (tf::TransformException ex)
-//         {
-//           ROS_ERROR("%s", ex.what());
-//           transform_new_time_fixed_frame_success = false;
-//         }
-//         
-//         // Base frame
-//         // OLD time
-//         try
-//         {
-//           const bool transform_available = 
-//           tf_listener->waitForTransform(bank_argument.base_frame,  // Target
-//                                        bank_argument.sensor_frame, // Source
-//                                        ros::Time(bank_stamp[bank_index_put]), 
-//                                        ros::Duration(1.0)); // Timeout
-//           if (transform_available)
-//           {
-//             tf_listener->lookupTransform(bank_argument.base_frame, 
-//                                         bank_argument.sensor_frame, 
-//                                         ros::Time(bank_stamp[bank_index_put]),
-//                                         transform_base_frame_old_time); // Resulting transform
-//           }
-//           else
-//           {
-//             ROS_ERROR("Cannot determine transform from %s to %s at old time %f.", bank_argument.sensor_frame.c_str(), \
-//                       bank_argument.base_frame.c_str(), bank_stamp[bank_index_put]);
-//           }
-//         }
-//         catch (tf::TransformException ex)
-//         {
-//           ROS_ERROR("%s", ex.what());
-//           transform_old_time_base_frame_success = false;
-//         }
-//         
-//         // NEW time
-//         try
-//         {
-//           const bool transform_available = 
-//           tf_listener->waitForTransform(bank_argument.base_frame,  // Target
-//                                        bank_argument.sensor_frame, // Source
-//                                        ros::Time(bank_stamp[bank_index_newest]), 
-//                                        ros::Duration(1.0)); // Timeout
-//           if (transform_available)
-//           {
-//             tf_listener->lookupTransform(bank_argument.base_frame, 
-//                                         bank_argument.sensor_frame, 
-//                                         ros::Time(bank_stamp[bank_index_newest]),
-//                                         transform_base_frame_new_time); // Resulting transform
-//           }
-//           else
-//           {
-//             ROS_ERROR("Cannot determine transform from %s to %s at new time %f.", bank_argument.sensor_frame.c_str(), 
-//                       bank_argument.base_frame.c_str(), bank_stamp[bank_index_newest]);
-//           }
-//         }
-//         catch (tf::TransformException ex)
-//         {
-//           ROS_ERROR("%s", ex.what());
-//           transform_new_time_base_frame_success = false;
-//         }
-//         
-//         // Coordinates translated
-//         tf::Stamped<tf::Point> old_point(tf::Point(x_old, y_old, z_old), 
-//                                          ros::Time(bank_stamp[bank_index_put]), 
-//                                          bank_argument.sensor_frame);
-//         tf::Stamped<tf::Point> new_point(tf::Point(mo.position.x, mo.position.y, mo.position.z), 
-//                                          ros::Time(bank_stamp[bank_index_newest]), 
-//                                          bank_argument.sensor_frame);
-//         tf::Stamped<tf::Point> closest_point(tf::Point(mo.closest_point.x, mo.closest_point.y, mo.closest_point.z), 
-//                                              ros::Time(bank_stamp[bank_index_newest]), 
-//                                              bank_argument.sensor_frame);
-//         
-//         tf::Point old_point_in_map_frame;
-//         tf::Point new_point_in_map_frame;
-//         tf::Point closest_point_in_map_frame;
-//         
-//         tf::Point old_point_in_fixed_frame;
-//         tf::Point new_point_in_fixed_frame;
-//         tf::Point closest_point_in_fixed_frame;
-//         
-//         tf::Point old_point_in_base_frame;
-//         tf::Point new_point_in_base_frame;
-//         tf::Point closest_point_in_base_frame;
-//         
-//         if (transform_old_time_map_frame_success && transform_new_time_map_frame_success)
-//         {
-//           old_point_in_map_frame = transform_map_frame_old_time * old_point;
-//           new_point_in_map_frame = transform_map_frame_new_time * new_point;
-//           closest_point_in_map_frame = transform_map_frame_new_time * closest_point;
-//         }
-//         else
-//         {
-//           old_point_in_map_frame = old_point;
-//           new_point_in_map_frame = new_point;
-//           closest_point_in_map_frame = closest_point;
-//         }
-//         
-//         if (transform_old_time_fixed_frame_success && transform_new_time_fixed_frame_success)
-//         {
-//           old_point_in_fixed_frame = transform_fixed_frame_old_time * old_point;
-//           new_point_in_fixed_frame = transform_fixed_frame_new_time * new_point;
-//           closest_point_in_fixed_frame = transform_fixed_frame_new_time * closest_point;
-//         }
-//         else
-//         {
-//           old_point_in_fixed_frame = old_point;
-//           new_point_in_fixed_frame = new_point;
-//           closest_point_in_fixed_frame = closest_point;
-//         }
-//         
-//         if (transform_old_time_base_frame_success && transform_new_time_base_frame_success)
-//         {
-//           old_point_in_base_frame = transform_base_frame_old_time * old_point;
-//           new_point_in_base_frame = transform_base_frame_new_time * new_point;
-//           closest_point_in_base_frame = transform_base_frame_new_time * closest_point;
-//         }
-//         else
-//         {
-//           old_point_in_base_frame = old_point;
-//           new_point_in_base_frame = new_point;
-//           closest_point_in_base_frame = closest_point;
-//         }
-        
-        geometry_msgs::PointStamped in;
-        geometry_msgs::PointStamped out;
-        
-        // Transform old point into map, fixed and base frames at old_time
-        in.header.frame_id = bank_argument.sensor_frame;
-        in.header.stamp = old_time;
-        in.point = mo_old_positions.position;
-        
-        try {
-          tf_buffer->transform(in, // mo_old_positions.position, 
-                              out, // mo_old_positions.position_in_map_frame, 
-                              bank_argument.map_frame, 
-                              old_time,
-                              bank_argument.fixed_frame);
-          mo_old_positions.position_in_map_frame = out.point;
-          
-          
-          tf_buffer->transform(in, // mo_old_positions.position, 
-                              out, // mo_old_positions.position_in_fixed_frame, 
-                              bank_argument.fixed_frame, 
-                              old_time,
-                              bank_argument.fixed_frame);
-          mo_old_positions.position_in_fixed_frame = out.point;
-          
-          tf_buffer->transform(in, // mo_old_positions.position, 
-                              out, // mo_old_positions.position_in_base_frame, 
-                              bank_argument.base_frame, 
-                              old_time,
-                              bank_argument.fixed_frame);
-          mo_old_positions.position_in_base_frame = out.point;
-          
-          // Transform new point into map, fixed and base frames at new_time
-          in.header.stamp = new_time;
-          in.point = mo.position;
-          
-          tf_buffer->transform(in, // mo.position, 
-                              out, // mo.position_in_map_frame, 
-                              bank_argument.map_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.position_in_map_frame = out.point;
-          
-          tf_buffer->transform(in, // mo.position, 
-                              out, // mo.position_in_fixed_frame, 
-                              bank_argument.fixed_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.position_in_fixed_frame = out.point;
-          
-          tf_buffer->transform(in, // mo.position, 
-                              out, // mo.position_in_base_frame, 
-                              bank_argument.base_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.position_in_base_frame = out.point;
-          
-          // Transform closest point into map, fixed and base frames at new_time
-          in.point = mo.closest_point;
-          
-          tf_buffer->transform(in, // mo.closest_point, 
-                              out, // mo.closest_point_in_map_frame, 
-                              bank_argument.map_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.closest_point_in_map_frame = out.point;
-          
-          tf_buffer->transform(in, // mo.closest_point, 
-                              out, // mo.closest_point_in_fixed_frame, 
-                              bank_argument.fixed_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.closest_point_in_fixed_frame = out.point;
-          
-          tf_buffer->transform(in, // mo.closest_point, 
-                              out, // mo.closest_point_in_base_frame, 
-                              bank_argument.base_frame, 
-                              new_time,
-                              bank_argument.fixed_frame);
-          mo.closest_point_in_base_frame = out.point;
-        } 
-        catch (tf2::TransformException e)
-        {
-          ROS_ERROR_STREAM("Caught some exception: " << e.what());
-        }
-        
-        // Check how object has moved
-        const double dx_map    = mo.position_in_map_frame.x   - mo_old_positions.position_in_map_frame.x;
-        const double dy_map    = mo.position_in_map_frame.y   - mo_old_positions.position_in_map_frame.y;
-        const double dz_map    = mo.position_in_map_frame.z   - mo_old_positions.position_in_map_frame.z;
-        const double dx_fixed  = mo.position_in_fixed_frame.x - mo_old_positions.position_in_fixed_frame.x;
-        const double dy_fixed  = mo.position_in_fixed_frame.y - mo_old_positions.position_in_fixed_frame.y;
-        const double dz_fixed  = mo.position_in_fixed_frame.z - mo_old_positions.position_in_fixed_frame.z;
-        const double dx_base   = mo.position_in_base_frame.x  - mo_old_positions.position_in_base_frame.x;
-        const double dy_base   = mo.position_in_base_frame.y  - mo_old_positions.position_in_base_frame.y;
-        const double dz_base   = mo.position_in_base_frame.z  - mo_old_positions.position_in_base_frame.z;
-        const double dx_sensor = mo.position.x - x_old;
-        const double dy_sensor = mo.position.y - y_old;
-        const double dz_sensor = mo.position.z - z_old;
-        
-        
-//         // Set old position in map_frame
-//         mo_old_positions.position_in_map_frame.x = old_point_in_map_frame.x();
-//         mo_old_positions.position_in_map_frame.y = old_point_in_map_frame.y();
-//         mo_old_positions.position_in_map_frame.z = old_point_in_map_frame.z();
-//         
-//         // Set old position in fixed_frame
-//         mo_old_positions.position_in_fixed_frame.x = old_point_in_fixed_frame.x();
-//         mo_old_positions.position_in_fixed_frame.y = old_point_in_fixed_frame.y();
-//         mo_old_positions.position_in_fixed_frame.z = old_point_in_fixed_frame.z();
-//         
-//         // Set old position in base_frame
-//         mo_old_positions.position_in_base_frame.x = old_point_in_base_frame.x();
-//         mo_old_positions.position_in_base_frame.y = old_point_in_base_frame.y();
-//         mo_old_positions.position_in_base_frame.z = old_point_in_base_frame.z();
-//         
-//         // Set position in map_frame
-//         mo.position_in_map_frame.x = new_point_in_map_frame.x();
-//         mo.position_in_map_frame.y = new_point_in_map_frame.y();
-//         mo.position_in_map_frame.z = new_point_in_map_frame.z();
-//         
-//         // Set position in fixed_frame
-//         mo.position_in_fixed_frame.x = new_point_in_fixed_frame.x();
-//         mo.position_in_fixed_frame.y = new_point_in_fixed_frame.y();
-//         mo.position_in_fixed_frame.z = new_point_in_fixed_frame.z();
-//         
-//         // Set position in base_frame
-//         mo.position_in_base_frame.x = new_point_in_base_frame.x();
-//         mo.position_in_base_frame.y = new_point_in_base_frame.y();
-//         mo.position_in_base_frame.z = new_point_in_base_frame.z();
-//         
-//         // Set closest point in map_frame
-//         mo.closest_point_in_map_frame.x = closest_point_in_map_frame.x();
-//         mo.closest_point_in_map_frame.y = closest_point_in_map_frame.y();
-//         mo.closest_point_in_map_frame.z = closest_point_in_map_frame.z();
-//         
-//         // Set closest point in fixed_frame
-//         mo.closest_point_in_fixed_frame.x = closest_point_in_fixed_frame.x();
-//         mo.closest_point_in_fixed_frame.y = closest_point_in_fixed_frame.y();
-//         mo.closest_point_in_fixed_frame.z = closest_point_in_fixed_frame.z();
-//         
-//         // Set closest point in base_frame
-//         mo.closest_point_in_base_frame.x = closest_point_in_base_frame.x();
-//         mo.closest_point_in_base_frame.y = closest_point_in_base_frame.y();
-//         mo.closest_point_in_base_frame.z = closest_point_in_base_frame.z();
-//         
-//         // Check how object has moved
-//         const float dx_map =   new_point_in_map_frame.x() -   old_point_in_map_frame.x();
-//         const float dy_map =   new_point_in_map_frame.y() -   old_point_in_map_frame.y();
-//         const float dz_map =   new_point_in_map_frame.z() -   old_point_in_map_frame.z();
-//         const float dx_fixed = new_point_in_fixed_frame.x() - old_point_in_fixed_frame.x();
-//         const float dy_fixed = new_point_in_fixed_frame.y() - old_point_in_fixed_frame.y();
-//         const float dz_fixed = new_point_in_fixed_frame.z() - old_point_in_fixed_frame.z();
-//         const float dx_base =  new_point_in_base_frame.x() -  old_point_in_base_frame.x();
-//         const float dy_base =  new_point_in_base_frame.y() -  old_point_in_base_frame.y();
-//         const float dz_base =  new_point_in_base_frame.z() -  old_point_in_base_frame.z();
-//         const float dx_sensor = mo.position.x - x_old;
-//         const float dy_sensor = mo.position.y - y_old;
-//         const float dz_sensor = mo.position.z - z_old;
-        
-        // And with what velocity
-//         const double dt = bank_stamp[bank_index_newest] - bank_stamp[bank_index_put];
-        const double dt = mo.header.stamp.toSec() - bank_stamp[bank_index_put];
-//         ROS_ERROR_STREAM("newest stamp = " << mo.header.stamp.toSec() << std::endl << "oldest stamp = " << bank_stamp[bank_index_put] << std::endl << "dt = " << dt << std::endl);
-        mo.velocity.x = dx_sensor / dt;
-        mo.velocity.y = dy_sensor / dt;
-        mo.velocity.z = dz_sensor / dt;
-        mo.velocity_in_map_frame.x = dx_map / dt;
-        mo.velocity_in_map_frame.y = dy_map / dt;
-        mo.velocity_in_map_frame.z = dz_map / dt;
-        mo.velocity_in_fixed_frame.x = dx_fixed / dt;
-        mo.velocity_in_fixed_frame.y = dy_fixed / dt;
-        mo.velocity_in_fixed_frame.z = dz_fixed / dt;
-        mo.velocity_in_base_frame.x = dx_base / dt;
-        mo.velocity_in_base_frame.y = dy_base / dt;
-        mo.velocity_in_base_frame.z = dz_base / dt;
-        
-        // Calculate speed and normalized velocity
-        mo.speed = sqrt(mo.velocity.x * mo.velocity.x  +  
-                        mo.velocity.y * mo.velocity.y  +  
-                        mo.velocity.z * mo.velocity.z);
-        mo.speed_in_map_frame = sqrt(mo.velocity_in_map_frame.x * mo.velocity_in_map_frame.x  +
-                                     mo.velocity_in_map_frame.y * mo.velocity_in_map_frame.y  +
-                                     mo.velocity_in_map_frame.z * mo.velocity_in_map_frame.z);
-        mo.speed_in_fixed_frame = sqrt(mo.velocity_in_fixed_frame.x * mo.velocity_in_fixed_frame.x  +
-                                       mo.velocity_in_fixed_frame.y * mo.velocity_in_fixed_frame.y  +
-                                       mo.velocity_in_fixed_frame.z * mo.velocity_in_fixed_frame.z);
-        mo.speed_in_base_frame = sqrt(mo.velocity_in_base_frame.x * mo.velocity_in_base_frame.x  +
-                                      mo.velocity_in_base_frame.y * mo.velocity_in_base_frame.y  +
-                                      mo.velocity_in_base_frame.z * mo.velocity_in_base_frame.z);
-        
-        // Avoid division by 0
-        if (0 < mo.speed)
-        {
-          mo.velocity_normalized.x = mo.velocity.x / mo.speed;
-          mo.velocity_normalized.y = mo.velocity.y / mo.speed;
-          mo.velocity_normalized.z = mo.velocity.z / mo.speed;
-        }
-        else
-        {
-          mo.velocity_normalized.x = 0.0;
-          mo.velocity_normalized.y = 0.0;
-          mo.velocity_normalized.z = 0.0;
-        }
-        if (0 < mo.speed_in_map_frame)
-        {
-          mo.velocity_normalized_in_map_frame.x = mo.velocity_in_map_frame.x / mo.speed_in_map_frame;
-          mo.velocity_normalized_in_map_frame.y = mo.velocity_in_map_frame.y / mo.speed_in_map_frame;
-          mo.velocity_normalized_in_map_frame.z = mo.velocity_in_map_frame.z / mo.speed_in_map_frame;
-        }
-        else
-        {
-          mo.velocity_normalized_in_map_frame.x = 0.0;
-          mo.velocity_normalized_in_map_frame.y = 0.0;
-          mo.velocity_normalized_in_map_frame.z = 0.0;
-        }
-        if (0 < mo.speed_in_fixed_frame)
-        {
-          mo.velocity_normalized_in_fixed_frame.x = mo.velocity_in_fixed_frame.x / mo.speed_in_fixed_frame;
-          mo.velocity_normalized_in_fixed_frame.y = mo.velocity_in_fixed_frame.y / mo.speed_in_fixed_frame;
-          mo.velocity_normalized_in_fixed_frame.z = mo.velocity_in_fixed_frame.z / mo.speed_in_fixed_frame;
-        }
-        else
-        {
-          mo.velocity_normalized_in_fixed_frame.x = 0.0;
-          mo.velocity_normalized_in_fixed_frame.y = 0.0;
-          mo.velocity_normalized_in_fixed_frame.z = 0.0;
-        }
-        if (0 < mo.speed_in_base_frame)
-        {
-          mo.velocity_normalized_in_base_frame.x = mo.velocity_in_base_frame.x / mo.speed_in_base_frame;
-          mo.velocity_normalized_in_base_frame.y = mo.velocity_in_base_frame.y / mo.speed_in_base_frame;
-          mo.velocity_normalized_in_base_frame.z = mo.velocity_in_base_frame.z / mo.speed_in_base_frame;
-        }
-        else
-        {
-          mo.velocity_normalized_in_base_frame.x = 0.0;
-          mo.velocity_normalized_in_base_frame.y = 0.0;
-          mo.velocity_normalized_in_base_frame.z = 0.0;
-        }
-        
-        // Threshold check
-        if (bank_argument.object_threshold_min_speed <= mo.speed || 
-            bank_argument.object_threshold_min_speed <= mo.speed_in_map_frame || 
-            bank_argument.object_threshold_min_speed <= mo.speed_in_fixed_frame || 
-            bank_argument.object_threshold_min_speed <= mo.speed_in_base_frame)
-        {
-          // We believe that the object is moving in relation to at least one of the frames
-          ROS_DEBUG_STREAM("Moving object:" << std::endl \
-                        << "               (sensor)  x=" << std::setw(12) << std::left << mo.position.x \
-                        <<                       "   y=" << std::setw(12) << std::left << mo.position.y \
-                        <<                       "   z=" << std::setw(12) << std::left << mo.position.z \
-                        <<                       std::endl \
-                        << "                        vx=" << std::setw(12) << std::left << mo.velocity.x \
-                        <<                       "  vy=" << std::setw(12) << std::left << mo.velocity.y \
-                        <<                       "  vz=" << std::setw(12) << std::left << mo.velocity.z \
-                        <<                       "  speed=" << mo.speed \
-                        <<                       std::endl \
-                        << "               (map)     x=" << std::setw(12) << std::left << mo.position_in_map_frame.x  \
-                        <<                       "   y=" << std::setw(12) << std::left << mo.position_in_map_frame.y \
-                        <<                       "   z=" << std::setw(12) << std::left << mo.position_in_map_frame.z \
-                        <<                       std::endl \
-                        << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_map_frame.x \
-                        <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_map_frame.y \
-                        <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_map_frame.z  \
-                        <<                       "  speed=" << mo.speed_in_map_frame \
-                        <<                       std::endl \
-                        << "               (fixed)   x=" << std::setw(12) << std::left << mo.position_in_fixed_frame.x \
-                        <<                       "   y=" << std::setw(12) << std::left << mo.position_in_fixed_frame.y \
-                        <<                       "   z=" << std::setw(12) << std::left << mo.position_in_fixed_frame.z \
-                        <<                       std::endl \
-                        << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.x \
-                        <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.y \
-                        <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_fixed_frame.z \
-                        <<                       "  speed=" << mo.speed_in_fixed_frame \
-                        <<                       std::endl \
-                        << "               (base)    x=" << std::setw(12) << std::left << mo.position_in_base_frame.x \
-                        <<                       "   y=" << std::setw(12) << std::left << mo.position_in_base_frame.y \
-                        <<                       "   z=" << std::setw(12) << std::left << mo.position_in_base_frame.z \
-                        <<                       std::endl \
-                        << "                        vx=" << std::setw(12) << std::left << mo.velocity_in_base_frame.x \
-                        <<                       "  vy=" << std::setw(12) << std::left << mo.velocity_in_base_frame.y \
-                        <<                       "  vz=" << std::setw(12) << std::left << mo.velocity_in_base_frame.z \
-                        <<                       "  speed=" << mo.speed_in_base_frame \
-                        <<                       std::endl);
-          
-          // Calculate confidence value using the user-defined function
-          mo.confidence = calculateConfidence(mo, 
-                                              bank_argument, 
-                                              dt, 
-                                              object_seen_width_old);
-          
-          // Bound the value to [0,1]
-          mo.confidence = (mo.confidence < 0.0  ?  0.0  :  mo.confidence);
-          mo.confidence = (mo.confidence < 1.0  ?  mo.confidence  :  1.0);
-          
-          // Are we confident enough to report this object?
-          if (bank_argument.object_threshold_min_confidence <= mo.confidence)
-          {
-            // Adapt EMA message intensities
-            if (bank_argument.publish_ema)
-            {
-              // Are we avoiding wrapping around the bank edges?
-              if (index_min <= index_max)
-              {
-                // YES
-                for (unsigned int k=index_min; k<=index_max; ++k)
-                {
-                  msg_ema.intensities[k] = 300.0f;
-                }
-              }
-              else
-              {
-                // NO - we are wrapping around
-                // index_max < index_min
-                for (unsigned int k=index_min; k<bank_argument.points_per_scan; ++k)
-                {
-                  msg_ema.intensities[k] = 300.0f;
-                }
-                for (unsigned int k=0; k<index_max; ++k)
-                {
-                  msg_ema.intensities[k] = 300.0f;
-                }
-              }
-            }
-            
-            // Push back the moving object info to the msg
-            moa.objects.push_back(mo);
-            moa_old_positions.objects.push_back(mo_old_positions);
-          }
-        }
+        // Keep the moving object in the msg
+        nr_reported_objects++;
       }
     }
-    
-    i = index_at_angle_end + 1;
-    nr_object_points = 0;
   }
   
+  // Remove the objects that are not reported
+  resizeElements(moa->objects, spare_objects, nr_reported_objects, object_prototype);
+  
   // Filter found objects
 //   mergeFoundObjects(&moa);
   
   // Moving object array message
   ++moa_seq;
-  if (bank_argument.publish_objects && 0 < moa.objects.size())
+  if (bank_argument.publish_objects && 0 < moa->objects.size())
   {
-    moa.origin_node_name = ros::this_node::getName() + bank_argument.node_name_suffix;
-    
     // Publish MOA message
-    pub_objects.publish(moa);
+    publish(pub_objects, moa);
+  }
+  
+  // Compact moving object array message, with the same objects
+  if (bank_argument.publish_objects_compact && 0 < moa->objects.size())
+  {
+    reuseMessage(msg_objects_compact_pool, msg_objects_compact);
+    const unsigned int nr_objects = moa->objects.size();
+    countAllocation(msg_objects_compact->objects.capacity() < nr_objects);
+    msg_objects_compact->objects.resize(nr_objects);
+    for (unsigned int i=0; i<nr_objects; ++i)
+    {
+      compactObject(moa->objects[i], &msg_objects_compact->objects[i]);
+    }
+    msg_objects_compact->header.seq = moa_seq;
+    msg_objects_compact->header.stamp = moa->objects[0].header.stamp;
+    
+    // Publish compact MOA message
+    publish(pub_objects_compact, msg_objects_compact);
   }
   
   // Save timestamp
   ros::Time now = ros::Time::now();
   
   // EMA message
-  if (bank_argument.publish_ema)
+  if (report_ema)
   {
     // Copy ranges and set header
-    memcpy(msg_ema.ranges.data(), &bank_ranges_ema[bank_index_newest][0], bank_ranges_bytes);
-    msg_ema.header.seq = moa_seq;
-    msg_ema.header.stamp = now;
+    memcpy(msg_ema->ranges.data(), core.getNewestRanges(), bank_ranges_bytes);
+    msg_ema->header.seq = moa_seq;
+    msg_ema->header.stamp = now;
     
     // Publish EMA message
-    pub_ema.publish(msg_ema);
+    publish(pub_ema, msg_ema);
   }
   
-  // Update headers of the marker, arrow, delta position and width messages
-  if (bank_argument.publish_objects_closest_point_markers)
+  // Update header of the marker message, and make room for one arrow, delta position and width marker per object; 
+  // the markers are updated in place, their headers below
+  const unsigned int nr_moving_objects_found = moa->objects.size();
+  if (report_closest_point_markers)
   {
-    msg_objects_closest_point_markers.header.stamp = now;
-    msg_objects_closest_point_markers.header.seq = moa_seq;
+    msg_objects_closest_point_markers->header.stamp = now;
+    msg_objects_closest_point_markers->header.seq = moa_seq;
   }
-  if (bank_argument.publish_objects_velocity_arrows)
+  if (report_velocity_arrows)
   {
-    msg_objects_velocity_arrow.header.stamp = now;
-    msg_objects_velocity_arrow.header.seq = moa_seq;
+    resizeElements(msg_objects_velocity_arrows->markers, spare_velocity_arrows, 
+                   nr_moving_objects_found, msg_objects_velocity_arrow);
   }
-  if (bank_argument.publish_objects_delta_position_lines)
+  if (report_delta_position_lines)
   {
-    msg_objects_delta_position_line.header.stamp = now;
-    msg_objects_delta_position_line.header.seq = moa_seq;
+    resizeElements(msg_objects_delta_position_lines->markers, spare_delta_position_lines, 
+                   nr_moving_objects_found, msg_objects_delta_position_line);
   }
-  if (bank_argument.publish_objects_width_lines)
+  if (report_width_lines)
   {
-    msg_objects_width_line.header.stamp = now;
-    msg_objects_width_line.header.seq = moa_seq;
+    resizeElements(msg_objects_width_lines->markers, spare_width_lines, 
+                   nr_moving_objects_found, msg_objects_width_line);
   }
   
   // Go through found objects
   MovingObject * mo;
   MovingObject * mo_old_positions;
-  const unsigned int nr_moving_objects_found = moa.objects.size();
   for (unsigned int i=0; i<nr_moving_objects_found; ++i)
   {
-    mo = &moa.objects[i];
+    mo = &moa->objects[i];
     mo_old_positions = &moa_old_positions.objects[i];
     
     // Laserscan Marker (square)
-    if (bank_argument.publish_objects_closest_point_markers)
+    if (report_closest_point_markers)
     {
       // Find index for closest range for this object - reverse calculation
       const unsigned int distance_min_index = 
         round((mo->angle_for_closest_distance - bank_argument.angle_min) / bank_argument.angle_increment);
-      msg_objects_closest_point_markers.ranges[distance_min_index] = mo->closest_distance;
-      msg_objects_closest_point_markers.intensities[distance_min_index] = 1000;
+      msg_objects_closest_point_markers->ranges[distance_min_index] = mo->closest_distance;
+      msg_objects_closest_point_markers->intensities[distance_min_index] = 1000;
     }
     
     // Visualization Marker (velocity arrow)
-    if (bank_argument.publish_objects_velocity_arrows)
+    if (report_velocity_arrows)
     {
-      msg_objects_velocity_arrow.id = i;
+      visualization_msgs::Marker & velocity_arrow = msg_objects_velocity_arrows->markers[i];
+      velocity_arrow.header.stamp = now;
+      velocity_arrow.header.seq = moa_seq;
+      velocity_arrow.id = i;
       if (bank_argument.velocity_arrows_use_sensor_frame)
       {
         // Origin: (the size of points is 2)
-        msg_objects_velocity_arrow.points[0].x = mo->position.x;
-        msg_objects_velocity_arrow.points[0].y = mo->position.y;
-        msg_objects_velocity_arrow.points[0].z = mo->position.z;
+        velocity_arrow.points[0].x = mo->position.x;
+        velocity_arrow.points[0].y = mo->position.y;
+        velocity_arrow.points[0].z = mo->position.z;
         // End:
-        msg_objects_velocity_arrow.points[1].x = mo->position.x + mo->velocity.x;
-        msg_objects_velocity_arrow.points[1].y = mo->position.y + mo->velocity.y;
-        msg_objects_velocity_arrow.points[1].z = mo->position.z + mo->velocity.z;
+        velocity_arrow.points[1].x = mo->position.x + mo->velocity.x;
+        velocity_arrow.points[1].y = mo->position.y + mo->velocity.y;
+        velocity_arrow.points[1].z = mo->position.z + mo->velocity.z;
       }
       else if (bank_argument.velocity_arrows_use_base_frame)
       {
         // Origin (the size of points is 2)
-        msg_objects_velocity_arrow.points[0].x = mo->position_in_base_frame.x;
-        msg_objects_velocity_arrow.points[0].y = mo->position_in_base_frame.y;
-        msg_objects_velocity_arrow.points[0].z = mo->position_in_base_frame.z;
+        velocity_arrow.points[0].x = mo->position_in_base_frame.x;
+        velocity_arrow.points[0].y = mo->position_in_base_frame.y;
+        velocity_arrow.points[0].z = mo->position_in_base_frame.z;
         // End:
-        msg_objects_velocity_arrow.points[1].x = mo->position_in_base_frame.x + mo->velocity_in_base_frame.x;
-        msg_objects_velocity_arrow.points[1].y = mo->position_in_base_frame.y + mo->velocity_in_base_frame.y;
-        msg_objects_velocity_arrow.points[1].z = mo->position_in_base_frame.z + mo->velocity_in_base_frame.z;
+        velocity_arrow.points[1].x = mo->position_in_base_frame.x + mo->velocity_in_base_frame.x;
+        velocity_arrow.points[1].y = mo->position_in_base_frame.y + mo->velocity_in_base_frame.y;
+        velocity_arrow.points[1].z = mo->position_in_base_frame.z + mo->velocity_in_base_frame.z;
       }
       else if (bank_argument.velocity_arrows_use_fixed_frame)
       {
         // Origin (the size of points is 2)
-        msg_objects_velocity_arrow.points[0].x = mo->position_in_fixed_frame.x;
-        msg_objects_velocity_arrow.points[0].y = mo->position_in_fixed_frame.y;
-        msg_objects_velocity_arrow.points[0].z = mo->position_in_fixed_frame.z;
+        velocity_arrow.points[0].x = mo->position_in_fixed_frame.x;
+        velocity_arrow.points[0].y = mo->position_in_fixed_frame.y;
+        velocity_arrow.points[0].z = mo->position_in_fixed_frame.z;
         // End:
-        msg_objects_velocity_arrow.points[1].x = mo->position_in_fixed_frame.x + mo->velocity_in_fixed_frame.x;
-        msg_objects_velocity_arrow.points[1].y = mo->position_in_fixed_frame.y + mo->velocity_in_fixed_frame.y;
-        msg_objects_velocity_arrow.points[1].z = mo->position_in_fixed_frame.z + mo->velocity_in_fixed_frame.z;
+        velocity_arrow.points[1].x = mo->position_in_fixed_frame.x + mo->velocity_in_fixed_frame.x;
+        velocity_arrow.points[1].y = mo->position_in_fixed_frame.y + mo->velocity_in_fixed_frame.y;
+        velocity_arrow.points[1].z = mo->position_in_fixed_frame.z + mo->velocity_in_fixed_frame.z;
       }
       else
       {
         // Origin (the size of points is 2)
-        msg_objects_velocity_arrow.points[0].x = mo->position_in_map_frame.x;
-        msg_objects_velocity_arrow.points[0].y = mo->position_in_map_frame.y;
-        msg_objects_velocity_arrow.points[0].z = mo->position_in_map_frame.z;
+        velocity_arrow.points[0].x = mo->position_in_map_frame.x;
+        velocity_arrow.points[0].y = mo->position_in_map_frame.y;
+        velocity_arrow.points[0].z = mo->position_in_map_frame.z;
         // End:
-        msg_objects_velocity_arrow.points[1].x = mo->position_in_map_frame.x + mo->velocity_in_map_frame.x;
-        msg_objects_velocity_arrow.points[1].y = mo->position_in_map_frame.y + mo->velocity_in_map_frame.y;
-        msg_objects_velocity_arrow.points[1].z = mo->position_in_map_frame.z + mo->velocity_in_map_frame.z;
+        velocity_arrow.points[1].x = mo->position_in_map_frame.x + mo->velocity_in_map_frame.x;
+        velocity_arrow.points[1].y = mo->position_in_map_frame.y + mo->velocity_in_map_frame.y;
+        velocity_arrow.points[1].z = mo->position_in_map_frame.z + mo->velocity_in_map_frame.z;
       }
       
       // Color of the arrow represents the confidence black=low, white=high
@@ -1930,127 +1491,195 @@ void Bank::findAndReportMovingObjects()
       {
         const double adapted_confidence = (mo->confidence - bank_argument.object_threshold_min_confidence) / 
                                           (1 - bank_argument.object_threshold_min_confidence);
-        msg_objects_velocity_arrow.color.r = adapted_confidence;
-        msg_objects_velocity_arrow.color.g = adapted_confidence;
-        msg_objects_velocity_arrow.color.b = adapted_confidence;
+        velocity_arrow.color.r = adapted_confidence;
+        velocity_arrow.color.g = adapted_confidence;
+        velocity_arrow.color.b = adapted_confidence;
       }
       else
       {
-        msg_objects_velocity_arrow.color.r = mo->confidence;
-        msg_objects_velocity_arrow.color.g = mo->confidence;
-        msg_objects_velocity_arrow.color.b = mo->confidence;
+        velocity_arrow.color.r = mo->confidence;
+        velocity_arrow.color.g = mo->confidence;
+        velocity_arrow.color.b = mo->confidence;
       }
-      
-      // Add to array of markers
-      msg_objects_velocity_arrows.markers.push_back(msg_objects_velocity_arrow);
     }
     
     // Visualization Marker (delta position)
-    if (bank_argument.publish_objects_delta_position_lines)
+    if (report_delta_position_lines)
     {
-      msg_objects_delta_position_line.id = i;
+      visualization_msgs::Marker & delta_position_line = msg_objects_delta_position_lines->markers[i];
+      delta_position_line.header.stamp = now;
+      delta_position_line.header.seq = moa_seq;
+      delta_position_line.id = i;
 
       // Copy line end points
-      msg_objects_delta_position_line.points[0].x = mo_old_positions->position.x;
-      msg_objects_delta_position_line.points[0].y = mo_old_positions->position.y;
-      msg_objects_delta_position_line.points[0].z = mo_old_positions->position.z;
-      msg_objects_delta_position_line.points[1].x = mo->position.x;
-      msg_objects_delta_position_line.points[1].y = mo->position.y;
-      msg_objects_delta_position_line.points[1].z = mo->position.z;
-
-      // Add to array of markers
-      msg_objects_delta_position_lines.markers.push_back(msg_objects_delta_position_line);
+      delta_position_line.points[0].x = mo_old_positions->position.x;
+      delta_position_line.points[0].y = mo_old_positions->position.y;
+      delta_position_line.points[0].z = mo_old_positions->position.z;
+      delta_position_line.points[1].x = mo->position.x;
+      delta_position_line.points[1].y = mo->position.y;
+      delta_position_line.points[1].z = mo->position.z;
     }
     
     // Visualization Marker (width)
-    if (bank_argument.publish_objects_width_lines)
+    if (report_width_lines)
     {
-      msg_objects_width_line.id = i;
+      visualization_msgs::Marker & width_line = msg_objects_width_lines->markers[i];
+      width_line.header.stamp = now;
+      width_line.header.seq = moa_seq;
+      width_line.id = i;
 
       // Calculate line end points
       if (!bank_argument.sensor_frame_has_z_axis_forward)
       {
         // angle_min
-        msg_objects_width_line.points[0].x = mo->distance_at_angle_begin * cosf(mo->angle_begin);
-        msg_objects_width_line.points[0].y = mo->distance_at_angle_begin * sinf(mo->angle_begin);
-        msg_objects_width_line.points[0].z = 0.0;
+        width_line.points[0].x = mo->distance_at_angle_begin * cosf(mo->angle_begin);
+        width_line.points[0].y = mo->distance_at_angle_begin * sinf(mo->angle_begin);
+        width_line.points[0].z = 0.0;
         // angle_max
-        msg_objects_width_line.points[1].x = mo->distance_at_angle_end * cosf(mo->angle_end);
-        msg_objects_width_line.points[1].y = mo->distance_at_angle_end * sinf(mo->angle_end);
-        msg_objects_width_line.points[1].z = 0.0;
+        width_line.points[1].x = mo->distance_at_angle_end * cosf(mo->angle_end);
+        width_line.points[1].y = mo->distance_at_angle_end * sinf(mo->angle_end);
+        width_line.points[1].z = 0.0;
       }
       else
       {
         // angle_min
-        msg_objects_width_line.points[0].x = -mo->distance_at_angle_begin * sinf(mo->angle_begin);
-        msg_objects_width_line.points[0].y = 0.0;
-        msg_objects_width_line.points[0].z = mo->distance_at_angle_begin * cosf(mo->angle_begin);
+        width_line.points[0].x = -mo->distance_at_angle_begin * sinf(mo->angle_begin);
+        width_line.points[0].y = 0.0;
+        width_line.points[0].z = mo->distance_at_angle_begin * cosf(mo->angle_begin);
         // angle_max
-        msg_objects_width_line.points[1].x = -mo->distance_at_angle_end * sinf(mo->angle_end);
-        msg_objects_width_line.points[1].y = 0.0;
-        msg_objects_width_line.points[1].z = mo->distance_at_angle_end * cosf(mo->angle_end);
+        width_line.points[1].x = -mo->distance_at_angle_end * sinf(mo->angle_end);
+        width_line.points[1].y = 0.0;
+        width_line.points[1].z = mo->distance_at_angle_end * cosf(mo->angle_end);
       }
-      
-      // Add to array of markers
-      msg_objects_width_lines.markers.push_back(msg_objects_width_line);
     }
   }
   
   // Publish if we are supposed to
-  if (bank_argument.publish_objects_closest_point_markers)
+  if (report_closest_point_markers)
   {
-    pub_objects_closest_point_markers.publish(msg_objects_closest_point_markers);
+    publish(pub_objects_closest_point_markers, msg_objects_closest_point_markers);
   }
   
   // Dito
-  if (bank_argument.publish_objects_velocity_arrows)
+  if (report_velocity_arrows)
   {
-    pub_objects_velocity_arrows.publish(msg_objects_velocity_arrows);
+    publish(pub_objects_velocity_arrows, msg_objects_velocity_arrows);
   }
   
   // Dito
-  if (bank_argument.publish_objects_delta_position_lines)
+  if (report_delta_position_lines)
   {
-    pub_objects_delta_position_lines.publish(msg_objects_delta_position_lines);
+    publish(pub_objects_delta_position_lines, msg_objects_delta_position_lines);
   }
   
   // Dito
-  if (bank_argument.publish_objects_width_lines)
+  if (report_width_lines)
   {
-    pub_objects_width_lines.publish(msg_objects_width_lines);
+    publish(pub_objects_width_lines, msg_objects_width_lines);
   }
   
-  // Reset range and intensity of markers and delete found objects
-  if (bank_argument.publish_objects_closest_point_markers)
+  // Reset range and intensity of markers; published messages may still be used by their subscribers, 
+  // in which case other messages of their pools are used, whose markers are all reset
+  if (report_closest_point_markers)
   {
-    for (unsigned int i=0; i<nr_moving_objects_found; ++i)
+    if (reuseMessage(msg_objects_closest_point_markers_pool, msg_objects_closest_point_markers))
     {
-      mo = &moa.objects[i];
-      const unsigned int distance_min_index = 
-        round((mo->angle_for_closest_distance - bank_argument.angle_min) / bank_argument.angle_increment);
-      msg_objects_closest_point_markers.ranges[distance_min_index] = msg_objects_closest_point_markers.range_max + 10.0;
-      msg_objects_closest_point_markers.intensities[distance_min_index] = 0.0;
+      for (unsigned int i=0; i<nr_moving_objects_found; ++i)
+      {
+        mo = &moa->objects[i];
+        const unsigned int distance_min_index = 
+          round((mo->angle_for_closest_distance - bank_argument.angle_min) / bank_argument.angle_increment);
+        msg_objects_closest_point_markers->ranges[distance_min_index] = 
+          msg_objects_closest_point_markers->range_max + 10.0;
+        msg_objects_closest_point_markers->intensities[distance_min_index] = 0.0;
+      }
+    }
+    else
+    {
+      std::fill(msg_objects_closest_point_markers->ranges.begin(), msg_objects_closest_point_markers->ranges.end(), 
+                msg_objects_closest_point_markers->range_max + 10.0);
+      bzero(msg_objects_closest_point_markers->intensities.data(), bank_ranges_bytes);
     }
   }
-  if (bank_argument.publish_objects_velocity_arrows)
+  
+  // The markers of the arrays are all updated by the next report, and the ranges of the EMA message too
+  if (report_velocity_arrows)
   {
-    msg_objects_velocity_arrows.markers.clear();
+    reuseMessage(msg_objects_velocity_arrows_pool, msg_objects_velocity_arrows);
   }
-  if (bank_argument.publish_objects_delta_position_lines)
+  if (report_delta_position_lines)
   {
-    msg_objects_delta_position_lines.markers.clear();
+    reuseMessage(msg_objects_delta_position_lines_pool, msg_objects_delta_position_lines);
   }
-  if (bank_argument.publish_objects_width_lines)
+  if (report_width_lines)
   {
-    msg_objects_width_lines.markers.clear();
+    reuseMessage(msg_objects_width_lines_pool, msg_objects_width_lines);
   }
-  if (bank_argument.publish_ema)
+  if (report_ema)
   {
-    bzero(msg_ema.intensities.data(), bank_ranges_bytes);
+    reuseMessage(msg_ema_pool, msg_ema);
+    bzero(msg_ema->intensities.data(), bank_ranges_bytes);
   }
 }
 
 
+/*
+ * Copy an object into its compact form, in the frame of the compact messages
+ */
+void Bank::compactObject(const MovingObject & mo, MovingObjectCompact * compact_mo)
+{
+  const geometry_msgs::Point * position;
+  const geometry_msgs::Vector3 * velocity;
+  const geometry_msgs::Point * closest_point;
+  double speed;
+  if (bank_argument.objects_compact_use_sensor_frame)
+  {
+    position = &mo.position;
+    velocity = &mo.velocity;
+    closest_point = &mo.closest_point;
+    speed = mo.speed;
+  }
+  else if (bank_argument.objects_compact_use_base_frame)
+  {
+    position = &mo.position_in_base_frame;
+    velocity = &mo.velocity_in_base_frame;
+    closest_point = &mo.closest_point_in_base_frame;
+    speed = mo.speed_in_base_frame;
+  }
+  else if (bank_argument.objects_compact_use_fixed_frame)
+  {
+    position = &mo.position_in_fixed_frame;
+    velocity = &mo.velocity_in_fixed_frame;
+    closest_point = &mo.closest_point_in_fixed_frame;
+    speed = mo.speed_in_fixed_frame;
+  }
+  else // map frame
+  {
+    position = &mo.position_in_map_frame;
+    velocity = &mo.velocity_in_map_frame;
+    closest_point = &mo.closest_point_in_map_frame;
+    speed = mo.speed_in_map_frame;
+  }
+  
+  compact_mo->id = mo.header.seq;
+  compact_mo->seen_width = mo.seen_width;
+  compact_mo->distance = mo.distance;
+  compact_mo->closest_distance = mo.closest_distance;
+  compact_mo->angle_for_closest_distance = mo.angle_for_closest_distance;
+  compact_mo->position[0] = position->x;
+  compact_mo->position[1] = position->y;
+  compact_mo->position[2] = position->z;
+  compact_mo->velocity[0] = velocity->x;
+  compact_mo->velocity[1] = velocity->y;
+  compact_mo->velocity[2] = velocity->z;
+  compact_mo->speed = speed;
+  compact_mo->closest_point[0] = closest_point->x;
+  compact_mo->closest_point[1] = closest_point->y;
+  compact_mo->closest_point[2] = closest_point->z;
+  compact_mo->confidence = mo.confidence;
+}
+
+
 /* HANDLING ENDIANNESS */
 void Bank::reverseBytes(byte_t * bytes, unsigned int nr_bytes)
 {
@@ -2068,6 +1697,11 @@ void Bank::reverseBytes(byte_t * bytes, unsigned int nr_bytes)
  * Read offsets and nr of bytes from PointCloud2 message
  */
 int Bank::getOffsetsAndBytes(BankArgument bank_argument, sensor_msgs::PointCloud2::ConstPtr msg)
+{
+  return getOffsetsAndBytes(bank_argument, msg.get());
+}
+
+int Bank::getOffsetsAndBytes(BankArgument bank_argument, const sensor_msgs::PointCloud2 * msg)
 {
   PC2_message_x_offset = -1;
   PC2_message_x_bytes = -1;
@@ -2211,6 +1845,26 @@ int Bank::getOffsetsAndBytes(BankArgument bank_argument, sensor_msgs::PointCloud
       0 <= PC2_message_z_offset &&
       0 <= PC2_message_z_bytes)
   {
+    // Select the decoders for this layout, for messages in the byte order of this CPU and in the reverse byte order
+    PC2_decode_points = selectPointDecoder(PC2_message_x_bytes, 
+                                           PC2_message_y_bytes, 
+                                           PC2_message_z_bytes, 
+                                           PC2_message_x_offset, 
+                                           PC2_message_y_offset, 
+                                           PC2_message_z_offset, 
+                                           false);
+    PC2_decode_points_reversed = selectPointDecoder(PC2_message_x_bytes, 
+                                                    PC2_message_y_bytes, 
+                                                    PC2_message_z_bytes, 
+                                                    PC2_message_x_offset, 
+                                                    PC2_message_y_offset, 
+                                                    PC2_message_z_offset, 
+                                                    true);
+    if (PC2_decode_points == NULL || PC2_decode_points_reversed == NULL)
+    {
+      ROS_ERROR("Cannot read coordinates that are not of type float32 or float64");
+      return -1;
+    }
     return 0;
   }
   else
@@ -2220,281 +1874,153 @@ int Bank::getOffsetsAndBytes(BankArgument bank_argument, sensor_msgs::PointCloud
   }
 }
 
-int Bank::getOffsetsAndBytes(BankArgument bank_argument, const sensor_msgs::PointCloud2 * msg)
+
+/* BANK HANDLING */
+// Assumes that threshold_distance_max < bank[i] (i.e. that values have been reset)
+// and that bank_view_angle is centered at the x-axis.
+// Reads all points from msg and puts them at bank[i] such that i corresponds to the angle at which 
+// the point is found in the x,y plane of the sensor.
+// Tries to fill several i for one and the same point if needed based on the voxel leaf size.
+unsigned int Bank::putPoints(const sensor_msgs::PointCloud2::ConstPtr msg, float * bank_put)
+{
+  return putPoints(msg.get(), bank_put);
+}
+
+unsigned int Bank::putPoints(const sensor_msgs::PointCloud2 * msg, float * bank_put)
 {
-  PC2_message_x_offset = -1;
-  PC2_message_x_bytes = -1;
-  PC2_message_y_offset = -1;
-  PC2_message_y_bytes = -1;
-  PC2_message_z_offset = -1;
-  PC2_message_z_bytes = -1;
   const bool must_reverse_bytes = (msg->is_bigendian != !machine_is_little_endian);
-  const unsigned int fields = msg->fields.size();
-  byte_t tmp_byte4[4]; // Used for reading offset, count = 1 (ROS: uint32)
-  byte_t tmp_byte;     // Used for reading datatype 
+  const int bank_index_max = bank_argument.points_per_scan - 1;
+  const unsigned int points_per_row = msg->row_step / msg->point_step;
+  const unsigned int nr_slices = PC2_binning_workspaces.size();
+  const unsigned int points_per_slice = (points_per_row + nr_slices - 1) / nr_slices;
+  const bool by_column = bank_argument.PC2_bin_organized_cloud_by_column && 1 < msg->height;
   
-  for (unsigned int i=0; i<fields; ++i)
+  // Find the smallest squared range of the points in each bank index, 
+  // the ranges are calculated when all points are added
+  for (unsigned int s=0; s<nr_slices; ++s)
   {
-    // X
-    if (strcmp(bank_argument.PC2_message_x_coordinate_field_name.c_str(), 
-               msg->fields[i].name.c_str()) == 0)
+    PointBinningWorkspace & workspace = PC2_binning_workspaces[s];
+    if (workspace.points_x.size() < points_per_slice)
     {
-      // Read offset
-      memcpy(&tmp_byte4[0], &msg->fields[i].offset, 4);
-      if (must_reverse_bytes)
-      {
-        reverseBytes(tmp_byte4, 4);
-      }
-      memcpy(&PC2_message_x_offset, tmp_byte4, 4);
-      
-      // Read datatype
-      tmp_byte = msg->fields[i].datatype;
-      if (tmp_byte == sensor_msgs::PointField::INT8 || 
-          tmp_byte == sensor_msgs::PointField::UINT8)
-      {
-        PC2_message_x_bytes = 1;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT16 || 
-               tmp_byte == sensor_msgs::PointField::UINT16)
-      {
-        PC2_message_x_bytes = 2;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT32 || 
-               tmp_byte == sensor_msgs::PointField::UINT32 || 
-               tmp_byte == sensor_msgs::PointField::FLOAT32)
-      {
-        PC2_message_x_bytes = 4;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::FLOAT64)
-      {
-        PC2_message_x_bytes = 8;
-      }
-      else
-      {
-        ROS_ERROR("Cannot determine number of bytes for X coordinate");
-        return -1;
-      }
-    }
-    // Y
-    else if (strcmp(bank_argument.PC2_message_y_coordinate_field_name.c_str(), 
-                    msg->fields[i].name.c_str()) == 0)
-    {
-      // Read offset
-      memcpy(&tmp_byte4[0], &msg->fields[i].offset, 4);
-      if (must_reverse_bytes)
-      {
-        reverseBytes(tmp_byte4, 4);
-      }
-      memcpy(&PC2_message_y_offset, tmp_byte4, 4);
-      
-      // Read datatype
-      tmp_byte = msg->fields[i].datatype;
-      if (tmp_byte == sensor_msgs::PointField::INT8 || 
-          tmp_byte == sensor_msgs::PointField::UINT8)
-      {
-        PC2_message_y_bytes = 1;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT16 || 
-               tmp_byte == sensor_msgs::PointField::UINT16)
-      {
-        PC2_message_y_bytes = 2;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT32 || 
-               tmp_byte == sensor_msgs::PointField::UINT32 || 
-               tmp_byte == sensor_msgs::PointField::FLOAT32)
-      {
-        PC2_message_y_bytes = 4;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::FLOAT64)
-      {
-        PC2_message_y_bytes = 8;
-      }
-      else
-      {
-        ROS_ERROR("Cannot determine number of bytes for Y coordinate");
-        return -1;
-      }
+      workspace.points_x.resize(points_per_slice);
+      workspace.points_y.resize(points_per_slice);
+      workspace.points_z.resize(points_per_slice);
     }
-    // Z
-    else if (strcmp(bank_argument.PC2_message_z_coordinate_field_name.c_str(), 
-                    msg->fields[i].name.c_str()) == 0)
+    if (s == 0 || !by_column)
     {
-      // Read offset
-      memcpy(&tmp_byte4[0], &msg->fields[i].offset, 4);
-      if (must_reverse_bytes)
-      {
-        reverseBytes(tmp_byte4, 4);
-      }
-      memcpy(&PC2_message_z_offset, tmp_byte4, 4);
-      
-      // Read datatype
-      tmp_byte = msg->fields[i].datatype;
-      if (tmp_byte == sensor_msgs::PointField::INT8 || 
-          tmp_byte == sensor_msgs::PointField::UINT8)
-      {
-        PC2_message_z_bytes = 1;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT16 || 
-               tmp_byte == sensor_msgs::PointField::UINT16)
-      {
-        PC2_message_z_bytes = 2;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::INT32 || 
-               tmp_byte == sensor_msgs::PointField::UINT32 || 
-               tmp_byte == sensor_msgs::PointField::FLOAT32)
-      {
-        PC2_message_z_bytes = 4;
-      }
-      else if (tmp_byte == sensor_msgs::PointField::FLOAT64)
-      {
-        PC2_message_z_bytes = 8;
-      }
-      else
-      {
-        ROS_ERROR("Cannot determine number of bytes for Z coordinate");
-        return -1;
-      }
+      std::fill(workspace.squared_ranges.begin(), workspace.squared_ranges.end(), 
+                std::numeric_limits<double>::infinity());
     }
   }
-  
-  if (0 <= PC2_message_x_offset &&
-      0 <= PC2_message_x_bytes  &&
-      0 <= PC2_message_y_offset &&
-      0 <= PC2_message_y_bytes  &&
-      0 <= PC2_message_z_offset &&
-      0 <= PC2_message_z_bytes)
+  if (by_column)
   {
-    return 0;
+    startBinningByColumn(points_per_row);
   }
-  else
-  {
-    ROS_ERROR("Could not determine offsets and bytes");
-    return -1;
-  }
-}
-
-
-/* DATA POINT HANDLING */
-void Bank::readPoint(const byte_t * start_of_point,
-                      const bool must_reverse_bytes,
-                      double * x,
-                      double * y,
-                      double * z)
-{
-  uint8_t x_array[PC2_message_x_bytes];
-  uint8_t y_array[PC2_message_y_bytes];
-  uint8_t z_array[PC2_message_z_bytes];
-  memcpy(x_array, start_of_point + PC2_message_x_offset, PC2_message_x_bytes);
-  memcpy(y_array, start_of_point + PC2_message_y_offset, PC2_message_y_bytes);
-  memcpy(z_array, start_of_point + PC2_message_z_offset, PC2_message_z_bytes);
   
-  // Does the msg have different byte order compared to the CPU?
-  if (must_reverse_bytes)
-  {
-    reverseBytes(x_array, PC2_message_x_bytes);
-    reverseBytes(y_array, PC2_message_y_bytes);
-    reverseBytes(z_array, PC2_message_z_bytes);
-  }
+  // Bin the slices, in parallel if there are several
+  PointBinningTask task;
+  task.bank = this;
+  task.msg = msg;
+  task.decode_points = (must_reverse_bytes ? PC2_decode_points_reversed : PC2_decode_points);
+  task.by_column = by_column;
+  PC2_binning_pool.run(binPointsTask, &task, nr_slices);
   
-  // Read the coordinates for this point
-  // X
-  if (PC2_message_x_bytes == sizeof(float))
-  {
-    float xf;
-    memcpy(&xf, x_array, PC2_message_x_bytes);
-    *x = xf;
-  }
-  else if (PC2_message_x_bytes == sizeof(double))
-  {
-    memcpy(x, x_array, PC2_message_x_bytes);
-  }
-  else
+  // Merge the bins of the slices, or put the columns in the bins
+  double * squared_ranges = PC2_binning_workspaces[0].squared_ranges.data();
+  unsigned int added_points_out = PC2_binning_workspaces[0].added_points;
+  for (unsigned int s=1; s<nr_slices; ++s)
   {
-    ROS_ERROR("Cannot determine how to read X coordinate for this point!");
-    return;
-  }
-  // Y
-  if (PC2_message_y_bytes == sizeof(float))
-  {
-    float yf;
-    memcpy(&yf, y_array, PC2_message_y_bytes);
-    *y = yf;
-  }
-  else if (PC2_message_y_bytes == sizeof(double))
-  {
-    memcpy(y, y_array, PC2_message_y_bytes);
-  }
-  else
-  {
-    ROS_ERROR("Cannot determine how to read Y coordinate for this point!");
-    return;
-  }
-  // Z
-  if (PC2_message_z_bytes == sizeof(float))
-  {
-    float zf;
-    memcpy(&zf, z_array, PC2_message_z_bytes);
-    *z = zf;
+    added_points_out += PC2_binning_workspaces[s].added_points;
+    if (!by_column)
+    {
+      core.getKernels().minimum(squared_ranges, 
+                                PC2_binning_workspaces[s].squared_ranges.data(), 
+                                bank_argument.points_per_scan);
+    }
   }
-  else if (PC2_message_z_bytes == sizeof(double))
+  if (by_column)
   {
-    memcpy(z, z_array, PC2_message_z_bytes);
+    finishBinningByColumn(squared_ranges);
   }
-  else
+  
+  // Put the smallest range of each index in the bank, unless the bank already has a smaller range there
+  for (int p=0; p<=bank_index_max; ++p)
   {
-    ROS_ERROR("Cannot determine how to read Z coordinate for this point!");
-    return;
+    if (squared_ranges[p] < std::numeric_limits<double>::infinity())
+    {
+      const double range = sqrt(squared_ranges[p]);
+      if (range < bank_put[p])
+      {
+        bank_put[p] = range;
+      }
+    }
   }
+  
+  return added_points_out;
 }
 
 
-/* BANK HANDLING */
-// Resets the range bank[i] for each i to a value that is larger than the largest allowed (threshold_distance_max)
-void Bank::resetPutPoints()
+/*
+ * Bin the points of one slice of the columns of a message, run by PC2_binning_pool. 
+ * The slices are disjoint, so the slices only write to their own workspace and to their own columns.
+ */
+void Bank::binPointsTask(void * task, const unsigned int slice)
 {
-  const double range = bank_argument.object_threshold_max_distance + 10.0;
-  float * bank_put = bank_ranges_ema[bank_index_put];
-  for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
-  {
-    bank_put[i] = range;
-  }
+  const PointBinningTask * binning_task = static_cast<const PointBinningTask *>(task);
+  Bank * bank = binning_task->bank;
+  const sensor_msgs::PointCloud2 * msg = binning_task->msg;
+  const unsigned long columns = msg->row_step / msg->point_step;
+  const unsigned long nr_slices = bank->PC2_binning_workspaces.size();
+  const unsigned int column_begin = columns * slice / nr_slices;
+  const unsigned int column_end = columns * (slice + 1) / nr_slices;
+  PointBinningWorkspace & workspace = bank->PC2_binning_workspaces[slice];
+  
+  workspace.added_points = 
+    (binning_task->by_column ?
+    bank->binPointsByColumn(msg, binning_task->decode_points, column_begin, column_end, workspace) :
+    bank->binPoints(msg, binning_task->decode_points, column_begin, column_end, workspace));
 }
 
 
-// Assumes that threshold_distance_max < bank[i] (i.e. that values have been reset)
-// and that bank_view_angle is centered at the x-axis.
-// Reads all points from msg and puts them at bank[i] such that i corresponds to the angle at which 
-// the point is found in the x,y plane of the sensor.
-// Tries to fill several i for one and the same point if needed based on the voxel leaf size.
-unsigned int Bank::putPoints(const sensor_msgs::PointCloud2::ConstPtr msg)
+/*
+ * Find the smallest squared range of the points of msg in the columns [column_begin,column_end) in each bank index, 
+ * by finding the bank indices covered by each point.
+ */
+unsigned int Bank::binPoints(const sensor_msgs::PointCloud2 * msg, 
+                             const PointDecoderKernel decode_points,
+                             const unsigned int column_begin,
+                             const unsigned int column_end,
+                             PointBinningWorkspace & workspace)
 {
-  const bool must_reverse_bytes = (msg->is_bigendian != !machine_is_little_endian);
-  float * bank_put = bank_ranges_ema[bank_index_put];
-  const double bank_view_angle = bank_argument.angle_max - bank_argument.angle_min;
-  const double bank_view_angle_half = bank_view_angle / 2;
   const double voxel_leaf_size_half = bank_argument.PC2_voxel_leaf_size / 2;
-  const double inverted_bank_resolution = bank_argument.points_per_scan / bank_view_angle;
   const int bank_index_max = bank_argument.points_per_scan - 1;
   const unsigned int rows = msg->height;
   const unsigned int bytes_per_row = msg->row_step;
   const unsigned int bytes_per_point = msg->point_step;
+  const unsigned int points_per_row = column_end - column_begin;
+  double * squared_ranges = workspace.squared_ranges.data();
   
   // Loop through rows
   unsigned int added_points_out = 0;
   for (unsigned int i=0; i<rows; i++)
   {
+    // Decode the points of this row
+    decode_points(msg->data.data() + i * bytes_per_row + column_begin * bytes_per_point,
+                  points_per_row,
+                  bytes_per_point,
+                  PC2_message_x_offset,
+                  PC2_message_y_offset,
+                  PC2_message_z_offset,
+                  workspace.points_x.data(),
+                  workspace.points_y.data(),
+                  workspace.points_z.data());
+    
     // Loop through points in each row
-    const unsigned int row_offset = i * bytes_per_row;
-    for (unsigned int j=0; j<bytes_per_row; j+=bytes_per_point)
+    for (unsigned int j=0; j<points_per_row; ++j)
     {
-      double x, y, z;
-      const uint8_t * start_of_point = &msg->data[row_offset + j];
-      
-      readPoint(start_of_point,
-                must_reverse_bytes,
-                &x,
-                &y,
-                &z);
+      const double x = workspace.points_x[j];
+      const double y = workspace.points_y[j];
+      const double z = workspace.points_z[j];
       
       // Is this point outside the considered volume?
       if (!bank_argument.sensor_frame_has_z_axis_forward)
@@ -2528,33 +2054,29 @@ unsigned int Bank::putPoints(const sensor_msgs::PointCloud2::ConstPtr msg)
       // Another valid point
       added_points_out = added_points_out + 1;
       
-      // Calculate index (indices) of point in bank
-      const double range = sqrt(x*x + y*y + z*z); // TODO?
-      double point_angle_min;
-      double point_angle_max;
+      // Calculate index (indices) of point in bank from the slopes of the edges of the point
+      const double squared_range = x*x + y*y + z*z;
+      double point_slope_min;
+      double point_slope_max;
       if (!bank_argument.sensor_frame_has_z_axis_forward)
       {
         // Assume Z-axis is pointing up, 0.02 <= x
-        point_angle_min = atan((y - voxel_leaf_size_half) / x);
-        point_angle_max = atan((y + voxel_leaf_size_half) / x);
+        point_slope_min = (y - voxel_leaf_size_half) / x;
+        point_slope_max = (y + voxel_leaf_size_half) / x;
       }
       else
       {
         // Assume Y-axis is pointing down, 0.02 <= z
-        point_angle_min = atan((-x - voxel_leaf_size_half) / z);
-        point_angle_max = atan((-x + voxel_leaf_size_half) / z);
+        point_slope_min = (-x - voxel_leaf_size_half) / z;
+        point_slope_max = (-x + voxel_leaf_size_half) / z;
       }
-
       
-      const int bank_index_point_min = 
-        (0 > (point_angle_min + bank_view_angle_half) * inverted_bank_resolution ?
-        0: // MAX of 0 and next row
-        (point_angle_min + bank_view_angle_half) * inverted_bank_resolution);
+      const int bank_index_point_min = countBinBoundaries(point_slope_min);
       const int bank_index_point_max = 
-        (bank_index_max < (point_angle_max + bank_view_angle_half) * inverted_bank_resolution ?
-        bank_index_max : // MIN of bank_index_max and next row
-        (point_angle_max + bank_view_angle_half) * inverted_bank_resolution);
-            
+        (point_slope_max <= PC2_bin_slopes[0] ?
+        -1 : // Left of the boundary below index 0
+        std::min(bank_index_max, static_cast<int>(countBinBoundaries(point_slope_max))));
+      
       ROS_DEBUG_STREAM("The point (" << x << "," << y << "," << z << ") is added in the bank between indices " << \
            std::setw(4) << std::left << bank_index_point_min << " and " << bank_index_point_max << std::endl);
       
@@ -2562,9 +2084,9 @@ unsigned int Bank::putPoints(const sensor_msgs::PointCloud2::ConstPtr msg)
       // Check if there is already a range at the given index, only add if this point is closer
       for (int p=bank_index_point_min; p<=bank_index_point_max; ++p)
       {
-        if (range < bank_put[p])
+        if (squared_range < squared_ranges[p])
         {
-          bank_put[p] = range;
+          squared_ranges[p] = squared_range;
         }
       }
     }
@@ -2573,105 +2095,109 @@ unsigned int Bank::putPoints(const sensor_msgs::PointCloud2::ConstPtr msg)
   return added_points_out;
 }
 
-unsigned int Bank::putPoints(const sensor_msgs::PointCloud2 * msg)
+
+/*
+ * Prepare the columns of an organized cloud for binPointsByColumn.
+ */
+void Bank::startBinningByColumn(const unsigned int columns)
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  
+  // Bank indices of each column, found the first time the column has points
+  if (PC2_column_index_min.size() != columns)
+  {
+    PC2_column_index_min.assign(columns, 0);
+    PC2_column_index_max.assign(columns, -1);
+    PC2_column_is_binned.assign(columns, false);
+    PC2_column_slope_min.resize(columns);
+    PC2_column_slope_max.resize(columns);
+    PC2_column_squared_ranges.resize(columns);
+    PC2_nr_columns_not_binned = columns;
+  }
+  std::fill(PC2_column_squared_ranges.begin(), PC2_column_squared_ranges.end(), infinity);
+  if (0 < PC2_nr_columns_not_binned)
+  {
+    std::fill(PC2_column_slope_min.begin(), PC2_column_slope_min.end(), infinity);
+    std::fill(PC2_column_slope_max.begin(), PC2_column_slope_max.end(), -infinity);
+  }
+}
+
+
+/*
+ * Find the smallest squared range of the points of the organized cloud msg in each of the columns 
+ * [column_begin,column_end), and collect the slopes of the points in the columns that do not have bank indices yet.
+ */
+unsigned int Bank::binPointsByColumn(const sensor_msgs::PointCloud2 * msg, 
+                                     const PointDecoderKernel decode_points,
+                                     const unsigned int column_begin,
+                                     const unsigned int column_end,
+                                     PointBinningWorkspace & workspace)
 {
-  const bool must_reverse_bytes = (msg->is_bigendian != !machine_is_little_endian);
-  float * bank_put = bank_ranges_ema[bank_index_put];
-  const double bank_view_angle = bank_argument.angle_max - bank_argument.angle_min;
-  const double bank_view_angle_half = bank_view_angle / 2;
   const double voxel_leaf_size_half = bank_argument.PC2_voxel_leaf_size / 2;
-  const double inverted_bank_resolution = bank_argument.points_per_scan / bank_view_angle;
-  const int bank_index_max = bank_argument.points_per_scan - 1;
   const unsigned int rows = msg->height;
   const unsigned int bytes_per_row = msg->row_step;
   const unsigned int bytes_per_point = msg->point_step;
+  const unsigned int columns = column_end - column_begin;
+  double * column_squared_ranges = PC2_column_squared_ranges.data() + column_begin;
+  double * column_slope_min = PC2_column_slope_min.data() + column_begin;
+  double * column_slope_max = PC2_column_slope_max.data() + column_begin;
+  
+  // The coordinates that are forward, leftward and upward
+  const bool z_forward = bank_argument.sensor_frame_has_z_axis_forward;
+  const double * forward = (z_forward ? workspace.points_z.data() : workspace.points_x.data());
+  const double * leftward = (z_forward ? workspace.points_x.data() : workspace.points_y.data());
+  const double * upward = (z_forward ? workspace.points_y.data() : workspace.points_z.data());
+  const double leftward_sign = (z_forward ? -1.0 : 1.0);
+  const double upward_sign = leftward_sign;
+  const double * x = workspace.points_x.data();
+  const double * y = workspace.points_y.data();
+  const double * z = workspace.points_z.data();
   
   // Loop through rows
   unsigned int added_points_out = 0;
   for (unsigned int i=0; i<rows; i++)
   {
-    // Loop through points in each row
-    const unsigned int row_offset = i * bytes_per_row;
-    for (unsigned int j=0; j<bytes_per_row; j+=bytes_per_point)
+    // Decode the points of this row
+    decode_points(msg->data.data() + i * bytes_per_row + column_begin * bytes_per_point,
+                  columns,
+                  bytes_per_point,
+                  PC2_message_x_offset,
+                  PC2_message_y_offset,
+                  PC2_message_z_offset,
+                  workspace.points_x.data(),
+                  workspace.points_y.data(),
+                  workspace.points_z.data());
+    
+    // Keep the smallest squared range of the points in each column that are inside the considered volume, 
+    // without branching so that the loop can be vectorized (NaN coordinates fail the comparisons)
+    for (unsigned int j=0; j<columns; ++j)
     {
-      double x, y, z;
-      const uint8_t * start_of_point = &msg->data[row_offset + j];
-      
-      readPoint(start_of_point,
-                must_reverse_bytes,
-                &x,
-                &y,
-                &z);
-      
-      // Is this point outside the considered volume?
-      if (!bank_argument.sensor_frame_has_z_axis_forward)
-      {
-        // Assume Z-axis is pointing up and X-axis forward
-        if (z < bank_argument.PC2_threshold_z_min || 
-            bank_argument.PC2_threshold_z_max < z ||
-            x < 0.02) 
-        {
-          continue;
-        }
-      }
-      else
-      {
-        // Assume Y-axis is pointing down and Z-axis forward
-        if (-y < bank_argument.PC2_threshold_z_min || 
-            bank_argument.PC2_threshold_z_max < -y ||
-            z < 0.02) 
-        {
-          continue;
-        }
-      }
-      
-      // Sanity check
-      if (std::isnan(x) || std::isnan(y) || std::isnan(z))
-      {
-        ROS_DEBUG_STREAM("Skipping point (" << x << "," << y << "," << z << ")");
-        continue;
-      }
-      
-      // Another valid point
-      added_points_out = added_points_out + 1;
-      
-      // Calculate index (indices) of point in bank
-      const double range = sqrt(x*x + y*y + z*z); // TODO?
-      double point_angle_min;
-      double point_angle_max;
-      if (!bank_argument.sensor_frame_has_z_axis_forward)
-      {
-        // Assume Z-axis is pointing up, 0.02 <= x
-        point_angle_min = atan((y - voxel_leaf_size_half) / x);
-        point_angle_max = atan((y + voxel_leaf_size_half) / x);
-      }
-      else
-      {
-        // Assume Y-axis is pointing down, 0.02 <= z
-        point_angle_min = atan((-x - voxel_leaf_size_half) / z);
-        point_angle_max = atan((-x + voxel_leaf_size_half) / z);
-      }
-
-      
-      const int bank_index_point_min = 
-        (0 > (point_angle_min + bank_view_angle_half) * inverted_bank_resolution ?
-        0: // MAX of 0 and next row
-        (point_angle_min + bank_view_angle_half) * inverted_bank_resolution);
-      const int bank_index_point_max = 
-        (bank_index_max < (point_angle_max + bank_view_angle_half) * inverted_bank_resolution ?
-        bank_index_max : // MIN of bank_index_max and next row
-        (point_angle_max + bank_view_angle_half) * inverted_bank_resolution);
-            
-      ROS_DEBUG_STREAM("The point (" << x << "," << y << "," << z << ") is added in the bank between indices " << \
-           std::setw(4) << std::left << bank_index_point_min << " and " << bank_index_point_max << std::endl);
-      
-      // Fill all indices covered by this point
-      // Check if there is already a range at the given index, only add if this point is closer
-      for (int p=bank_index_point_min; p<=bank_index_point_max; ++p)
-      {
-        if (range < bank_put[p])
+      const double up = upward_sign * upward[j];
+      const double squared_range = x[j]*x[j] + y[j]*y[j] + z[j]*z[j];
+      const bool point_is_valid = bank_argument.PC2_threshold_z_min <= up && 
+                                  up <= bank_argument.PC2_threshold_z_max &&
+                                  0.02 <= forward[j] &&
+                                  squared_range == squared_range;
+      added_points_out += point_is_valid;
+      column_squared_ranges[j] = (point_is_valid && squared_range < column_squared_ranges[j] ? 
+                                  squared_range : column_squared_ranges[j]);
+    }
+    
+    // Collect the slopes of the edges of the points in the columns that do not have bank indices yet
+    if (0 < PC2_nr_columns_not_binned)
+    {
+      for (unsigned int j=0; j<columns; ++j)
+      {
+        const double up = upward_sign * upward[j];
+        if (!PC2_column_is_binned[column_begin + j] && 
+            bank_argument.PC2_threshold_z_min <= up && 
+            up <= bank_argument.PC2_threshold_z_max &&
+            0.02 <= forward[j] &&
+            !std::isnan(x[j]) && !std::isnan(y[j]) && !std::isnan(z[j]))
         {
-          bank_put[p] = range;
+          const double left = leftward_sign * leftward[j];
+          column_slope_min[j] = std::min(column_slope_min[j], (left - voxel_leaf_size_half) / forward[j]);
+          column_slope_max[j] = std::max(column_slope_max[j], (left + voxel_leaf_size_half) / forward[j]);
         }
       }
     }
@@ -2681,58 +2207,159 @@ unsigned int Bank::putPoints(const sensor_msgs::PointCloud2 * msg)
 }
 
 
-// Assumes that bank[bank_index_put] is filled with ranges from a new message 
-// (i.e. that indices have not yet been updated).
-// These values are EMA-adapted based on the previous set of EMA-adapted values at bank[index_previous]
-void Bank::emaPutMessage()
+/*
+ * Put the smallest squared range of each column, found by binPointsByColumn, in the bank indices covered by the 
+ * column. The bank indices of the columns that got their first points are found first.
+ */
+void Bank::finishBinningByColumn(double * squared_ranges)
 {
-  const double alpha = bank_argument.ema_alpha;
+  const int bank_index_max = bank_argument.points_per_scan - 1;
+  const unsigned int columns = PC2_column_squared_ranges.size();
+  const double infinity = std::numeric_limits<double>::infinity();
+  const double * column_squared_ranges = PC2_column_squared_ranges.data();
+  const double * column_slope_min = PC2_column_slope_min.data();
+  const double * column_slope_max = PC2_column_slope_max.data();
   
-  // No need to do this if alpha < 1.0!
-  if (alpha < 1.0)
+  // Find the bank indices of the columns that got their first points
+  if (0 < PC2_nr_columns_not_binned)
   {
-    const double alpha_prev = 1.0 - alpha;
-    float * bank_put = bank_ranges_ema[bank_index_put];
-    float * bank_prev = bank_ranges_ema[bank_index_newest];
-
-    for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
+    for (unsigned int j=0; j<columns; ++j)
     {
-      bank_put[i] = alpha * bank_put[i] + 
-                    alpha_prev * bank_prev[i];
+      if (!PC2_column_is_binned[j] && column_slope_min[j] <= column_slope_max[j])
+      {
+        PC2_column_index_min[j] = countBinBoundaries(column_slope_min[j]);
+        PC2_column_index_max[j] = 
+          (column_slope_max[j] <= PC2_bin_slopes[0] ?
+          -1 : // Left of the boundary below index 0
+          std::min(bank_index_max, static_cast<int>(countBinBoundaries(column_slope_max[j]))));
+        PC2_column_is_binned[j] = true;
+        PC2_nr_columns_not_binned--;
+        ROS_DEBUG_STREAM("Column " << j << " is added in the bank between indices " << \
+                         PC2_column_index_min[j] << " and " << PC2_column_index_max[j]);
+      }
     }
   }
-}
-
-
-// Debug/print bank column/msg
-std::string Bank::getStringPutPoints()
-{
-  float * bank_put = bank_ranges_ema[bank_index_put];  
-  std::ostringstream stream;
-  stream << "Bank points (at put index):";
-  for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
+  
+  // Put the smallest squared range of each column in the bank indices covered by the column
+  for (unsigned int j=0; j<columns; ++j)
   {
-    stream << " " << bank_put[i];
+    const double squared_range = column_squared_ranges[j];
+    if (squared_range < infinity)
+    {
+      for (int p=PC2_column_index_min[j]; p<=PC2_column_index_max[j]; ++p)
+      {
+        if (squared_range < squared_ranges[p])
+        {
+          squared_ranges[p] = squared_range;
+        }
+      }
+    }
   }
-  stream << std::endl;
-  std::string string = stream.str();
-  return string;
 }
 
 
-// Init indices
-inline void Bank::initIndex()
+/*
+ * Count the bin boundaries 1..points_per_scan whose slope is at most the given slope, 
+ * i.e. the bank index of a point with this slope (ignoring that the index is limited to points_per_scan-1)
+ */
+unsigned int Bank::countBinBoundaries(const double slope) const
 {
-  bank_index_put = 1;
-  bank_index_newest = 0;
+  // Start at the count of the lookup table cell of the slope, then correct it
+  const unsigned int nr_boundaries = PC2_bin_slopes.size() - 1;
+  const unsigned int cell_max = PC2_bin_slope_lut.size() - 1;
+  const double cell = (slope - PC2_bin_slope_lut_min) * PC2_bin_slope_lut_inverted_cell_width;
+  unsigned int count = PC2_bin_slope_lut[cell <= 0 ? 0 : (cell_max <= cell ? cell_max : static_cast<unsigned int>(cell))];
+  while (0 < count && slope < PC2_bin_slopes[count])
+  {
+    count--;
+  }
+  while (count < nr_boundaries && PC2_bin_slopes[count + 1] <= slope)
+  {
+    count++;
+  }
+  return count;
 }
 
 
-// Advance indices
-inline void Bank::advanceIndex()
+/*
+ * Calculate the slopes of the boundaries between the bank indices, so that the index of a point can be found 
+ * without calculating its angle. 
+ * Boundary k is at angle k * bank_view_angle / points_per_scan - bank_view_angle / 2, 
+ * a point at angle a belongs to index k if boundary k is at most a and boundary k+1 is larger than a. 
+ * Boundaries at or beyond +-90 degrees get the slopes +-inf, since the angle of a point is in (-90,90) degrees.
+ */
+void Bank::initPointBinning()
 {
-  bank_index_put = (bank_index_put + 1) % bank_argument.nr_scans_in_bank; // points to the oldest message
-  bank_index_newest = (bank_index_newest + 1) % bank_argument.nr_scans_in_bank; // points to the newest/this message
+  const double bank_view_angle = bank_argument.angle_max - bank_argument.angle_min;
+  const double bank_view_angle_half = bank_view_angle / 2;
+  const int nr_boundaries = bank_argument.points_per_scan;
+  const double infinity = std::numeric_limits<double>::infinity();
+  
+  // PC2_bin_slopes[0] is the boundary below index 0, PC2_bin_slopes[k] is boundary k for k in 1..points_per_scan
+  PC2_bin_slopes.resize(nr_boundaries + 1);
+  for (int k=0; k<=nr_boundaries; ++k)
+  {
+    const double boundary_angle = (k == 0 ? -1 : k) * bank_view_angle / nr_boundaries - bank_view_angle_half;
+    PC2_bin_slopes[k] = (boundary_angle <= -M_PI_2 ? -infinity :
+                         M_PI_2 <= boundary_angle ? infinity : 
+                         tan(boundary_angle));
+  }
+  
+  // Lookup table with cells of uniform slope width, covering the finite slopes of the boundaries. 
+  // The cells are an eighth of the smallest distance between two boundaries, so that counting from the start of 
+  // a cell seldom needs a correction step, but they are limited in number in case boundaries are close to +-90 
+  // degrees and the slopes are far apart
+  double slope_min = infinity;
+  double slope_max = -infinity;
+  double slope_delta_min = infinity;
+  for (int k=1; k<=nr_boundaries; ++k)
+  {
+    if (std::isfinite(PC2_bin_slopes[k]))
+    {
+      slope_min = std::min(slope_min, PC2_bin_slopes[k]);
+      slope_max = std::max(slope_max, PC2_bin_slopes[k]);
+      if (1 < k && std::isfinite(PC2_bin_slopes[k - 1]))
+      {
+        slope_delta_min = std::min(slope_delta_min, PC2_bin_slopes[k] - PC2_bin_slopes[k - 1]);
+      }
+    }
+  }
+  unsigned int nr_cells = 1;
+  if (slope_min < slope_max && 0 < slope_delta_min)
+  {
+    nr_cells = std::min(64.0 * nr_boundaries, ceil(8 * (slope_max - slope_min) / slope_delta_min)) + 1;
+    PC2_bin_slope_lut_min = slope_min;
+    PC2_bin_slope_lut_inverted_cell_width = (nr_cells - 1) / (slope_max - slope_min);
+  }
+  else
+  {
+    PC2_bin_slope_lut_min = 0;
+    PC2_bin_slope_lut_inverted_cell_width = 0;
+  }
+  PC2_bin_slope_lut.resize(nr_cells);
+  for (unsigned int c=0; c<nr_cells; ++c)
+  {
+    const double cell_slope = (PC2_bin_slope_lut_inverted_cell_width == 0 ? 
+                               PC2_bin_slope_lut_min :
+                               PC2_bin_slope_lut_min + c / PC2_bin_slope_lut_inverted_cell_width);
+    PC2_bin_slope_lut[c] = std::upper_bound(PC2_bin_slopes.begin() + 1, PC2_bin_slopes.end(), cell_slope) - 
+                           (PC2_bin_slopes.begin() + 1);
+  }
+  
+  // The threads that bin the points of each message, started the first time
+  if (PC2_binning_workspaces.size() == 0)
+  {
+    if (1 < bank_argument.PC2_nr_binning_threads && 
+        PC2_binning_pool.start(bank_argument.PC2_nr_binning_threads) != 0)
+    {
+      ROS_WARN("Could not start all threads, the points are binned by %u threads", PC2_binning_pool.getNrThreads());
+    }
+    PC2_binning_workspaces.resize(PC2_binning_pool.getNrThreads());
+  }
+  for (unsigned int s=0; s<PC2_binning_workspaces.size(); ++s)
+  {
+    PC2_binning_workspaces[s].squared_ranges.resize(nr_boundaries);
+  }
 }
 
 
@@ -2775,41 +2402,7 @@ long Bank::init(BankArgument bank_argument, const sensor_msgs::LaserScan * msg)
 // Add FIRST LaserScan message to bank - no ema
 long Bank::addFirstMessage(const sensor_msgs::LaserScan * msg)
 {
-  bank_stamp[0] = msg->header.stamp.toSec();
-  
-//   if (bank_argument.ema_alpha != 1.0)
-//   {
-    float * bank_put = bank_ranges_ema[0];
-    for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
-    {
-      if (msg->ranges[i] == std::numeric_limits<float>::infinity())
-      {
-        bank_put[i] = bank_argument.range_max + 0.01;
-      }
-      else if (msg->ranges[i] == -std::numeric_limits<float>::infinity())
-      {
-        bank_put[i] = bank_argument.range_min - 0.01;
-      }
-//       else if (msg->ranges[i] != msg->ranges[i])
-      else if (std::isnan(msg->ranges[i]))
-      {
-        // The range is NaN
-        bank_put[i] = bank_argument.range_max + 0.01;
-      }
-      else
-      {
-        // Turn infinity into large value
-        bank_put[i] = msg->ranges[i];
-      }
-    }
-//   }
-//   else
-//   {
-//     memcpy(&bank_ranges_ema[0][0], msg->ranges.data(), bank_ranges_bytes);
-//   }
-  
-  initIndex(); // set put to 1 and newest to 0
-  bank_is_filled = false;
+  core.addFirstScan(msg->ranges.data(), msg->header.stamp.toSec());
   
   ROS_DEBUG_STREAM("First message (LaserScan):" << std::endl << *msg);
   
@@ -2819,50 +2412,7 @@ long Bank::addFirstMessage(const sensor_msgs::LaserScan * msg)
 // Add LaserScan message and perform EMA
 long Bank::addMessage(const sensor_msgs::LaserScan * msg)
 {
-  // Save timestamp
-  bank_stamp[bank_index_put] = msg->header.stamp.toSec();
-  
-  // Save EMA of ranges, if applicable, otherwise, perform memcpy
-  const double alpha = bank_argument.ema_alpha;
-//   if (alpha != 1.0)
-//   {
-    const double alpha_prev = 1.0 - bank_argument.ema_alpha;
-    float * bank_put = bank_ranges_ema[bank_index_put];
-    float * bank_newest = bank_ranges_ema[bank_index_newest];
-    for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
-    {
-      if (msg->ranges[i] == std::numeric_limits<float>::infinity())
-      {
-        bank_put[i] = bank_argument.range_max + 0.01;
-      }
-      else if (msg->ranges[i] == -std::numeric_limits<float>::infinity())
-      {
-        bank_put[i] = bank_argument.range_min - 0.01;
-      }
-      else if (msg->ranges[i] != msg->ranges[i])
-      {
-        // The range is NaN
-        bank_put[i] = bank_argument.range_max + 0.01;
-      }
-      else
-      {
-        // Turn infinity into large value
-        bank_put[i] = alpha * msg->ranges[i]  +  alpha_prev * bank_newest[i];
-      }
-    }
-//   }
-//   else
-//   {
-//     memcpy(&bank_ranges_ema[bank_index_put][0], msg->ranges.data(), bank_ranges_bytes);
-//   }
-  
-  advanceIndex();
-  if (!bank_is_filled && bank_index_put < bank_index_newest)
-  {
-    bank_is_filled = true;
-  }
-  
-  return 0;
+  return core.addScan(msg->ranges.data(), msg->header.stamp.toSec());
 }
 
 
@@ -2912,6 +2462,7 @@ long Bank::init(BankArgument bank_argument, const sensor_msgs::PointCloud2 * msg
   
   bank_argument.check_PC2();
   initBank(bank_argument);  // Will return immediately in case it has been called before
+  initPointBinning();
   return addFirstMessage(msg, discard_message_if_no_points_added);
 }
 
@@ -2920,17 +2471,11 @@ long Bank::init(BankArgument bank_argument, const sensor_msgs::PointCloud2 * msg
 long Bank::addFirstMessage(const sensor_msgs::PointCloud2 * msg, 
                            const bool discard_message_if_no_points_added)
 {
-  // Save timestamp
-  bank_stamp[0] = msg->header.stamp.toSec();
-  
-  // Set put index so that we can use the helper functions
-  bank_index_put = 0;
-  
-  // Reset ranges so that new values can be added to bank position
-  resetPutPoints();
+  // Save timestamp and reset ranges so that new values can be added to bank position
+  float * bank_put = core.startFirstPut(msg->header.stamp.toSec());
   
   // Add points if possible
-  const unsigned int added_points = putPoints(msg);
+  const unsigned int added_points = putPoints(msg, bank_put);
   
   // If no points were added, then redo the process for this message
   if (added_points == 0)
@@ -2944,11 +2489,10 @@ long Bank::addFirstMessage(const sensor_msgs::PointCloud2 * msg,
   
   ROS_DEBUG_STREAM("First message (PointCloud2):" << std::endl << *msg);
   
-  ROS_DEBUG("%s", getStringPutPoints().c_str());
+  ROS_DEBUG("%s", core.getStringPutRanges().c_str());
   
   // Set put to 1 and newest to 0
-  initIndex();
-  bank_is_filled = false;
+  core.finishFirstPut();
   
   return 0;
 }
@@ -2957,14 +2501,11 @@ long Bank::addFirstMessage(const sensor_msgs::PointCloud2 * msg,
 long Bank::addMessage(const sensor_msgs::PointCloud2 * msg, 
                       const bool discard_message_if_no_points_added)
 {
-  // Copy timestamp
-  bank_stamp[bank_index_put] = msg->header.stamp.toSec();
-  
-  // Reset ranges so that new values can be added to bank position
-  resetPutPoints();
+  // Copy timestamp and reset ranges so that new values can be added to bank position
+  float * bank_put = core.startPut(msg->header.stamp.toSec());
   
   // Read the message and put the points in the bank
-  const unsigned int added_points = putPoints(msg);
+  const unsigned int added_points = putPoints(msg, bank_put);
   
   // If no points were added, then redo the process for this message
   if (added_points == 0)
@@ -2976,17 +2517,10 @@ long Bank::addMessage(const sensor_msgs::PointCloud2 * msg,
     }
   }
   
-  ROS_DEBUG("%s", getStringPutPoints().c_str());
+  ROS_DEBUG("%s", core.getStringPutRanges().c_str());
   
-  // EMA-adapt the new ranges
-  emaPutMessage();
-  
-  // Update indices
-  advanceIndex();
-  if (bank_index_put < bank_index_newest)
-  {
-    bank_is_filled = true;
-  }
+  // EMA-adapt the new ranges and update indices
+  core.finishPut();
   
   return 0;
 }
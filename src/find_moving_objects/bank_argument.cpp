@@ -0,0 +1,194 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <iostream>
+#include <string>
+#include <cmath>
+
+/* Local includes */
+#include <find_moving_objects/bank_argument.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructors
+ */
+BankArgument::BankArgument()
+{
+  ema_alpha = 1.0;
+  nr_scans_in_bank = 11;
+  adapt_nr_scans_in_bank_time = 0.0;
+  max_nr_scans_in_bank = 100;
+  points_per_scan = 360;
+  angle_min = -M_PI;
+  angle_max = M_PI;
+  sensor_frame_has_z_axis_forward = false;
+  object_threshold_edge_max_delta_range = 0.15;
+  object_threshold_min_nr_points = 5;
+  object_threshold_max_distance = 6.5;
+  object_threshold_min_speed = 0.03;
+  object_threshold_max_delta_width_in_points = 5;
+  object_threshold_min_confidence = 0.67;
+  object_threshold_bank_tracking_max_delta_distance = 0.2;
+  base_confidence = 0.3;
+  publish_objects = true;
+  publish_objects_compact = false;
+  objects_compact_use_sensor_frame = false;
+  objects_compact_use_base_frame = false;
+  objects_compact_use_fixed_frame = false;
+  publish_ema = true;
+  publish_objects_closest_point_markers = false;
+  publish_objects_velocity_arrows = false;
+  publish_objects_delta_position_lines = false;
+  publish_objects_width_lines = false;
+  velocity_arrows_use_full_gray_scale = false;
+  velocity_arrows_use_sensor_frame = false;
+  velocity_arrows_use_base_frame = false;
+  velocity_arrows_use_fixed_frame = false;
+  velocity_arrow_ns = "velocity_arrow_ns";
+  delta_position_line_ns = "delta_position_line_ns";
+  width_line_ns = "width_line_ns";
+  topic_objects = "moving_objects_arrays";
+  topic_objects_compact = "moving_objects_compact_arrays";
+  topic_ema = "ema";
+  topic_objects_closest_point_markers = "objects_closest_point_markers";
+  topic_objects_velocity_arrows = "objects_velocity_arrows";
+  topic_objects_delta_position_lines = "objects_delta_position_lines";
+  topic_objects_width_lines = "objects_width_lines";
+  publish_buffer_size = 10;
+  map_frame = "map";
+  fixed_frame = "odom";
+  base_frame = "base_link";
+  compute_in_map_frame = true;
+  compute_in_fixed_frame = true;
+  compute_in_base_frame = true;
+//   merge_threshold_max_angle_gap = 0.0 / 180.0 * M_PI;
+//   merge_threshold_max_end_points_distance_delta = 0.2;
+//   merge_threshold_max_velocity_direction_delta = 25.0 / 180.0 * M_PI;
+//   merge_threshold_max_speed_delta = 0.2;
+  PC2_message_x_coordinate_field_name = "x";
+  PC2_message_y_coordinate_field_name = "y";
+  PC2_message_z_coordinate_field_name = "z";
+  PC2_voxel_leaf_size = 0.02;
+  PC2_threshold_z_min = 0.1;
+  PC2_threshold_z_max = 1.0;
+  PC2_bin_organized_cloud_by_column = false;
+  PC2_nr_binning_threads = 1;
+  
+  node_name_suffix = "";
+}
+
+std::ostream& operator<<(std::ostream & os, const BankArgument & ba)
+{
+  os << "Bank Arguments:" << std::endl <<
+    "  ema_alpha = " << ba.ema_alpha << std::endl <<
+    "  nr_scans_in_bank = " << ba.nr_scans_in_bank << std::endl <<
+    "  adapt_nr_scans_in_bank_time = " << ba.adapt_nr_scans_in_bank_time << std::endl <<
+    "  max_nr_scans_in_bank = " << ba.max_nr_scans_in_bank << std::endl <<
+    "  points_per_scan = " << ba.points_per_scan << std::endl <<
+    "  angle_min = " << ba.angle_min << std::endl <<
+    "  angle_max = " << ba.angle_max << std::endl <<
+    "  sensor_frame_has_z_axis_forward = " << ba.sensor_frame_has_z_axis_forward << std::endl <<
+    "  object_threshold_edge_max_delta_range = " << ba.object_threshold_edge_max_delta_range << std::endl <<
+    "  object_threshold_min_nr_points = " << ba.object_threshold_min_nr_points << std::endl <<
+    "  object_threshold_max_distance = " << ba.object_threshold_max_distance << std::endl <<
+    "  object_threshold_min_speed = " << ba.object_threshold_min_speed << std::endl <<
+    "  object_threshold_max_delta_width_in_points = " << ba.object_threshold_max_delta_width_in_points << std::endl <<
+    "  object_threshold_min_confidence = " << ba.object_threshold_min_confidence << std::endl <<
+    "  object_threshold_bank_tracking_max_delta_distance = " <<
+    ba.object_threshold_bank_tracking_max_delta_distance << std::endl <<
+    "  base_confidence = " << ba.base_confidence << std::endl <<
+    "  publish_objects = " << ba.publish_objects << std::endl <<
+    "  publish_objects_compact = " << ba.publish_objects_compact << std::endl <<
+    "  objects_compact_use_sensor_frame = " << ba.objects_compact_use_sensor_frame << std::endl <<
+    "  objects_compact_use_base_frame = " << ba.objects_compact_use_base_frame << std::endl <<
+    "  objects_compact_use_fixed_frame = " << ba.objects_compact_use_fixed_frame << std::endl <<
+    "  publish_ema = " << ba.publish_ema << std::endl <<
+    "  publish_objects_closest_point_markers = " << ba.publish_objects_closest_point_markers << std::endl <<
+    "  publish_objects_velocity_arrows = " << ba.publish_objects_velocity_arrows << std::endl <<
+    "  publish_objects_delta_position_lines = " << ba.publish_objects_delta_position_lines << std::endl <<
+    "  publish_objects_width_lines = " << ba.publish_objects_width_lines << std::endl <<
+    "  velocity_arrows_use_full_gray_scale = " << ba.velocity_arrows_use_full_gray_scale << std::endl <<
+    "  velocity_arrows_use_sensor_frame = " << ba.velocity_arrows_use_sensor_frame << std::endl <<
+    "  velocity_arrows_use_base_frame = " << ba.velocity_arrows_use_base_frame << std::endl <<
+    "  velocity_arrows_use_fixed_frame = " << ba.velocity_arrows_use_fixed_frame << std::endl <<
+    "  velocity_arrow_ns = " << ba.velocity_arrow_ns << std::endl <<
+    "  delta_position_line_ns = " << ba.delta_position_line_ns << std::endl <<
+    "  width_line_ns = " << ba.width_line_ns << std::endl <<
+    "  topic_objects = " << ba.topic_objects << std::endl <<
+    "  topic_objects_compact = " << ba.topic_objects_compact << std::endl <<
+    "  topic_ema = " << ba.topic_ema << std::endl <<
+    "  topic_objects_closest_point_markers = " << ba.topic_objects_closest_point_markers << std::endl <<
+    "  topic_objects_velocity_arrows = " << ba.topic_objects_velocity_arrows << std::endl <<
+    "  topic_objects_delta_position_lines = " << ba.topic_objects_delta_position_lines << std::endl <<
+    "  topic_objects_width_lines = " << ba.topic_objects_width_lines << std::endl <<
+    "  publish_buffer_size = " << ba.publish_buffer_size << std::endl <<
+    "  map_frame = " << ba.map_frame << std::endl <<
+    "  fixed_frame = " << ba.fixed_frame << std::endl <<
+    "  base_frame = " << ba.base_frame << std::endl <<
+    "  compute_in_map_frame = " << ba.compute_in_map_frame << std::endl <<
+    "  compute_in_fixed_frame = " << ba.compute_in_fixed_frame << std::endl <<
+    "  compute_in_base_frame = " << ba.compute_in_base_frame << std::endl <<
+//     "  merge_threshold_max_angle_gap = " << ba.merge_threshold_max_angle_gap << std::endl <<
+//     "  merge_threshold_max_end_points_distance_delta = " << 
+//     ba.merge_threshold_max_end_points_distance_delta << std::endl <<
+//     "  merge_threshold_max_velocity_direction_delta = " << 
+//     ba.merge_threshold_max_velocity_direction_delta << std::endl <<
+//     "  merge_threshold_max_speed_delta = " << ba.merge_threshold_max_speed_delta << std::endl <<
+    "  PC2_message_x_coordinate_field_name = " << ba.PC2_message_x_coordinate_field_name << std::endl <<
+    "  PC2_message_y_coordinate_field_name = " << ba.PC2_message_y_coordinate_field_name << std::endl <<
+    "  PC2_message_z_coordinate_field_name = " << ba.PC2_message_z_coordinate_field_name << std::endl <<
+    "  PC2_voxel_leaf_size = " << ba.PC2_voxel_leaf_size << std::endl <<
+    "  PC2_threshold_z_min = " << ba.PC2_threshold_z_min << std::endl <<
+    "  PC2_threshold_z_max = " << ba.PC2_threshold_z_max << std::endl <<
+    "  PC2_bin_organized_cloud_by_column = " << ba.PC2_bin_organized_cloud_by_column << std::endl <<
+    "  PC2_nr_binning_threads = " << ba.PC2_nr_binning_threads << std::endl;
+  os << "Private Bank Arguments:" << std::endl <<
+    "  sensor_frame = " << ba.sensor_frame << std::endl <<
+    "  angle_increment = " << ba.angle_increment << std::endl << 
+    "  time_increment = " << ba.time_increment << std::endl << 
+    "  scan_time = " << ba.scan_time << std::endl << 
+    "  range_min = " << ba.range_min << std::endl <<
+    "  range_max = " << ba.range_max << std::endl <<
+    "  node_name_suffix = " << ba.node_name_suffix << std::endl;
+  
+  return os;
+}
+
+} // namespace find_moving_objects
@@ -0,0 +1,949 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <iostream> 
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+/* Local includes */
+#include <find_moving_objects/bank_argument.h>
+#include <find_moving_objects/bank_core.h>
+
+
+namespace find_moving_objects
+{
+
+const float TWO_PI = 2*M_PI;
+const double TIME_TOLERANCE = 0.1; // The relative error in the time covered by the bank that makes it adapt
+
+/*
+ * Constructor
+ */
+BankCore::BankCore()
+{
+  bank_is_initialized = false;
+  bank_is_filled = false;
+  bank_index_put = -1;
+  bank_index_newest = -1;
+  adapted_rate = 0.0;
+  nr_scans_since_adapted = 0;
+  kernels = BankKernels::select();
+}
+
+
+/*
+ * Allocate bank based on information received from the user and sensor
+ */
+long BankCore::init(BankArgument bank_argument,
+                    const float angle_increment,
+                    const float range_min,
+                    const float range_max)
+{
+  if (bank_is_initialized ||
+      bank_argument.nr_scans_in_bank < 2 ||
+      bank_argument.points_per_scan < 1)
+  {
+    return -1;
+  }
+  
+  bank_index_put = -1;
+  bank_index_newest = -1;
+  adapted_rate = 0.0;
+  nr_scans_since_adapted = 0;
+  
+  /* Init bank */
+  bank_argument.angle_increment = angle_increment;
+  bank_argument.range_min = range_min;
+  bank_argument.range_max = range_max;
+  bank_argument.sensor_is_360_degrees = fabsf(bank_argument.angle_max - bank_argument.angle_min - TWO_PI) <= 
+                                        2.0 * bank_argument.angle_increment; // Safety margin
+  this->bank_argument = bank_argument;
+  
+  bank_stamp.assign(bank_argument.nr_scans_in_bank, 0.0);
+  if (bank_ranges_ema.allocate(bank_argument.nr_scans_in_bank, bank_argument.points_per_scan) != 0)
+  {
+    return -1;
+  }
+  
+  /* Init segmentation */
+  segment_valid_bits.assign(bank_argument.points_per_scan / 64 + 1, 0);
+  segment_link_bits.assign(bank_argument.points_per_scan / 64 + 1, 0);
+  // Comparing a float against this float gives the same result as comparing it against the double threshold
+  segment_max_delta_range = bank_argument.object_threshold_edge_max_delta_range;
+  if (bank_argument.object_threshold_edge_max_delta_range < segment_max_delta_range)
+  {
+    segment_max_delta_range = nextafterf(segment_max_delta_range, -std::numeric_limits<float>::infinity());
+  }
+  tracking_range_max = (bank_argument.range_max < bank_argument.object_threshold_max_distance  ?
+                        bank_argument.range_max : bank_argument.object_threshold_max_distance);
+  row_segments.assign(bank_argument.nr_scans_in_bank, SegmentTable());
+  newest_segments = SegmentTable();
+  
+  bank_is_initialized = true;
+  return 0;
+}
+
+
+/* 
+ * Tracking of an object through history to get the indices of its middle, 
+ * left and right points in the oldest scans, along with the sum of all ranges etc.
+ */
+void BankCore::getOldIndices(const unsigned int object_width_in_points,
+                             const unsigned int index_mean,
+                             const unsigned int threshold_consecutive_failures_to_find_object,
+                             int * index_min_old,
+                             int * index_mean_old,
+                             int * index_max_old,
+                             float * range_sum_old,
+                             float * range_at_min_index_old,
+                             float * range_at_max_index_old)
+{
+  const unsigned int points_per_scan = bank_argument.points_per_scan;
+  unsigned int width_in_points_newer = object_width_in_points;
+  unsigned int index_mean_current = index_mean;
+  unsigned int misses = 0;
+  int current_level = (bank_index_newest - 1) < 0 ? bank_argument.nr_scans_in_bank - 1 : bank_index_newest - 1;
+  
+  for (int levels_searched=1; levels_searched<bank_argument.nr_scans_in_bank; ++levels_searched)
+  {
+    // Scan at this level, and its segments
+    const float * bank_current = bank_ranges_ema.row(current_level);
+    SegmentTable & segments_current = row_segments[current_level];
+    
+    // Check range; a valid point always belongs to a segment
+    const Segment * segment_found = segments_current.find(index_mean_current);
+    if (segment_found == NULL)
+    {
+      *index_min_old = -1;
+      *index_mean_old = -1;
+      *index_max_old = -1;
+      *range_sum_old = 0;
+      *range_at_min_index_old = 0;
+      *range_at_max_index_old = 0;
+      return;
+    }
+    const Segment & segment = *segment_found;
+    const bool wrap_around = segments_current.wraps_around;
+    
+    // Find the end indices of the object, with possible wrap around
+    unsigned int left = segment.index_begin;
+    unsigned int right = segment.index_end;
+    unsigned int width_in_points = segment.nr_points;
+    float range_sum = segment.range_sum;
+    if (segment.nr_points == points_per_scan)
+    {
+      // The whole scan; searching the lower index side first, we continue from the highest index
+      if (wrap_around && index_mean_current < points_per_scan - 1)
+      {
+        left = index_mean_current + 1;
+        right = index_mean_current;
+      }
+    }
+    else if (wrap_around && segment.index_begin == 0)
+    {
+      // Continue from highest index
+      const Segment & segment_wrapped = segments_current.segments.back();
+      left = segment_wrapped.index_begin;
+      width_in_points += segment_wrapped.nr_points;
+      range_sum += segment_wrapped.range_sum;
+    }
+    else if (wrap_around && segment.index_end == points_per_scan - 1)
+    {
+      // Continue from lowest index (0)
+      const Segment & segment_wrapped = segments_current.segments.front();
+      right = segment_wrapped.index_end;
+      width_in_points += segment_wrapped.nr_points;
+      range_sum += segment_wrapped.range_sum;
+    }
+    *range_at_min_index_old = bank_current[left];
+    *range_at_max_index_old = bank_current[right];
+    
+    // Did we find a valid object?
+    if (width_in_points < bank_argument.object_threshold_min_nr_points  ||
+        bank_argument.object_threshold_max_delta_width_in_points < abs(width_in_points - width_in_points_newer)  ||
+        bank_argument.object_threshold_bank_tracking_max_delta_distance  < 
+          fabs(range_sum / width_in_points - *range_sum_old / width_in_points_newer))
+      // range_sum_old holds the range sum of the previous (newer) scanned object
+    {
+      // No
+      misses++;
+      if (threshold_consecutive_failures_to_find_object < misses)
+      {
+        // Return -1 to signal that no index_mean was found
+        *index_min_old = -1;
+        *index_mean_old = -1;
+        *index_max_old = -1;
+        *range_sum_old = 0;
+        *range_at_min_index_old = 0;
+        *range_at_max_index_old = 0;
+        return;
+      }
+    }
+    else
+    {
+      // Yes
+      misses = 0;
+    }
+    
+    // If reaching this point, a valid object was found
+    // Update end points
+    *index_min_old = left;
+    *index_mean_old = (left + (width_in_points-1) / 2) % points_per_scan;
+    *index_max_old = right;
+    *range_sum_old = range_sum;
+    
+    // Continue searching based on the new index_mean
+    width_in_points_newer = width_in_points;
+    index_mean_current = *index_mean_old;
+    current_level = (current_level - 1) < 0 ? bank_argument.nr_scans_in_bank - 1 : current_level - 1; // wrap around
+  }
+}
+
+
+/*
+ * Segment a row that has just been written; it does not change while it remains in the bank
+ */
+void BankCore::segmentInsertedRow(const int row)
+{
+  segmentRow(row, tracking_range_max, &row_segments[row]);
+  
+  // The ranges beyond object_threshold_max_distance are valid when finding objects in the newest scan
+  if (tracking_range_max < bank_argument.range_max)
+  {
+    segmentRow(row, bank_argument.range_max, &newest_segments);
+  }
+}
+
+
+/*
+ * Find the segment containing a scan point, i.e. the last one beginning at or before it
+ */
+const Segment * SegmentTable::find(const unsigned int index)
+{
+  const unsigned int size = index_begin.size();
+  if (size == 0)
+  {
+    return NULL;
+  }
+  
+  // Objects are tracked in increasing index order, so search onwards from the previously found segment first
+  unsigned int lower = 0;
+  unsigned int upper = size;
+  if (size <= index_found)
+  {
+    index_found = 0;
+  }
+  if (index_begin[index_found] <= index)
+  {
+    unsigned int step = 1;
+    lower = index_found;
+    while (lower + step < size &&
+           index_begin[lower + step] <= index)
+    {
+      lower += step;
+      step *= 2;
+    }
+    upper = (lower + step < size ? lower + step : size);
+    lower++;
+  }
+  else
+  {
+    upper = index_found;
+  }
+  
+  // Binary search in [lower,upper); the segment searched for precedes lower
+  while (lower < upper)
+  {
+    const unsigned int middle = (lower + upper) / 2;
+    if (index_begin[middle] <= index)
+    {
+      lower = middle + 1;
+    }
+    else
+    {
+      upper = middle;
+    }
+  }
+  
+  if (lower == 0 ||
+      segments[lower-1].index_end < index)
+  {
+    return NULL;
+  }
+  index_found = lower - 1;
+  return &segments[lower-1];
+}
+
+
+/*
+ * Split a row of the bank into segments of ranges within [range_min,range_max]
+ */
+void BankCore::segmentRow(const int row, const float range_max, SegmentTable * segment_table)
+{
+  std::vector<Segment> & segments = segment_table->segments;
+  const float * bank_row = bank_ranges_ema.row(row);
+  const unsigned int nr_words = segment_valid_bits.size();
+  uint64_t * valid_bits = &segment_valid_bits[0];
+  uint64_t * link_bits = &segment_link_bits[0];
+  
+  kernels.segmentMask(bank_row,
+                      bank_argument.points_per_scan,
+                      bank_argument.range_min,
+                      range_max,
+                      segment_max_delta_range,
+                      valid_bits,
+                      link_bits);
+  
+  segments.clear();
+  for (unsigned int w=0; w<nr_words; ++w)
+  {
+    // A segment begins at a valid point that is not linked to the point before it
+    uint64_t begins = valid_bits[w] & ~link_bits[w];
+    while (begins != 0)
+    {
+      const unsigned int index_begin = w * 64 + __builtin_ctzll(begins);
+      begins &= begins - 1;
+      
+      // ...and ends at the point before the first following point that is not linked to its predecessor
+      // (there is always one, since the masks have room for at least one cleared bit after the last point)
+      unsigned int e = (index_begin + 1) / 64;
+      uint64_t not_linked = ~link_bits[e] & (~(uint64_t) 0 << ((index_begin + 1) % 64));
+      while (not_linked == 0)
+      {
+        not_linked = ~link_bits[++e];
+      }
+      const unsigned int index_end = e * 64 + __builtin_ctzll(not_linked) - 1;
+      
+      segments.resize(segments.size() + 1);
+      Segment & segment = segments.back();
+      segment.index_begin = index_begin;
+      segment.index_end = index_end;
+      segment.nr_points = index_end - index_begin + 1;
+      segment.index_mean = index_begin + (segment.nr_points - 1) / 2;
+      segment.range_at_begin = bank_row[index_begin];
+      segment.range_at_end = bank_row[index_end];
+      
+      // Sum and min/max of the ranges
+      kernels.segmentStats(bank_row + index_begin,
+                           segment.nr_points,
+                           &segment.range_sum,
+                           &segment.range_min,
+                           &segment.range_min_index,
+                           &segment.range_max,
+                           &segment.range_max_index);
+      segment.range_min_index += index_begin;
+      segment.range_max_index += index_begin;
+    }
+  }
+  
+  segment_table->index_begin.resize(segments.size());
+  for (unsigned int s=0; s<segments.size(); ++s)
+  {
+    segment_table->index_begin[s] = segments[s].index_begin;
+  }
+  
+  const unsigned int last = bank_argument.points_per_scan - 1;
+  segment_table->wraps_around = !segments.empty()  &&
+                                segments.front().index_begin == 0  &&
+                                segments.back().index_end == last  &&
+                                fabsf(bank_row[last] - bank_row[0]) <= 
+                                  bank_argument.object_threshold_edge_max_delta_range;
+  segment_table->index_found = 0;
+}
+
+
+/*
+ * Find objects in the newest scan and track them through the bank
+ */
+long BankCore::findObjects(std::vector<TrackedObject> * tracked_objects)
+{
+  tracked_objects->clear();
+  
+  // Is the bank filled with scans?
+  if (!bank_is_filled)
+  {
+    return -1;
+  }
+  
+  /* Find objects in the new scans */
+  unsigned int nr_objects_found = 0;
+  
+  // Difference in time between the oldest and newest scans
+  const double dt = bank_stamp[bank_index_newest] - bank_stamp[bank_index_put];
+  
+  // The newest scan
+  const float * bank_newest = bank_ranges_ema.row(bank_index_newest);
+  
+  // Its segments, found when it was added
+  const std::vector<Segment> & segments = (tracking_range_max < bank_argument.range_max  ?
+                                           newest_segments.segments : row_segments[bank_index_newest].segments);
+  
+  // Handle 360 degrees sensors!
+  // If the first segment starts at 0, then we must also search higher end of scan points and account for these
+  unsigned int upper_limit_out_of_bounds_scan_point = bank_argument.points_per_scan;
+  Segment segment_wrapped; // The first segment, continued from the highest index
+  const bool first_segment_wraps_around = bank_argument.sensor_is_360_degrees  &&
+                                          !segments.empty()  &&
+                                          segments[0].index_begin == 0;
+  if (first_segment_wraps_around)
+  {
+    Segment & segment = segment_wrapped;
+    segment = segments[0];
+    float prev_range = segment.range_at_begin;
+    
+    // Do not step all the way to the end of the segment again - it has already been considered
+    for (unsigned int k=bank_argument.points_per_scan-1; segment.index_end+1<k; k--)
+    {
+      const float range_k = bank_newest[k];
+      
+      // Range check
+      if (bank_argument.range_min <= range_k  &&
+          range_k <= bank_argument.range_max  &&
+          fabsf(prev_range - range_k) <= bank_argument.object_threshold_edge_max_delta_range)
+      {
+        // k is part of the current object
+        segment.nr_points++;
+        segment.range_sum += range_k;
+        
+        // Adapt the loop upper limit
+        upper_limit_out_of_bounds_scan_point--;
+        
+        // Update min and max ranges
+        if (range_k < segment.range_min) 
+        {
+          segment.range_min = range_k;
+          segment.range_min_index = k;
+        }
+        else if (segment.range_max < range_k) 
+        {
+          segment.range_max = range_k;
+          segment.range_max_index = k;
+        }
+        prev_range = range_k;
+      }
+      else
+      {
+        // k is not part of this object
+        break;
+      }
+    }
+    
+    // Update range at begin; it might not be the range at 0 anymore
+    segment.range_at_begin = prev_range;
+    segment.index_begin = upper_limit_out_of_bounds_scan_point;
+    segment.index_mean = (segment.index_begin + (segment.nr_points - 1) / 2) % bank_argument.points_per_scan;
+                         // Accounts for 360 deg sensor => index_end might be smaller than index_begin
+  }
+  
+  for (unsigned int s=0; s<segments.size(); ++s)
+  {
+    const Segment & segment = (s == 0 && first_segment_wraps_around ? segment_wrapped : segments[s]);
+    
+    // Segments that begin among the points added to the first segment above have already been considered
+    if (0 < s && upper_limit_out_of_bounds_scan_point <= segment.index_begin)
+    {
+      break;
+    }
+    
+    const unsigned int nr_object_points = segment.nr_points;
+    const float object_range_sum = segment.range_sum;
+    const float object_range_min = segment.range_min;
+    const unsigned int object_range_min_index = segment.range_min_index;
+    const float range_at_angle_begin = segment.range_at_begin;
+    const float range_at_angle_end = segment.range_at_end;
+    const unsigned int index_at_angle_begin = segment.index_begin;
+    const unsigned int index_at_angle_end = segment.index_end;
+    
+    // Threshold check
+    if (bank_argument.object_threshold_min_nr_points <= nr_object_points)
+    {
+      // Valid object
+      nr_objects_found++;
+      
+      // Derive the min, mean and max indices and the sum of all ranges of the object (if found) 
+      // in the oldest scans in the bank
+      const unsigned int index_min = index_at_angle_begin;
+      const unsigned int index_max = index_at_angle_end;
+      const unsigned int index_mean = segment.index_mean;
+      int index_min_old = -1;
+      int index_mean_old = -1;
+      int index_max_old = -1;
+      float range_sum_old = object_range_sum;
+      float range_at_min_index_old = 0;
+      float range_at_max_index_old = 0;
+      getOldIndices(nr_object_points,
+                    index_mean,
+                    0, // threshold for consecutive misses; 0 -> allow no misses
+                    &index_min_old,
+                    &index_mean_old,
+                    &index_max_old,
+                    &range_sum_old,
+                    &range_at_min_index_old,
+                    &range_at_max_index_old);
+      
+      // Could we track object?
+      if (0 <= index_mean_old)
+      {
+        // YES!
+        tracked_objects->resize(tracked_objects->size() + 1);
+        TrackedObject & to = tracked_objects->back();
+        
+        /* Evaluate the found object (it consists of at least the ith scan) */
+        const float distance = object_range_sum / nr_object_points; // Average distance
+        to.seen_width = sqrt( range_at_angle_begin * 
+                              range_at_angle_begin + 
+                              range_at_angle_end * 
+                              range_at_angle_end - 
+                              2 * range_at_angle_begin * 
+                                  range_at_angle_end * 
+                                  cosf (bank_argument.angle_increment * nr_object_points)
+                            ); // This is the seen object width using the law of cosine
+        
+        to.seq = nr_objects_found;
+        to.index_min = index_min;
+        to.index_mean = index_mean;
+        to.index_max = index_max;
+        to.nr_points = nr_object_points;
+        to.angle_begin = index_min * bank_argument.angle_increment + bank_argument.angle_min;
+        to.angle_end   = index_max * bank_argument.angle_increment + bank_argument.angle_min;
+        to.angle_mean  = index_mean * bank_argument.angle_increment + bank_argument.angle_min;
+        to.distance_at_angle_begin = range_at_angle_begin;
+        to.distance_at_angle_end   = range_at_angle_end;
+        // Position is dependent on the distance and angle_mean
+        // Reference coordinate system (relation to the Lidar):
+        //   x: forward
+        //   y: left
+        //   z: up        
+        to.distance = distance;
+        
+        // Optical frame?
+        if (bank_argument.sensor_frame_has_z_axis_forward)
+        {
+          // Yes, Z-axis forward, X-axis right, Y-axis down
+          to.position[0] = (double) - distance * sinf(to.angle_mean);
+          to.position[1] = 0.0;
+          to.position[2] = (double) distance * cosf(to.angle_mean);
+        }
+        else
+        {
+          // No, X-axis forward, Y-axis left, Z-axis up
+          to.position[0] = (double) distance * cosf(to.angle_mean);
+          to.position[1] = (double) distance * sinf(to.angle_mean);
+          to.position[2] = 0.0;
+        }
+        
+        // This will be negated rotation around the Y-axis in the case of an optical frame!
+        to.angle_for_closest_distance = object_range_min_index * bank_argument.angle_increment + 
+                                        bank_argument.angle_min;
+        to.closest_distance = object_range_min;
+        
+        // Optical frame?
+        if (bank_argument.sensor_frame_has_z_axis_forward)
+        {
+          // Yes, Z-axis forward, X-axis right, Y-axis down
+          to.closest_point[0] = - object_range_min * sinf(to.angle_for_closest_distance);
+          to.closest_point[1] = 0.0;
+          to.closest_point[2] = object_range_min * cosf(to.angle_for_closest_distance);
+        }
+        else
+        {
+          // No, X-axis forward, Y-axis left, Z-axis up
+          to.closest_point[0] = object_range_min * cosf(to.angle_for_closest_distance);
+          to.closest_point[1] = object_range_min * sinf(to.angle_for_closest_distance);
+          to.closest_point[2] = 0.0;
+        }
+        
+        // Distance from sensor to object at old time
+        const unsigned int nr_object_points_old = (index_min_old <= index_max_old) ? 
+                                                  (index_max_old - index_min_old + 1) :
+                                                  bank_argument.points_per_scan - (index_min_old - index_max_old) + 1;
+        const float distance_old = range_sum_old / nr_object_points_old;
+        // distance is found at index_mean_old, this is the angle at which distance is found
+        const double distance_angle_old = index_mean_old * bank_argument.angle_increment + bank_argument.angle_min;
+        // Covered angle
+        const double covered_angle_old = nr_object_points_old * bank_argument.angle_increment;
+        // Width of old object
+        to.seen_width_old = sqrt( range_at_min_index_old * 
+                                  range_at_min_index_old + 
+                                  range_at_max_index_old * 
+                                  range_at_max_index_old - 
+                                  2 * range_at_min_index_old * 
+                                      range_at_max_index_old * 
+                                      cosf (covered_angle_old)
+                                ); // This is the seen object width using the law of cosine
+        
+        // Coordinates at old time
+        if (bank_argument.sensor_frame_has_z_axis_forward)
+        {
+          // Yes, Z-axis forward, X-axis right, Y-axis down
+          to.position_old[0] = - distance_old * sinf(distance_angle_old);
+          to.position_old[1] = 0.0;
+          to.position_old[2] = distance_old * cosf(distance_angle_old);
+        }
+        else
+        {
+          to.position_old[0] = distance_old * cosf(distance_angle_old);
+          to.position_old[1] = distance_old * sinf(distance_angle_old);
+          to.position_old[2] = 0.0;
+        }
+        
+        // Velocity, speed and normalized velocity
+        to.dt = dt;
+        to.velocity[0] = (to.position[0] - to.position_old[0]) / dt;
+        to.velocity[1] = (to.position[1] - to.position_old[1]) / dt;
+        to.velocity[2] = (to.position[2] - to.position_old[2]) / dt;
+        to.speed = sqrt(to.velocity[0] * to.velocity[0]  +  
+                        to.velocity[1] * to.velocity[1]  +  
+                        to.velocity[2] * to.velocity[2]);
+        
+        // Avoid division by 0
+        if (0 < to.speed)
+        {
+          to.velocity_normalized[0] = to.velocity[0] / to.speed;
+          to.velocity_normalized[1] = to.velocity[1] / to.speed;
+          to.velocity_normalized[2] = to.velocity[2] / to.speed;
+        }
+        else
+        {
+          to.velocity_normalized[0] = 0.0;
+          to.velocity_normalized[1] = 0.0;
+          to.velocity_normalized[2] = 0.0;
+        }
+      }
+    }
+  }
+  
+  return 0;
+}
+
+
+// Resets the ranges at the put index to a value that is larger than the largest allowed (threshold_distance_max)
+float * BankCore::startPut(const double stamp)
+{
+  bank_stamp[bank_index_put] = stamp;
+  
+  const double range = bank_argument.object_threshold_max_distance + 10.0;
+  float * bank_put = bank_ranges_ema.row(bank_index_put);
+  for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
+  {
+    bank_put[i] = range;
+  }
+  
+  return bank_put;
+}
+
+
+float * BankCore::startFirstPut(const double stamp)
+{
+  // Set put index so that we can use the helper functions
+  bank_index_put = 0;
+  
+  return startPut(stamp);
+}
+
+
+void BankCore::finishFirstPut()
+{
+  segmentInsertedRow(0);
+  
+  // Set put to 1 and newest to 0
+  initIndex();
+  bank_is_filled = false;
+}
+
+
+void BankCore::finishPut()
+{
+  // EMA-adapt the new ranges
+  emaPutRanges();
+  segmentInsertedRow(bank_index_put);
+  
+  // Update indices
+  advanceIndex();
+  if (bank_index_put < bank_index_newest)
+  {
+    bank_is_filled = true;
+  }
+  
+  adaptToRate();
+}
+
+
+// Assumes that bank[bank_index_put] is filled with ranges from a new message 
+// (i.e. that indices have not yet been updated).
+// These values are EMA-adapted based on the previous set of EMA-adapted values at bank[index_previous]
+void BankCore::emaPutRanges()
+{
+  const double alpha = bank_argument.ema_alpha;
+  
+  // No need to do this if alpha < 1.0!
+  if (alpha < 1.0)
+  {
+    const double alpha_prev = 1.0 - alpha;
+    kernels.ema(bank_ranges_ema.row(bank_index_put),
+                bank_ranges_ema.row(bank_index_newest),
+                bank_argument.points_per_scan,
+                alpha,
+                alpha_prev);
+  }
+}
+
+
+// Debug/print bank column/msg
+std::string BankCore::getStringPutRanges()
+{
+  float * bank_put = bank_ranges_ema.row(bank_index_put);  
+  std::ostringstream stream;
+  stream << "Bank points (at put index):";
+  for (unsigned int i=0; i<bank_argument.points_per_scan; ++i)
+  {
+    stream << " " << bank_put[i];
+  }
+  stream << std::endl;
+  std::string string = stream.str();
+  return string;
+}
+
+
+// Init indices
+inline void BankCore::initIndex()
+{
+  bank_index_put = 1;
+  bank_index_newest = 0;
+}
+
+
+// Advance indices
+inline void BankCore::advanceIndex()
+{
+  bank_index_put = (bank_index_put + 1) % bank_argument.nr_scans_in_bank; // points to the oldest message
+  bank_index_newest = (bank_index_newest + 1) % bank_argument.nr_scans_in_bank; // points to the newest/this message
+}
+
+
+// Add FIRST scan to bank - no ema
+long BankCore::addFirstScan(const float * ranges, const double stamp)
+{
+  bank_stamp[0] = stamp;
+  
+  // Sanitize only; alpha=1 and alpha_prev=0
+  kernels.sanitizeEma(ranges,
+                      ranges,
+                      bank_ranges_ema.row(0),
+                      bank_argument.points_per_scan,
+                      1.0f,
+                      0.0f,
+                      bank_argument.range_max + 0.01,  // +inf and NaN
+                      bank_argument.range_min - 0.01); // -inf
+  segmentInsertedRow(0);
+  
+  initIndex(); // set put to 1 and newest to 0
+  bank_is_filled = false;
+  
+  return 0;
+}
+
+
+// Add scan and perform EMA
+long BankCore::addScan(const float * ranges, const double stamp)
+{
+  // Save timestamp
+  bank_stamp[bank_index_put] = stamp;
+  
+  // Save EMA of sanitized ranges
+  const double alpha = bank_argument.ema_alpha;
+  const double alpha_prev = 1.0 - bank_argument.ema_alpha;
+  kernels.sanitizeEma(ranges,
+                      bank_ranges_ema.row(bank_index_newest),
+                      bank_ranges_ema.row(bank_index_put),
+                      bank_argument.points_per_scan,
+                      alpha,
+                      alpha_prev,
+                      bank_argument.range_max + 0.01,  // +inf and NaN
+                      bank_argument.range_min - 0.01); // -inf
+  segmentInsertedRow(bank_index_put);
+  
+  advanceIndex();
+  if (!bank_is_filled && bank_index_put < bank_index_newest)
+  {
+    bank_is_filled = true;
+  }
+  
+  adaptToRate();
+  
+  return 0;
+}
+
+
+/*
+ * The number of scans covering a time at a rate, as when the rate of the topic is calculated by the interpreters
+ */
+int BankCore::getNrScansForTime(const double time, const double rate)
+{
+  const double nr_scans = time * rate;
+  const int nr_scans_for_time = nr_scans - ((long) nr_scans) == 0.0 ? nr_scans + 1 : ceil(nr_scans);
+  return nr_scans_for_time < 2 ? 2 : nr_scans_for_time;
+}
+
+
+/*
+ * Resize the bank, copying the newest scans, oldest first, to the first slots of the new bank
+ */
+long BankCore::resize(const int nr_scans_in_bank)
+{
+  if (!bank_is_initialized ||
+      nr_scans_in_bank < 2)
+  {
+    return -1;
+  }
+  
+  if (nr_scans_in_bank == bank_argument.nr_scans_in_bank)
+  {
+    return 0;
+  }
+  
+  BankStorage resized_ranges_ema;
+  if (resized_ranges_ema.allocate(nr_scans_in_bank, bank_argument.points_per_scan) != 0)
+  {
+    return -1;
+  }
+  std::vector<double> resized_stamp(nr_scans_in_bank, 0.0);
+  std::vector<SegmentTable> resized_row_segments(nr_scans_in_bank, SegmentTable());
+  
+  // Has any scan been added?
+  if (0 <= bank_index_newest)
+  {
+    const int nr_scans = bank_is_filled ? bank_argument.nr_scans_in_bank : bank_index_newest + 1;
+    const int nr_kept_scans = std::min(nr_scans, nr_scans_in_bank);
+    int row = bank_index_newest - nr_kept_scans + 1;
+    if (row < 0)
+    {
+      row += bank_argument.nr_scans_in_bank; // wrap around
+    }
+    for (int i=0; i<nr_kept_scans; ++i)
+    {
+      memcpy(resized_ranges_ema.row(i), 
+             bank_ranges_ema.row(row), 
+             bank_argument.points_per_scan * sizeof(float));
+      resized_stamp[i] = bank_stamp[row];
+      std::swap(resized_row_segments[i], row_segments[row]);
+      row = (row + 1) % bank_argument.nr_scans_in_bank;
+    }
+    
+    // The next scan is put after the newest one, the bank is filled if that is the oldest one
+    bank_index_newest = nr_kept_scans - 1;
+    bank_index_put = nr_kept_scans % nr_scans_in_bank;
+    bank_is_filled = nr_kept_scans == nr_scans_in_bank;
+  }
+  
+  bank_ranges_ema.swap(resized_ranges_ema);
+  bank_stamp.swap(resized_stamp);
+  row_segments.swap(resized_row_segments);
+  bank_argument.nr_scans_in_bank = nr_scans_in_bank;
+  
+  return 0;
+}
+
+
+/*
+ * Estimate the rate of the scans from the time that the filled bank covers, and resize the bank if the rate has 
+ * changed so much that another number of scans is needed to cover adapt_nr_scans_in_bank_time
+ */
+void BankCore::adaptToRate()
+{
+  if (bank_argument.adapt_nr_scans_in_bank_time <= 0.0)
+  {
+    return;
+  }
+  
+  // The rate is estimated once all scans in the bank have been added since the bank was last adapted, so that 
+  // scans received at the previous rate do not make it adapt again
+  ++nr_scans_since_adapted;
+  if (!bank_is_filled ||
+      (0.0 < adapted_rate && nr_scans_since_adapted < bank_argument.nr_scans_in_bank))
+  {
+    return;
+  }
+  
+  const double dt = bank_stamp[bank_index_newest] - bank_stamp[bank_index_put];
+  if (dt <= 0.0)
+  {
+    return;
+  }
+  const double rate = (bank_argument.nr_scans_in_bank - 1) / dt;
+  
+  int nr_scans_in_bank = getNrScansForTime(bank_argument.adapt_nr_scans_in_bank_time, rate);
+  if (bank_argument.max_nr_scans_in_bank < nr_scans_in_bank)
+  {
+    nr_scans_in_bank = bank_argument.max_nr_scans_in_bank;
+  }
+  
+  // A bank sized for the time at this rate covers up to one scan less than the time. The bank is only resized if 
+  // the time that it covers is outside of that by more than the tolerance, so that jitter in the rate, e.g. right 
+  // after the bank has been filled at the rate that sized it, does not resize it back and forth; resizing would 
+  // also empty the bank for no reason (a grown bank is not filled). The first rate that does not resize the bank 
+  // is kept as the one that the bank is adapted to.
+  const double time = bank_argument.adapt_nr_scans_in_bank_time;
+  const double scan_time = 1.0 / rate;
+  const double covered_time = (bank_argument.nr_scans_in_bank - 1) * scan_time;
+  const double tolerance = TIME_TOLERANCE * time;
+  if (nr_scans_in_bank == bank_argument.nr_scans_in_bank ||
+      (time - scan_time - tolerance <= covered_time && covered_time <= time + tolerance))
+  {
+    if (adapted_rate <= 0.0)
+    {
+      adapted_rate = rate;
+      nr_scans_since_adapted = 0;
+    }
+    return;
+  }
+  
+  // If the bank could not be resized, then it is tried again when the next scan is added
+  if (resize(nr_scans_in_bank) == 0)
+  {
+    adapted_rate = rate;
+    nr_scans_since_adapted = 0;
+  }
+}
+
+} // namespace find_moving_objects
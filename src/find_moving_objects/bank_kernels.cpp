@@ -0,0 +1,1012 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+/* SIMD */
+#if defined(__x86_64__) || defined(__i386__)
+# define BANK_KERNELS_X86
+# include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define BANK_KERNELS_NEON
+# include <arm_neon.h>
+#endif
+
+/* Local includes */
+#include <find_moving_objects/bank_kernels.h>
+
+
+namespace find_moving_objects
+{
+
+/* SCALAR */
+// Also used for the remaining ranges of the SIMD kernels
+static void sanitizeEmaScalar(const float * ranges,
+                              const float * ranges_newest,
+                              float * ranges_put,
+                              const unsigned int nr_ranges,
+                              const float alpha,
+                              const float alpha_prev,
+                              const float value_pos_inf_nan,
+                              const float value_neg_inf)
+{
+  const float neg_inf = -std::numeric_limits<float>::infinity();
+  const float pos_inf =  std::numeric_limits<float>::infinity();
+  for (unsigned int i=0; i<nr_ranges; ++i)
+  {
+    const float range = ranges[i];
+    const float ema = alpha * range + alpha_prev * ranges_newest[i];
+    const float value = (range != range || range == pos_inf) ? value_pos_inf_nan : ema;
+    ranges_put[i] = (range == neg_inf) ? value_neg_inf : value;
+  }
+}
+
+
+static void emaScalar(float * ranges_put,
+                      const float * ranges_newest,
+                      const unsigned int nr_ranges,
+                      const float alpha,
+                      const float alpha_prev)
+{
+  for (unsigned int i=0; i<nr_ranges; ++i)
+  {
+    ranges_put[i] = alpha * ranges_put[i] + alpha_prev * ranges_newest[i];
+  }
+}
+
+
+static void minimumScalar(double * values,
+                          const double * other_values,
+                          const unsigned int nr_values)
+{
+  for (unsigned int i=0; i<nr_values; ++i)
+  {
+    values[i] = (other_values[i] < values[i] ? other_values[i] : values[i]);
+  }
+}
+
+
+// Clears both masks, as the kernels below only set bits
+static inline void clearSegmentMasks(const unsigned int nr_ranges,
+                                     uint64_t * valid_bits,
+                                     uint64_t * link_bits)
+{
+  const unsigned int nr_words = nr_ranges / 64 + 1;
+  memset(valid_bits, 0, nr_words * sizeof(uint64_t));
+  memset(link_bits, 0, nr_words * sizeof(uint64_t));
+}
+
+
+// Sets the bits of the points in [begin,end)
+static inline void segmentMaskPoints(const float * ranges,
+                                     const unsigned int begin,
+                                     const unsigned int end,
+                                     const float range_min,
+                                     const float range_max,
+                                     const float max_delta_range,
+                                     uint64_t * valid_bits,
+                                     uint64_t * link_bits)
+{
+  for (unsigned int i=begin; i<end; ++i)
+  {
+    const float range = ranges[i];
+    const bool valid = range_min <= range && range <= range_max;
+    const bool link = valid && 
+                      0 < i && 
+                      range_min <= ranges[i-1] && 
+                      ranges[i-1] <= range_max && 
+                      fabsf(range - ranges[i-1]) <= max_delta_range;
+    valid_bits[i / 64] |= (uint64_t) valid << (i % 64);
+    link_bits[i / 64]  |= (uint64_t) link  << (i % 64);
+  }
+}
+
+
+static void segmentMaskScalar(const float * ranges,
+                              const unsigned int nr_ranges,
+                              const float range_min,
+                              const float range_max,
+                              const float max_delta_range,
+                              uint64_t * valid_bits,
+                              uint64_t * link_bits)
+{
+  clearSegmentMasks(nr_ranges, valid_bits, link_bits);
+  segmentMaskPoints(ranges, 0, nr_ranges, range_min, range_max, max_delta_range, valid_bits, link_bits);
+}
+
+
+// The fixed order in which the eight partial sums of the segment statistics are added
+static inline float addPartialSums(const float * sums)
+{
+  return ((sums[0] + sums[4]) + (sums[2] + sums[6])) + ((sums[1] + sums[5]) + (sums[3] + sums[7]));
+}
+
+
+// Adds the remaining ranges and finds the first occurrences of the minimum and maximum
+static inline void finishSegmentStats(const float * ranges,
+                                      const unsigned int nr_ranges,
+                                      const unsigned int i_remaining,
+                                      float sum,
+                                      const float min,
+                                      const float max,
+                                      float * range_sum,
+                                      float * range_min,
+                                      unsigned int * range_min_index,
+                                      float * range_max,
+                                      unsigned int * range_max_index)
+{
+  for (unsigned int i=i_remaining; i<nr_ranges; ++i)
+  {
+    sum += ranges[i];
+  }
+  
+  unsigned int min_index = 0;
+  while (ranges[min_index] != min)
+  {
+    min_index++;
+  }
+  unsigned int max_index = 0;
+  while (ranges[max_index] != max)
+  {
+    max_index++;
+  }
+  
+  *range_sum = sum;
+  *range_min = min;
+  *range_min_index = min_index;
+  *range_max = max;
+  *range_max_index = max_index;
+}
+
+
+static void segmentStatsScalar(const float * ranges,
+                               const unsigned int nr_ranges,
+                               float * range_sum,
+                               float * range_min,
+                               unsigned int * range_min_index,
+                               float * range_max,
+                               unsigned int * range_max_index)
+{
+  float sums[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  float min = ranges[0];
+  float max = ranges[0];
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    for (unsigned int k=0; k<8; ++k)
+    {
+      sums[k] += ranges[i+k];
+    }
+  }
+  for (unsigned int j=0; j<nr_ranges; ++j)
+  {
+    min = (ranges[j] < min ? ranges[j] : min);
+    max = (max < ranges[j] ? ranges[j] : max);
+  }
+  
+  finishSegmentStats(ranges, nr_ranges, i, addPartialSums(sums), min, max, 
+                     range_sum, range_min, range_min_index, range_max, range_max_index);
+}
+
+
+#ifdef BANK_KERNELS_X86
+/* SSE4.1 */
+__attribute__((target("sse4.1")))
+static void sanitizeEmaSSE41(const float * ranges,
+                             const float * ranges_newest,
+                             float * ranges_put,
+                             const unsigned int nr_ranges,
+                             const float alpha,
+                             const float alpha_prev,
+                             const float value_pos_inf_nan,
+                             const float value_neg_inf)
+{
+  const __m128 v_alpha = _mm_set1_ps(alpha);
+  const __m128 v_alpha_prev = _mm_set1_ps(alpha_prev);
+  const __m128 v_value_pos_inf_nan = _mm_set1_ps(value_pos_inf_nan);
+  const __m128 v_value_neg_inf = _mm_set1_ps(value_neg_inf);
+  const __m128 v_pos_inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  const __m128 v_neg_inf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+  
+  unsigned int i=0;
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    const __m128 range = _mm_loadu_ps(ranges + i);
+    const __m128 ema = _mm_add_ps(_mm_mul_ps(v_alpha, range), 
+                                  _mm_mul_ps(v_alpha_prev, _mm_loadu_ps(ranges_newest + i)));
+    const __m128 is_pos_inf_nan = _mm_or_ps(_mm_cmpunord_ps(range, range), _mm_cmpeq_ps(range, v_pos_inf));
+    const __m128 value = _mm_blendv_ps(ema, v_value_pos_inf_nan, is_pos_inf_nan);
+    _mm_storeu_ps(ranges_put + i, _mm_blendv_ps(value, v_value_neg_inf, _mm_cmpeq_ps(range, v_neg_inf)));
+  }
+  
+  sanitizeEmaScalar(ranges + i, ranges_newest + i, ranges_put + i, nr_ranges - i, 
+                    alpha, alpha_prev, value_pos_inf_nan, value_neg_inf);
+}
+
+
+__attribute__((target("sse4.1")))
+static void emaSSE41(float * ranges_put,
+                     const float * ranges_newest,
+                     const unsigned int nr_ranges,
+                     const float alpha,
+                     const float alpha_prev)
+{
+  const __m128 v_alpha = _mm_set1_ps(alpha);
+  const __m128 v_alpha_prev = _mm_set1_ps(alpha_prev);
+  
+  unsigned int i=0;
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    _mm_storeu_ps(ranges_put + i, _mm_add_ps(_mm_mul_ps(v_alpha, _mm_loadu_ps(ranges_put + i)), 
+                                             _mm_mul_ps(v_alpha_prev, _mm_loadu_ps(ranges_newest + i))));
+  }
+  
+  emaScalar(ranges_put + i, ranges_newest + i, nr_ranges - i, alpha, alpha_prev);
+}
+
+
+__attribute__((target("sse4.1")))
+static void minimumSSE41(double * values,
+                         const double * other_values,
+                         const unsigned int nr_values)
+{
+  unsigned int i=0;
+  for (; i+2<=nr_values; i+=2)
+  {
+    _mm_storeu_pd(values + i, _mm_min_pd(_mm_loadu_pd(values + i), _mm_loadu_pd(other_values + i)));
+  }
+  
+  minimumScalar(values + i, other_values + i, nr_values - i);
+}
+
+
+// The valid and link bits of the 4 points from i (0 < i)
+__attribute__((target("sse4.1")))
+static inline void segmentMaskVectorSSE41(const float * ranges,
+                                          const unsigned int i,
+                                          const __m128 v_range_min,
+                                          const __m128 v_range_max,
+                                          const __m128 v_max_delta_range,
+                                          const __m128 v_abs,
+                                          uint64_t * valid_mask,
+                                          uint64_t * link_mask)
+{
+  const __m128 range = _mm_loadu_ps(ranges + i);
+  const __m128 range_prev = _mm_loadu_ps(ranges + i - 1);
+  const __m128 valid = _mm_and_ps(_mm_cmple_ps(v_range_min, range), _mm_cmple_ps(range, v_range_max));
+  const __m128 valid_prev = _mm_and_ps(_mm_cmple_ps(v_range_min, range_prev), _mm_cmple_ps(range_prev, v_range_max));
+  const __m128 close = _mm_cmple_ps(_mm_and_ps(_mm_sub_ps(range, range_prev), v_abs), v_max_delta_range);
+  *valid_mask = (unsigned int) _mm_movemask_ps(valid);
+  *link_mask = (unsigned int) _mm_movemask_ps(_mm_and_ps(_mm_and_ps(valid, valid_prev), close));
+}
+
+
+__attribute__((target("sse4.1")))
+static void segmentMaskSSE41(const float * ranges,
+                             const unsigned int nr_ranges,
+                             const float range_min,
+                             const float range_max,
+                             const float max_delta_range,
+                             uint64_t * valid_bits,
+                             uint64_t * link_bits)
+{
+  const __m128 v_range_min = _mm_set1_ps(range_min);
+  const __m128 v_range_max = _mm_set1_ps(range_max);
+  const __m128 v_max_delta_range = _mm_set1_ps(max_delta_range);
+  const __m128 v_abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  uint64_t valid_mask;
+  uint64_t link_mask;
+  
+  clearSegmentMasks(nr_ranges, valid_bits, link_bits);
+  
+  // The first point has no predecessor; i stays a multiple of 4 so that the bits of a vector share one word
+  unsigned int i = (nr_ranges < 4 ? nr_ranges : 4);
+  segmentMaskPoints(ranges, 0, i, range_min, range_max, max_delta_range, valid_bits, link_bits);
+  for (; i+4<=nr_ranges && i<64; i+=4)
+  {
+    segmentMaskVectorSSE41(ranges, i, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+    valid_bits[0] |= valid_mask << i;
+    link_bits[0]  |= link_mask  << i;
+  }
+  
+  // Whole words, gathered in registers
+  for (; i+64<=nr_ranges; i+=64)
+  {
+    uint64_t valid_word = 0;
+    uint64_t link_word = 0;
+    for (unsigned int k=0; k<64; k+=4)
+    {
+      segmentMaskVectorSSE41(ranges, i + k, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+      valid_word |= valid_mask << k;
+      link_word  |= link_mask  << k;
+    }
+    valid_bits[i / 64] = valid_word;
+    link_bits[i / 64]  = link_word;
+  }
+  
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    segmentMaskVectorSSE41(ranges, i, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+    valid_bits[i / 64] |= valid_mask << (i % 64);
+    link_bits[i / 64]  |= link_mask  << (i % 64);
+  }
+  
+  segmentMaskPoints(ranges, i, nr_ranges, range_min, range_max, max_delta_range, valid_bits, link_bits);
+}
+
+
+__attribute__((target("sse4.1")))
+static void segmentStatsSSE41(const float * ranges,
+                              const unsigned int nr_ranges,
+                              float * range_sum,
+                              float * range_min,
+                              unsigned int * range_min_index,
+                              float * range_max,
+                              unsigned int * range_max_index)
+{
+  __m128 sum_low = _mm_setzero_ps();
+  __m128 sum_high = _mm_setzero_ps();
+  __m128 min = _mm_set1_ps(ranges[0]);
+  __m128 max = min;
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    const __m128 range_low = _mm_loadu_ps(ranges + i);
+    const __m128 range_high = _mm_loadu_ps(ranges + i + 4);
+    sum_low = _mm_add_ps(sum_low, range_low);
+    sum_high = _mm_add_ps(sum_high, range_high);
+    min = _mm_min_ps(min, _mm_min_ps(range_low, range_high));
+    max = _mm_max_ps(max, _mm_max_ps(range_low, range_high));
+  }
+  
+  float sums[8];
+  float mins[4];
+  float maxs[4];
+  _mm_storeu_ps(sums, sum_low);
+  _mm_storeu_ps(sums + 4, sum_high);
+  _mm_storeu_ps(mins, min);
+  _mm_storeu_ps(maxs, max);
+  float min_all = mins[0];
+  float max_all = maxs[0];
+  for (unsigned int k=1; k<4; ++k)
+  {
+    min_all = (mins[k] < min_all ? mins[k] : min_all);
+    max_all = (max_all < maxs[k] ? maxs[k] : max_all);
+  }
+  for (unsigned int j=i; j<nr_ranges; ++j)
+  {
+    min_all = (ranges[j] < min_all ? ranges[j] : min_all);
+    max_all = (max_all < ranges[j] ? ranges[j] : max_all);
+  }
+  
+  finishSegmentStats(ranges, nr_ranges, i, addPartialSums(sums), min_all, max_all, 
+                     range_sum, range_min, range_min_index, range_max, range_max_index);
+}
+
+
+/* AVX2 */
+// Multiplications and additions are not fused, so that the results equal those of the scalar kernels
+__attribute__((target("avx2")))
+static void sanitizeEmaAVX2(const float * ranges,
+                            const float * ranges_newest,
+                            float * ranges_put,
+                            const unsigned int nr_ranges,
+                            const float alpha,
+                            const float alpha_prev,
+                            const float value_pos_inf_nan,
+                            const float value_neg_inf)
+{
+  const __m256 v_alpha = _mm256_set1_ps(alpha);
+  const __m256 v_alpha_prev = _mm256_set1_ps(alpha_prev);
+  const __m256 v_value_pos_inf_nan = _mm256_set1_ps(value_pos_inf_nan);
+  const __m256 v_value_neg_inf = _mm256_set1_ps(value_neg_inf);
+  const __m256 v_pos_inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+  const __m256 v_neg_inf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    const __m256 range = _mm256_loadu_ps(ranges + i);
+    const __m256 ema = _mm256_add_ps(_mm256_mul_ps(v_alpha, range), 
+                                     _mm256_mul_ps(v_alpha_prev, _mm256_loadu_ps(ranges_newest + i)));
+    const __m256 is_pos_inf_nan = _mm256_or_ps(_mm256_cmp_ps(range, range, _CMP_UNORD_Q), 
+                                               _mm256_cmp_ps(range, v_pos_inf, _CMP_EQ_OQ));
+    const __m256 value = _mm256_blendv_ps(ema, v_value_pos_inf_nan, is_pos_inf_nan);
+    _mm256_storeu_ps(ranges_put + i, _mm256_blendv_ps(value, 
+                                                      v_value_neg_inf, 
+                                                      _mm256_cmp_ps(range, v_neg_inf, _CMP_EQ_OQ)));
+  }
+  
+  sanitizeEmaScalar(ranges + i, ranges_newest + i, ranges_put + i, nr_ranges - i, 
+                    alpha, alpha_prev, value_pos_inf_nan, value_neg_inf);
+}
+
+
+__attribute__((target("avx2")))
+static void emaAVX2(float * ranges_put,
+                    const float * ranges_newest,
+                    const unsigned int nr_ranges,
+                    const float alpha,
+                    const float alpha_prev)
+{
+  const __m256 v_alpha = _mm256_set1_ps(alpha);
+  const __m256 v_alpha_prev = _mm256_set1_ps(alpha_prev);
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    _mm256_storeu_ps(ranges_put + i, _mm256_add_ps(_mm256_mul_ps(v_alpha, _mm256_loadu_ps(ranges_put + i)), 
+                                                   _mm256_mul_ps(v_alpha_prev, _mm256_loadu_ps(ranges_newest + i))));
+  }
+  
+  emaScalar(ranges_put + i, ranges_newest + i, nr_ranges - i, alpha, alpha_prev);
+}
+
+
+__attribute__((target("avx2")))
+static void minimumAVX2(double * values,
+                        const double * other_values,
+                        const unsigned int nr_values)
+{
+  unsigned int i=0;
+  for (; i+4<=nr_values; i+=4)
+  {
+    _mm256_storeu_pd(values + i, _mm256_min_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(other_values + i)));
+  }
+  
+  minimumScalar(values + i, other_values + i, nr_values - i);
+}
+
+
+// The valid and link bits of the 8 points from i (0 < i)
+__attribute__((target("avx2")))
+static inline void segmentMaskVectorAVX2(const float * ranges,
+                                         const unsigned int i,
+                                         const __m256 v_range_min,
+                                         const __m256 v_range_max,
+                                         const __m256 v_max_delta_range,
+                                         const __m256 v_abs,
+                                         uint64_t * valid_mask,
+                                         uint64_t * link_mask)
+{
+  const __m256 range = _mm256_loadu_ps(ranges + i);
+  const __m256 range_prev = _mm256_loadu_ps(ranges + i - 1);
+  const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(v_range_min, range, _CMP_LE_OQ), 
+                                     _mm256_cmp_ps(range, v_range_max, _CMP_LE_OQ));
+  const __m256 valid_prev = _mm256_and_ps(_mm256_cmp_ps(v_range_min, range_prev, _CMP_LE_OQ), 
+                                          _mm256_cmp_ps(range_prev, v_range_max, _CMP_LE_OQ));
+  const __m256 close = _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(range, range_prev), v_abs), 
+                                     v_max_delta_range, 
+                                     _CMP_LE_OQ);
+  *valid_mask = (unsigned int) _mm256_movemask_ps(valid);
+  *link_mask = (unsigned int) _mm256_movemask_ps(_mm256_and_ps(_mm256_and_ps(valid, valid_prev), close));
+}
+
+
+__attribute__((target("avx2")))
+static void segmentMaskAVX2(const float * ranges,
+                            const unsigned int nr_ranges,
+                            const float range_min,
+                            const float range_max,
+                            const float max_delta_range,
+                            uint64_t * valid_bits,
+                            uint64_t * link_bits)
+{
+  const __m256 v_range_min = _mm256_set1_ps(range_min);
+  const __m256 v_range_max = _mm256_set1_ps(range_max);
+  const __m256 v_max_delta_range = _mm256_set1_ps(max_delta_range);
+  const __m256 v_abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  uint64_t valid_mask;
+  uint64_t link_mask;
+  
+  clearSegmentMasks(nr_ranges, valid_bits, link_bits);
+  
+  // The first point has no predecessor; i stays a multiple of 8 so that the bits of a vector share one word
+  unsigned int i = (nr_ranges < 8 ? nr_ranges : 8);
+  segmentMaskPoints(ranges, 0, i, range_min, range_max, max_delta_range, valid_bits, link_bits);
+  for (; i+8<=nr_ranges && i<64; i+=8)
+  {
+    segmentMaskVectorAVX2(ranges, i, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+    valid_bits[0] |= valid_mask << i;
+    link_bits[0]  |= link_mask  << i;
+  }
+  
+  // Whole words, gathered in registers
+  for (; i+64<=nr_ranges; i+=64)
+  {
+    uint64_t valid_word = 0;
+    uint64_t link_word = 0;
+    for (unsigned int k=0; k<64; k+=8)
+    {
+      segmentMaskVectorAVX2(ranges, i + k, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+      valid_word |= valid_mask << k;
+      link_word  |= link_mask  << k;
+    }
+    valid_bits[i / 64] = valid_word;
+    link_bits[i / 64]  = link_word;
+  }
+  
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    segmentMaskVectorAVX2(ranges, i, v_range_min, v_range_max, v_max_delta_range, v_abs, &valid_mask, &link_mask);
+    valid_bits[i / 64] |= valid_mask << (i % 64);
+    link_bits[i / 64]  |= link_mask  << (i % 64);
+  }
+  
+  segmentMaskPoints(ranges, i, nr_ranges, range_min, range_max, max_delta_range, valid_bits, link_bits);
+}
+
+__attribute__((target("avx2")))
+static void segmentStatsAVX2(const float * ranges,
+                             const unsigned int nr_ranges,
+                             float * range_sum,
+                             float * range_min,
+                             unsigned int * range_min_index,
+                             float * range_max,
+                             unsigned int * range_max_index)
+{
+  __m256 sum = _mm256_setzero_ps();
+  __m256 min = _mm256_set1_ps(ranges[0]);
+  __m256 max = min;
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    const __m256 range = _mm256_loadu_ps(ranges + i);
+    sum = _mm256_add_ps(sum, range);
+    min = _mm256_min_ps(min, range);
+    max = _mm256_max_ps(max, range);
+  }
+  
+  float sums[8];
+  float mins[8];
+  float maxs[8];
+  _mm256_storeu_ps(sums, sum);
+  _mm256_storeu_ps(mins, min);
+  _mm256_storeu_ps(maxs, max);
+  float min_all = mins[0];
+  float max_all = maxs[0];
+  for (unsigned int k=1; k<8; ++k)
+  {
+    min_all = (mins[k] < min_all ? mins[k] : min_all);
+    max_all = (max_all < maxs[k] ? maxs[k] : max_all);
+  }
+  for (unsigned int j=i; j<nr_ranges; ++j)
+  {
+    min_all = (ranges[j] < min_all ? ranges[j] : min_all);
+    max_all = (max_all < ranges[j] ? ranges[j] : max_all);
+  }
+  
+  finishSegmentStats(ranges, nr_ranges, i, addPartialSums(sums), min_all, max_all, 
+                     range_sum, range_min, range_min_index, range_max, range_max_index);
+}
+#endif // BANK_KERNELS_X86
+
+
+#ifdef BANK_KERNELS_NEON
+/* NEON */
+static void sanitizeEmaNEON(const float * ranges,
+                            const float * ranges_newest,
+                            float * ranges_put,
+                            const unsigned int nr_ranges,
+                            const float alpha,
+                            const float alpha_prev,
+                            const float value_pos_inf_nan,
+                            const float value_neg_inf)
+{
+  const float32x4_t v_alpha = vdupq_n_f32(alpha);
+  const float32x4_t v_alpha_prev = vdupq_n_f32(alpha_prev);
+  const float32x4_t v_value_pos_inf_nan = vdupq_n_f32(value_pos_inf_nan);
+  const float32x4_t v_value_neg_inf = vdupq_n_f32(value_neg_inf);
+  const float32x4_t v_pos_inf = vdupq_n_f32(std::numeric_limits<float>::infinity());
+  const float32x4_t v_neg_inf = vdupq_n_f32(-std::numeric_limits<float>::infinity());
+  
+  unsigned int i=0;
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    const float32x4_t range = vld1q_f32(ranges + i);
+    const float32x4_t ema = vaddq_f32(vmulq_f32(v_alpha, range), 
+                                      vmulq_f32(v_alpha_prev, vld1q_f32(ranges_newest + i)));
+    // NaN is the only value not equal to itself
+    const uint32x4_t is_pos_inf_nan = vorrq_u32(vmvnq_u32(vceqq_f32(range, range)), vceqq_f32(range, v_pos_inf));
+    const float32x4_t value = vbslq_f32(is_pos_inf_nan, v_value_pos_inf_nan, ema);
+    vst1q_f32(ranges_put + i, vbslq_f32(vceqq_f32(range, v_neg_inf), v_value_neg_inf, value));
+  }
+  
+  sanitizeEmaScalar(ranges + i, ranges_newest + i, ranges_put + i, nr_ranges - i, 
+                    alpha, alpha_prev, value_pos_inf_nan, value_neg_inf);
+}
+
+
+static void emaNEON(float * ranges_put,
+                    const float * ranges_newest,
+                    const unsigned int nr_ranges,
+                    const float alpha,
+                    const float alpha_prev)
+{
+  const float32x4_t v_alpha = vdupq_n_f32(alpha);
+  const float32x4_t v_alpha_prev = vdupq_n_f32(alpha_prev);
+  
+  unsigned int i=0;
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    vst1q_f32(ranges_put + i, vaddq_f32(vmulq_f32(v_alpha, vld1q_f32(ranges_put + i)), 
+                                        vmulq_f32(v_alpha_prev, vld1q_f32(ranges_newest + i))));
+  }
+  
+  emaScalar(ranges_put + i, ranges_newest + i, nr_ranges - i, alpha, alpha_prev);
+}
+
+
+static void segmentStatsNEON(const float * ranges,
+                             const unsigned int nr_ranges,
+                             float * range_sum,
+                             float * range_min,
+                             unsigned int * range_min_index,
+                             float * range_max,
+                             unsigned int * range_max_index)
+{
+  float32x4_t sum_low = vdupq_n_f32(0.0f);
+  float32x4_t sum_high = vdupq_n_f32(0.0f);
+  float32x4_t min = vdupq_n_f32(ranges[0]);
+  float32x4_t max = min;
+  
+  unsigned int i=0;
+  for (; i+8<=nr_ranges; i+=8)
+  {
+    const float32x4_t range_low = vld1q_f32(ranges + i);
+    const float32x4_t range_high = vld1q_f32(ranges + i + 4);
+    sum_low = vaddq_f32(sum_low, range_low);
+    sum_high = vaddq_f32(sum_high, range_high);
+    min = vminq_f32(min, vminq_f32(range_low, range_high));
+    max = vmaxq_f32(max, vmaxq_f32(range_low, range_high));
+  }
+  
+  float sums[8];
+  float mins[4];
+  float maxs[4];
+  vst1q_f32(sums, sum_low);
+  vst1q_f32(sums + 4, sum_high);
+  vst1q_f32(mins, min);
+  vst1q_f32(maxs, max);
+  float min_all = mins[0];
+  float max_all = maxs[0];
+  for (unsigned int k=1; k<4; ++k)
+  {
+    min_all = (mins[k] < min_all ? mins[k] : min_all);
+    max_all = (max_all < maxs[k] ? maxs[k] : max_all);
+  }
+  for (unsigned int j=i; j<nr_ranges; ++j)
+  {
+    min_all = (ranges[j] < min_all ? ranges[j] : min_all);
+    max_all = (max_all < ranges[j] ? ranges[j] : max_all);
+  }
+  
+  finishSegmentStats(ranges, nr_ranges, i, addPartialSums(sums), min_all, max_all, 
+                     range_sum, range_min, range_min_index, range_max, range_max_index);
+}
+
+
+#ifdef __aarch64__
+// NEON has no movemask; weigh the lanes and add them horizontally (AArch64 only)
+static inline uint64_t movemaskNEON(const uint32x4_t mask)
+{
+  const uint32_t weights[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(mask, vld1q_u32(weights)));
+}
+
+
+// Vectors of doubles are AArch64 only
+static void minimumNEON(double * values,
+                        const double * other_values,
+                        const unsigned int nr_values)
+{
+  unsigned int i=0;
+  for (; i+2<=nr_values; i+=2)
+  {
+    vst1q_f64(values + i, vminq_f64(vld1q_f64(values + i), vld1q_f64(other_values + i)));
+  }
+  
+  minimumScalar(values + i, other_values + i, nr_values - i);
+}
+
+
+// The valid and link bits of the 4 points from i (0 < i)
+static inline void segmentMaskVectorNEON(const float * ranges,
+                                         const unsigned int i,
+                                         const float32x4_t v_range_min,
+                                         const float32x4_t v_range_max,
+                                         const float32x4_t v_max_delta_range,
+                                         uint64_t * valid_mask,
+                                         uint64_t * link_mask)
+{
+  const float32x4_t range = vld1q_f32(ranges + i);
+  const float32x4_t range_prev = vld1q_f32(ranges + i - 1);
+  const uint32x4_t valid = vandq_u32(vcleq_f32(v_range_min, range), vcleq_f32(range, v_range_max));
+  const uint32x4_t valid_prev = vandq_u32(vcleq_f32(v_range_min, range_prev), vcleq_f32(range_prev, v_range_max));
+  const uint32x4_t close = vcleq_f32(vabdq_f32(range, range_prev), v_max_delta_range);
+  *valid_mask = movemaskNEON(valid);
+  *link_mask = movemaskNEON(vandq_u32(vandq_u32(valid, valid_prev), close));
+}
+
+
+static void segmentMaskNEON(const float * ranges,
+                            const unsigned int nr_ranges,
+                            const float range_min,
+                            const float range_max,
+                            const float max_delta_range,
+                            uint64_t * valid_bits,
+                            uint64_t * link_bits)
+{
+  const float32x4_t v_range_min = vdupq_n_f32(range_min);
+  const float32x4_t v_range_max = vdupq_n_f32(range_max);
+  const float32x4_t v_max_delta_range = vdupq_n_f32(max_delta_range);
+  uint64_t valid_mask;
+  uint64_t link_mask;
+  
+  clearSegmentMasks(nr_ranges, valid_bits, link_bits);
+  
+  // The first point has no predecessor; i stays a multiple of 4 so that the bits of a vector share one word
+  unsigned int i = (nr_ranges < 4 ? nr_ranges : 4);
+  segmentMaskPoints(ranges, 0, i, range_min, range_max, max_delta_range, valid_bits, link_bits);
+  for (; i+4<=nr_ranges && i<64; i+=4)
+  {
+    segmentMaskVectorNEON(ranges, i, v_range_min, v_range_max, v_max_delta_range, &valid_mask, &link_mask);
+    valid_bits[0] |= valid_mask << i;
+    link_bits[0]  |= link_mask  << i;
+  }
+  
+  // Whole words, gathered in registers
+  for (; i+64<=nr_ranges; i+=64)
+  {
+    uint64_t valid_word = 0;
+    uint64_t link_word = 0;
+    for (unsigned int k=0; k<64; k+=4)
+    {
+      segmentMaskVectorNEON(ranges, i + k, v_range_min, v_range_max, v_max_delta_range, &valid_mask, &link_mask);
+      valid_word |= valid_mask << k;
+      link_word  |= link_mask  << k;
+    }
+    valid_bits[i / 64] = valid_word;
+    link_bits[i / 64]  = link_word;
+  }
+  
+  for (; i+4<=nr_ranges; i+=4)
+  {
+    segmentMaskVectorNEON(ranges, i, v_range_min, v_range_max, v_max_delta_range, &valid_mask, &link_mask);
+    valid_bits[i / 64] |= valid_mask << (i % 64);
+    link_bits[i / 64]  |= link_mask  << (i % 64);
+  }
+  
+  segmentMaskPoints(ranges, i, nr_ranges, range_min, range_max, max_delta_range, valid_bits, link_bits);
+}
+#endif // __aarch64__
+#endif // BANK_KERNELS_NEON
+
+
+/* POINT DECODERS */
+// The unsigned integer type with the same size as a coordinate type, used to reverse its bytes
+template<typename T> struct CoordinateBits;
+template<> struct CoordinateBits<float>  { typedef uint32_t type; };
+template<> struct CoordinateBits<double> { typedef uint64_t type; };
+
+static inline uint32_t reverseBytes(const uint32_t bits) { return __builtin_bswap32(bits); }
+static inline uint64_t reverseBytes(const uint64_t bits) { return __builtin_bswap64(bits); }
+
+template<typename T, bool REVERSE_BYTES>
+static inline double readCoordinate(const uint8_t * coordinate)
+{
+  typename CoordinateBits<T>::type bits;
+  memcpy(&bits, coordinate, sizeof(bits));
+  if (REVERSE_BYTES)
+  {
+    bits = reverseBytes(bits);
+  }
+  T value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+template<typename TX, typename TY, typename TZ, bool REVERSE_BYTES>
+static void decodePoints(const uint8_t * points,
+                         const unsigned int nr_points,
+                         const unsigned int point_step,
+                         const unsigned int x_offset,
+                         const unsigned int y_offset,
+                         const unsigned int z_offset,
+                         double * x,
+                         double * y,
+                         double * z)
+{
+  for (unsigned int i=0; i<nr_points; ++i)
+  {
+    const uint8_t * point = points + i * point_step;
+    x[i] = readCoordinate<TX, REVERSE_BYTES>(point + x_offset);
+    y[i] = readCoordinate<TY, REVERSE_BYTES>(point + y_offset);
+    z[i] = readCoordinate<TZ, REVERSE_BYTES>(point + z_offset);
+  }
+}
+
+// Float coordinates at offsets 0, 4 and 8 in the byte order of this CPU
+static void decodePackedFloats(const uint8_t * points,
+                               const unsigned int nr_points,
+                               const unsigned int point_step,
+                               const unsigned int x_offset,
+                               const unsigned int y_offset,
+                               const unsigned int z_offset,
+                               double * x,
+                               double * y,
+                               double * z)
+{
+  unsigned int i = 0;
+#if defined(BANK_KERNELS_X86) && defined(__SSE2__)
+  // Load four points (x, y, z and 4 more bytes of each) and transpose them into x, y and z vectors
+  if (16 <= point_step)
+  {
+    for (; i + 4 <= nr_points; i += 4)
+    {
+      const uint8_t * point = points + i * point_step;
+      __m128 p0 = _mm_loadu_ps(reinterpret_cast<const float *>(point));
+      __m128 p1 = _mm_loadu_ps(reinterpret_cast<const float *>(point + point_step));
+      __m128 p2 = _mm_loadu_ps(reinterpret_cast<const float *>(point + 2 * point_step));
+      __m128 p3 = _mm_loadu_ps(reinterpret_cast<const float *>(point + 3 * point_step));
+      _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+      _mm_storeu_pd(x + i,     _mm_cvtps_pd(p0));
+      _mm_storeu_pd(x + i + 2, _mm_cvtps_pd(_mm_movehl_ps(p0, p0)));
+      _mm_storeu_pd(y + i,     _mm_cvtps_pd(p1));
+      _mm_storeu_pd(y + i + 2, _mm_cvtps_pd(_mm_movehl_ps(p1, p1)));
+      _mm_storeu_pd(z + i,     _mm_cvtps_pd(p2));
+      _mm_storeu_pd(z + i + 2, _mm_cvtps_pd(_mm_movehl_ps(p2, p2)));
+    }
+  }
+#endif
+  decodePoints<float, float, float, false>(points + i * point_step, nr_points - i, point_step, 
+                                           x_offset, y_offset, z_offset, 
+                                           x + i, y + i, z + i);
+}
+
+template<typename TX, typename TY, typename TZ>
+static PointDecoderKernel selectPointDecoder(const bool must_reverse_bytes)
+{
+  return must_reverse_bytes ? decodePoints<TX, TY, TZ, true> : decodePoints<TX, TY, TZ, false>;
+}
+
+template<typename TX, typename TY>
+static PointDecoderKernel selectPointDecoder(const unsigned int z_bytes, const bool must_reverse_bytes)
+{
+  switch (z_bytes)
+  {
+    case sizeof(float):  return selectPointDecoder<TX, TY, float>(must_reverse_bytes);
+    case sizeof(double): return selectPointDecoder<TX, TY, double>(must_reverse_bytes);
+    default:             return NULL;
+  }
+}
+
+template<typename TX>
+static PointDecoderKernel selectPointDecoder(const unsigned int y_bytes, 
+                                             const unsigned int z_bytes, 
+                                             const bool must_reverse_bytes)
+{
+  switch (y_bytes)
+  {
+    case sizeof(float):  return selectPointDecoder<TX, float>(z_bytes, must_reverse_bytes);
+    case sizeof(double): return selectPointDecoder<TX, double>(z_bytes, must_reverse_bytes);
+    default:             return NULL;
+  }
+}
+
+PointDecoderKernel selectPointDecoder(const unsigned int x_bytes,
+                                      const unsigned int y_bytes,
+                                      const unsigned int z_bytes,
+                                      const unsigned int x_offset,
+                                      const unsigned int y_offset,
+                                      const unsigned int z_offset,
+                                      const bool must_reverse_bytes)
+{
+  if (!must_reverse_bytes && 
+      x_bytes == sizeof(float) && y_bytes == sizeof(float) && z_bytes == sizeof(float) && 
+      x_offset == 0 && y_offset == 4 && z_offset == 8)
+  {
+    return decodePackedFloats;
+  }
+  
+  switch (x_bytes)
+  {
+    case sizeof(float):  return selectPointDecoder<float>(y_bytes, z_bytes, must_reverse_bytes);
+    case sizeof(double): return selectPointDecoder<double>(y_bytes, z_bytes, must_reverse_bytes);
+    default:             return NULL;
+  }
+}
+
+
+/* SELECTION */
+BankKernels BankKernels::scalar()
+{
+  BankKernels kernels;
+  kernels.sanitizeEma = sanitizeEmaScalar;
+  kernels.ema = emaScalar;
+  kernels.segmentMask = segmentMaskScalar;
+  kernels.segmentStats = segmentStatsScalar;
+  kernels.minimum = minimumScalar;
+  kernels.name = "scalar";
+  return kernels;
+}
+
+
+BankKernels BankKernels::select()
+{
+  BankKernels kernels = scalar();
+  
+#if defined(BANK_KERNELS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    kernels.sanitizeEma = sanitizeEmaAVX2;
+    kernels.ema = emaAVX2;
+    kernels.segmentMask = segmentMaskAVX2;
+    kernels.segmentStats = segmentStatsAVX2;
+    kernels.minimum = minimumAVX2;
+    kernels.name = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse4.1"))
+  {
+    kernels.sanitizeEma = sanitizeEmaSSE41;
+    kernels.ema = emaSSE41;
+    kernels.segmentMask = segmentMaskSSE41;
+    kernels.segmentStats = segmentStatsSSE41;
+    kernels.minimum = minimumSSE41;
+    kernels.name = "sse4.1";
+  }
+#elif defined(BANK_KERNELS_NEON)
+  kernels.sanitizeEma = sanitizeEmaNEON;
+  kernels.ema = emaNEON;
+  kernels.segmentStats = segmentStatsNEON;
+# ifdef __aarch64__
+  kernels.segmentMask = segmentMaskNEON;
+  kernels.minimum = minimumNEON;
+# endif
+  kernels.name = "neon";
+#endif
+  
+  return kernels;
+}
+
+} // namespace find_moving_objects
@@ -0,0 +1,152 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <cstddef>
+
+/* Local includes */
+#include <find_moving_objects/bank_message_ring.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructor
+ */
+BankMessageRing::BankMessageRing()
+{
+  cells = NULL;
+  mask = 0;
+  head = 0;
+  tail = 0;
+}
+
+
+/*
+ * Destructor
+ */
+BankMessageRing::~BankMessageRing()
+{
+  delete [] cells;
+}
+
+
+/*
+ * Allocate a power of two cells, all free for the first lap
+ */
+long BankMessageRing::init(const unsigned int capacity)
+{
+  if (capacity == 0)
+  {
+    return -1;
+  }
+  
+  unsigned long nr_cells = 1;
+  while (nr_cells < capacity)
+  {
+    nr_cells *= 2;
+  }
+  
+  delete [] cells;
+  cells = new Cell[nr_cells];
+  mask = nr_cells - 1;
+  for (unsigned long i=0; i<nr_cells; ++i)
+  {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+    cells[i].message = NULL;
+  }
+  head.store(0, std::memory_order_relaxed);
+  tail.store(0, std::memory_order_release);
+  return 0;
+}
+
+
+/*
+ * The cell at the tail is free if its sequence number equals the tail, 
+ * otherwise it holds a message that has not been taken (or is being taken) and the ring is full
+ */
+bool BankMessageRing::push(void * message)
+{
+  const unsigned long position = tail.load(std::memory_order_relaxed);
+  Cell * cell = &cells[position & mask];
+  if (cell->sequence.load(std::memory_order_acquire) != position)
+  {
+    return false;
+  }
+  
+  cell->message = message;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  tail.store(position + 1, std::memory_order_relaxed);
+  return true;
+}
+
+
+/*
+ * The cell at the head holds a message if its sequence number is the head plus one; 
+ * the head is claimed before the message is read, and the cell is then freed for the next lap
+ */
+void * BankMessageRing::pop()
+{
+  unsigned long position = head.load(std::memory_order_relaxed);
+  while (true)
+  {
+    Cell * cell = &cells[position & mask];
+    const long difference = (long) (cell->sequence.load(std::memory_order_acquire) - (position + 1));
+    if (difference == 0)
+    {
+      if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        void * message = cell->message;
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return message;
+      }
+      // position was updated by the failed exchange
+    }
+    else if (difference < 0)
+    {
+      // Empty
+      return NULL;
+    }
+    else
+    {
+      // Another thread took the message at position
+      position = head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace find_moving_objects
@@ -0,0 +1,288 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <cstddef>
+#include <sched.h>
+
+/* Local includes */
+#include <find_moving_objects/bank_pipeline.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructor
+ */
+BankPipeline::BankPipeline()
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond_message, NULL);
+  pthread_cond_init(&cond_space, NULL);
+  backpressure = DROP_OLDEST;
+  task = NULL;
+  release = NULL;
+  argument = NULL;
+  is_started = false;
+  is_stopping = false;
+  detector_is_waiting = false;
+  pusher_is_waiting = false;
+  nr_dropped_messages = 0;
+}
+
+
+/*
+ * Destructor
+ */
+BankPipeline::~BankPipeline()
+{
+  stop();
+  
+  pthread_cond_destroy(&cond_space);
+  pthread_cond_destroy(&cond_message);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+/*
+ * Start the detection thread
+ */
+long BankPipeline::start(const unsigned int capacity, 
+                         const Backpressure backpressure, 
+                         const Task task, 
+                         const Release release, 
+                         void * argument)
+{
+  if (is_started || ring.init(capacity) != 0)
+  {
+    return -1;
+  }
+  
+  this->backpressure = backpressure;
+  this->task = task;
+  this->release = release;
+  this->argument = argument;
+  is_stopping = false;
+  if (pthread_create(&thread, NULL, threadBody, this))
+  {
+    return -1;
+  }
+  is_started = true;
+  return 0;
+}
+
+
+/*
+ * Stop and join the detection thread, then release the messages it did not take
+ */
+void BankPipeline::stop()
+{
+  if (!is_started)
+  {
+    return;
+  }
+  
+  pthread_mutex_lock(&mutex);
+  is_stopping = true;
+  pthread_cond_broadcast(&cond_message);
+  pthread_cond_broadcast(&cond_space);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, NULL);
+  is_started = false;
+  
+  void * message;
+  while ((message = ring.pop()) != NULL)
+  {
+    release(message);
+  }
+}
+
+
+/*
+ * Queue a message, making room for it according to the backpressure policy if the ring is full. 
+ * A thread that waits sets its flag and then checks the ring again, while the other thread changes the ring and then 
+ * checks the flag; with a full fence between the two steps on both sides, at least one of them sees the other.
+ */
+void BankPipeline::push(void * message)
+{
+  bool is_pushed = ring.push(message);
+  while (!is_pushed)
+  {
+    if (backpressure == BLOCK)
+    {
+      // Wait for the detection thread to take a message
+      pthread_mutex_lock(&mutex);
+      pusher_is_waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      is_pushed = ring.push(message);
+      if (!is_pushed && !is_stopping)
+      {
+        pthread_cond_wait(&cond_space, &mutex);
+      }
+      pusher_is_waiting.store(false, std::memory_order_relaxed);
+      const bool must_give_up = (!is_pushed && is_stopping);
+      pthread_mutex_unlock(&mutex);
+      
+      if (must_give_up)
+      {
+        release(message);
+        return;
+      }
+    }
+    else
+    {
+      // Drop the oldest message, unless the detection thread is just taking it
+      void * oldest = ring.pop();
+      if (oldest != NULL)
+      {
+        release(oldest);
+        nr_dropped_messages++;
+      }
+      else
+      {
+        sched_yield();
+      }
+      is_pushed = ring.push(message);
+    }
+  }
+  
+  // Wake the detection thread if it waits for a message
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (detector_is_waiting.load(std::memory_order_relaxed))
+  {
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&cond_message);
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+
+/*
+ * Take the oldest message, sleeping while there is none
+ */
+void * BankPipeline::waitForMessage()
+{
+  void * message = ring.pop();
+  if (message == NULL)
+  {
+    pthread_mutex_lock(&mutex);
+    detector_is_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!is_stopping && (message = ring.pop()) == NULL)
+    {
+      pthread_cond_wait(&cond_message, &mutex);
+    }
+    detector_is_waiting.store(false, std::memory_order_relaxed);
+    pthread_mutex_unlock(&mutex);
+  }
+  return message;
+}
+
+
+/*
+ * Wake push() if it waits for room
+ */
+void BankPipeline::notifyPusher()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (pusher_is_waiting.load(std::memory_order_relaxed))
+  {
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&cond_space);
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+
+/*
+ * Body of the detection thread - run the task for each message until stopped
+ */
+void * BankPipeline::threadBody(void * pipeline_ptr)
+{
+  BankPipeline * pipeline = static_cast<BankPipeline *>(pipeline_ptr);
+  
+  void * message;
+  while (!pipeline->is_stopping && (message = pipeline->waitForMessage()) != NULL)
+  {
+    pipeline->notifyPusher();
+    
+    // Add the older messages that are already queued without finding objects in them
+    if (pipeline->backpressure == COALESCE)
+    {
+      void * newer_message;
+      while ((newer_message = pipeline->ring.pop()) != NULL)
+      {
+        pipeline->notifyPusher();
+        pipeline->task(pipeline->argument, message, false);
+        pipeline->release(message);
+        message = newer_message;
+      }
+    }
+    
+    pipeline->task(pipeline->argument, message, true);
+    pipeline->release(message);
+  }
+  
+  return NULL;
+}
+
+
+/*
+ * Parse the name of a backpressure policy
+ */
+long BankPipeline::parseBackpressure(const std::string & name, Backpressure * backpressure)
+{
+  if (name == "drop_oldest")
+  {
+    *backpressure = DROP_OLDEST;
+  }
+  else if (name == "coalesce")
+  {
+    *backpressure = COALESCE;
+  }
+  else if (name == "block")
+  {
+    *backpressure = BLOCK;
+  }
+  else
+  {
+    return -1;
+  }
+  return 0;
+}
+
+} // namespace find_moving_objects
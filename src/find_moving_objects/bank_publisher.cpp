@@ -0,0 +1,209 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* Local includes */
+#include <find_moving_objects/bank_publisher.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructor
+ */
+BankPublisher::BankPublisher()
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond_job, NULL);
+  pthread_cond_init(&cond_space, NULL);
+  is_started = false;
+  is_stopping = false;
+  index_first = 0;
+  nr_jobs = 0;
+  capacity = 0;
+  must_block = false;
+  nr_dropped_messages = 0;
+}
+
+
+/*
+ * Destructor
+ */
+BankPublisher::~BankPublisher()
+{
+  stop();
+  
+  pthread_cond_destroy(&cond_space);
+  pthread_cond_destroy(&cond_job);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+/*
+ * Start the thread
+ */
+long BankPublisher::start(const unsigned int capacity, const bool must_block)
+{
+  if (is_started || capacity == 0)
+  {
+    return -1;
+  }
+  
+  jobs.resize(capacity);
+  index_first = 0;
+  nr_jobs = 0;
+  this->capacity = capacity;
+  this->must_block = must_block;
+  is_stopping = false;
+  if (pthread_create(&thread, NULL, threadBody, this))
+  {
+    jobs.clear();
+    return -1;
+  }
+  is_started = true;
+  return 0;
+}
+
+
+/*
+ * Stop and join the thread, then discard the jobs it did not take
+ */
+void BankPublisher::stop()
+{
+  if (!is_started)
+  {
+    return;
+  }
+  
+  pthread_mutex_lock(&mutex);
+  is_stopping = true;
+  pthread_cond_broadcast(&cond_job);
+  pthread_cond_broadcast(&cond_space);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, NULL);
+  is_started = false;
+  jobs.clear();
+  index_first = 0;
+  nr_jobs = 0;
+}
+
+
+/*
+ * Queue a job, making room for it if the queue is full
+ */
+void BankPublisher::push(const PublishFunction publish_function, 
+                         const ros::Publisher & publisher, 
+                         const boost::shared_ptr<const void> & msg)
+{
+  pthread_mutex_lock(&mutex);
+  while (must_block && capacity <= nr_jobs && !is_stopping)
+  {
+    pthread_cond_wait(&cond_space, &mutex);
+  }
+  if (is_stopping || jobs.empty())
+  {
+    // Not started or stopped, the message is not published
+    pthread_mutex_unlock(&mutex);
+    return;
+  }
+  const bool is_dropping = (capacity <= nr_jobs);
+  if (is_dropping)
+  {
+    // Drop the oldest job, its slot is reused below
+    index_first = (index_first + 1) % capacity;
+    nr_jobs--;
+    nr_dropped_messages++;
+  }
+  Job & job = jobs[(index_first + nr_jobs) % capacity];
+  job.publish_function = publish_function;
+  job.publisher = publisher;
+  job.msg = msg;
+  nr_jobs++;
+  pthread_cond_signal(&cond_job);
+  const unsigned long nr_dropped_messages_so_far = nr_dropped_messages;
+  pthread_mutex_unlock(&mutex);
+  
+  if (is_dropping)
+  {
+    ROS_WARN_THROTTLE(1.0, "The publisher thread cannot keep up, dropping the oldest messages, %lu so far", 
+                      nr_dropped_messages_so_far);
+  }
+}
+
+
+/*
+ * Body of the thread - publish the queued messages in order until stopped; 
+ * the mutex is released while a message is published
+ */
+void * BankPublisher::threadBody(void * publisher_ptr)
+{
+  BankPublisher * publisher = static_cast<BankPublisher *>(publisher_ptr);
+  
+  pthread_mutex_lock(&publisher->mutex);
+  while (true)
+  {
+    while (!publisher->is_stopping && publisher->nr_jobs == 0)
+    {
+      pthread_cond_wait(&publisher->cond_job, &publisher->mutex);
+    }
+    if (publisher->is_stopping)
+    {
+      break;
+    }
+    
+    // Take the oldest job, its slot may be reused as soon as the mutex is released
+    Job & first = publisher->jobs[publisher->index_first];
+    const PublishFunction publish_function = first.publish_function;
+    const ros::Publisher ros_publisher = first.publisher;
+    boost::shared_ptr<const void> msg;
+    msg.swap(first.msg);
+    publisher->index_first = (publisher->index_first + 1) % publisher->capacity;
+    publisher->nr_jobs--;
+    if (publisher->must_block)
+    {
+      pthread_cond_signal(&publisher->cond_space);
+    }
+    pthread_mutex_unlock(&publisher->mutex);
+    publish_function(ros_publisher, msg);
+    msg.reset(); // Release the message before the mutex is taken again
+    pthread_mutex_lock(&publisher->mutex);
+  }
+  pthread_mutex_unlock(&publisher->mutex);
+  
+  return NULL;
+}
+
+} // namespace find_moving_objects
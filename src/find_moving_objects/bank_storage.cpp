@@ -0,0 +1,115 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <cstdlib>
+#include <cstring>
+
+/* Local includes */
+#include <find_moving_objects/bank_storage.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructor
+ */
+BankStorage::BankStorage()
+{
+  ranges = NULL;
+  nr_rows = 0;
+  row_stride = 0;
+}
+
+
+/*
+ * Destructor
+ */
+BankStorage::~BankStorage()
+{
+  free(ranges);
+}
+
+
+/*
+ * Allocate one aligned block for all rows, with the row stride rounded up to the alignment
+ */
+long BankStorage::allocate(const unsigned int nr_rows, const unsigned int points_per_row)
+{
+  free(ranges);
+  ranges = NULL;
+  this->nr_rows = 0;
+  this->row_stride = 0;
+  
+  const unsigned int floats_per_alignment = ALIGNMENT / sizeof(float);
+  const unsigned int stride = (points_per_row + floats_per_alignment - 1) / floats_per_alignment * 
+                              floats_per_alignment;
+  const size_t bytes = (size_t) nr_rows * stride * sizeof(float);
+  
+  void * memory = NULL;
+  if (bytes == 0 || posix_memalign(&memory, ALIGNMENT, bytes) != 0)
+  {
+    return -1;
+  }
+  memset(memory, 0, bytes);
+  
+  ranges = (float *) memory;
+  this->nr_rows = nr_rows;
+  this->row_stride = stride;
+  return 0;
+}
+
+
+/*
+ * Exchange the memory blocks, nothing is copied
+ */
+void BankStorage::swap(BankStorage & other)
+{
+  float * const other_ranges = other.ranges;
+  const unsigned int other_nr_rows = other.nr_rows;
+  const unsigned int other_row_stride = other.row_stride;
+  
+  other.ranges = ranges;
+  other.nr_rows = nr_rows;
+  other.row_stride = row_stride;
+  
+  ranges = other_ranges;
+  nr_rows = other_nr_rows;
+  row_stride = other_row_stride;
+}
+
+} // namespace find_moving_objects
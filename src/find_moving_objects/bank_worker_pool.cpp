@@ -0,0 +1,177 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* Local includes */
+#include <find_moving_objects/bank_worker_pool.h>
+
+
+namespace find_moving_objects
+{
+
+/*
+ * Constructor
+ */
+BankWorkerPool::BankWorkerPool()
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond_work, NULL);
+  pthread_cond_init(&cond_done, NULL);
+  stop = false;
+  generation = 0;
+  task = NULL;
+  argument = NULL;
+  nr_indices = 0;
+  next_index = 0;
+  nr_indices_done = 0;
+}
+
+
+/*
+ * Destructor
+ */
+BankWorkerPool::~BankWorkerPool()
+{
+  pthread_mutex_lock(&mutex);
+  stop = true;
+  pthread_cond_broadcast(&cond_work);
+  pthread_mutex_unlock(&mutex);
+  
+  const unsigned int nr_threads = threads.size();
+  for (unsigned int i=0; i<nr_threads; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  
+  pthread_cond_destroy(&cond_done);
+  pthread_cond_destroy(&cond_work);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+/*
+ * Start nr_threads-1 threads, the thread calling run() is the last one
+ */
+long BankWorkerPool::start(const unsigned int nr_threads)
+{
+  threads.reserve(nr_threads);
+  while (threads.size() + 1 < nr_threads)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, threadBody, this))
+    {
+      return -1;
+    }
+    threads.push_back(thread);
+  }
+  return 0;
+}
+
+
+/*
+ * Hand out the indices of the current task to the calling thread until there are no more, 
+ * the mutex is released while the task is run
+ */
+void BankWorkerPool::runIndices()
+{
+  while (next_index < nr_indices)
+  {
+    const unsigned int index = next_index++;
+    pthread_mutex_unlock(&mutex);
+    task(argument, index);
+    pthread_mutex_lock(&mutex);
+    
+    if (++nr_indices_done == nr_indices)
+    {
+      pthread_cond_signal(&cond_done);
+    }
+  }
+}
+
+
+/*
+ * Body of the worker threads - wait for a new generation of work and take part in it
+ */
+void * BankWorkerPool::threadBody(void * pool_ptr)
+{
+  BankWorkerPool * pool = static_cast<BankWorkerPool *>(pool_ptr);
+  
+  pthread_mutex_lock(&pool->mutex);
+  unsigned long generation_done = pool->generation;
+  while (true)
+  {
+    while (!pool->stop && pool->generation == generation_done)
+    {
+      pthread_cond_wait(&pool->cond_work, &pool->mutex);
+    }
+    if (pool->stop)
+    {
+      break;
+    }
+    generation_done = pool->generation;
+    pool->runIndices();
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  
+  return NULL;
+}
+
+
+/*
+ * Publish the task to the threads, take part in it and wait until it is done for all indices
+ */
+void BankWorkerPool::run(const Task task, void * argument, const unsigned int nr_indices)
+{
+  pthread_mutex_lock(&mutex);
+  this->task = task;
+  this->argument = argument;
+  this->nr_indices = nr_indices;
+  next_index = 0;
+  nr_indices_done = 0;
+  generation++;
+  if (1 < nr_indices)
+  {
+    pthread_cond_broadcast(&cond_work);
+  }
+  
+  runIndices();
+  while (nr_indices_done < nr_indices)
+  {
+    pthread_cond_wait(&cond_done, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+} // namespace find_moving_objects
@@ -0,0 +1,172 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* C/C++ */
+#include <algorithm>
+#include <cmath>
+
+/* Local includes */
+#include <find_moving_objects/object_grid.h>
+
+
+namespace find_moving_objects
+{
+
+// Cells further from the origin than this are not indexed, so that neighbouring cells can be computed without 
+// overflow
+static const double max_cell_coordinate = 1.0e18;
+
+// Relative amount by which the cells are enlarged
+static const double cell_size_margin = 1.0e-6;
+
+
+
+/*
+ * Constructor
+ */
+ObjectGrid::ObjectGrid()
+{
+  inverted_cell_size = 0.0;
+}
+
+
+/*
+ * Init
+ */
+long ObjectGrid::init(const double cell_size)
+{
+  entries.clear();
+  unindexed.clear();
+  
+  if (!(0.0 < cell_size) || std::isinf(cell_size))
+  {
+    inverted_cell_size = 0.0;
+    return -1;
+  }
+  
+  // Slightly larger cells, so that rounding never hides an object within cell_size of a queried position
+  inverted_cell_size = 1.0 / (cell_size * (1.0 + cell_size_margin));
+  return 0;
+}
+
+
+/*
+ * Order of the entries: on cell, row by row, then on index
+ */
+bool ObjectGrid::isBefore(const Entry & a, const Entry & b)
+{
+  if (a.cell_x != b.cell_x) return a.cell_x < b.cell_x;
+  if (a.cell_y != b.cell_y) return a.cell_y < b.cell_y;
+  return a.index < b.index;
+}
+
+
+/*
+ * Cell of a position
+ */
+bool ObjectGrid::getCell(const double x, const double y, long long * cell_x, long long * cell_y) const
+{
+  const double grid_x = floor(x * inverted_cell_size);
+  const double grid_y = floor(y * inverted_cell_size);
+  
+  // Also false for NaN
+  if (!(fabs(grid_x) < max_cell_coordinate && fabs(grid_y) < max_cell_coordinate))
+  {
+    return false;
+  }
+  
+  *cell_x = (long long) grid_x;
+  *cell_y = (long long) grid_y;
+  return true;
+}
+
+
+/*
+ * Insert
+ */
+void ObjectGrid::insert(const double x, const double y, const unsigned int index)
+{
+  Entry entry;
+  if (getCell(x, y, &entry.cell_x, &entry.cell_y))
+  {
+    entry.index = index;
+    entries.push_back(entry);
+  }
+  else
+  {
+    unindexed.push_back(index);
+  }
+}
+
+
+/*
+ * Finalize
+ */
+void ObjectGrid::finalize()
+{
+  std::sort(entries.begin(), entries.end(), isBefore);
+}
+
+
+/*
+ * Query
+ */
+void ObjectGrid::query(const double x, const double y, std::vector<unsigned int> * indices) const
+{
+  // Objects without a cell could be anywhere
+  indices->insert(indices->end(), unindexed.begin(), unindexed.end());
+  
+  long long cell_x, cell_y;
+  if (entries.empty() || !getCell(x, y, &cell_x, &cell_y))
+  {
+    return;
+  }
+  
+  // The three cells of each of the three rows around the cell are adjacent in entries
+  Entry first;
+  first.cell_y = cell_y-1;
+  first.index = 0;
+  for (first.cell_x = cell_x-1; first.cell_x <= cell_x+1; ++first.cell_x)
+  {
+    std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), first, isBefore);
+    for (; it != entries.end() && it->cell_x == first.cell_x && it->cell_y <= cell_y+1; ++it)
+    {
+      indices->push_back(it->index);
+    }
+  }
+}
+
+} // namespace find_moving_objects
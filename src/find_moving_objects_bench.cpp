@@ -0,0 +1,636 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/* 
+ * Microbenchmarks for the bank, driven by synthetic LaserScan and PointCloud2 messages.
+ * 
+ * Each benchmark is run for all (sensible) combinations of the number of beams (points per scan), the number of 
+ * scans in the bank and the number of objects in the scans. 
+ * Besides the regular Google Benchmark output, the following counters are reported:
+ *   ns/scan     - the average time of one call
+ *   allocs/scan - the average number of heap allocations (operator new) of one call
+ *   message_allocs/scan - the average number of messages and message elements allocated by one report 
+ *                         (findAndReportMovingObjects only), zero once the bank has reached its steady state
+ *   p50_ns      - the median time of one call
+ *   p99_ns      - the 99th percentile of the time of one call
+ * 
+ * Note that the banks advertise their topics, so a roscore must be running. 
+ * Use e.g. --benchmark_filter=LaserScan to only run some of the benchmarks.
+ */
+
+/* ROS */
+#include <ros/ros.h>
+#include <tf2_ros/buffer.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/PointField.h>
+
+/* Google Benchmark */
+#include <benchmark/benchmark.h>
+
+/* C/C++ */
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+/* Local includes */
+#include <find_moving_objects/bank.h>
+
+using namespace find_moving_objects;
+
+
+/* ALLOCATION COUNTING */
+static std::atomic<unsigned long> g_nr_allocations(0);
+
+void * operator new(std::size_t size)
+{
+  g_nr_allocations++;
+  void * p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void * operator new[](std::size_t size)
+{
+  g_nr_allocations++;
+  void * p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void * p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+  free(p);
+}
+
+
+/* CONFIDENCE */
+// Every object that is moving fast enough is reported, so that the whole publishing path is measured
+double Bank::calculateConfidence(const MovingObject & mo,
+                                 const BankArgument & ba,
+                                 const double dt,
+                                 const double mo_old_width)
+{
+  return 1.0;
+}
+
+
+/* GLOBALS */
+tf2_ros::Buffer * g_tf_buffer;
+const std::string SENSOR_FRAME = "bench_sensor";
+
+// Synthetic scans
+const unsigned int NR_MESSAGES = 128;            // Number of different messages fed to the bank, cyclically
+const unsigned int OBJECT_WIDTH_IN_POINTS = 5;   // Equal to the default object_threshold_min_nr_points
+const unsigned int OBJECT_STRIDE_IN_POINTS = 7;  // The objects are separated by out-of-range beams
+const double OBJECT_RANGE = 3.0;                 // Range of objects in the first message
+const double OBJECT_RANGE_DELTA = 0.01;          // Radial movement of objects between two messages
+const double BACKGROUND_RANGE = 10.0;            // Beyond object_threshold_max_distance
+const double MESSAGE_PERIOD = 0.1;               // 10 Hz
+const double FIRST_STAMP = 1000.0;
+const double PC2_ANGLE_MIN = -1.2;               // The bank view angle for PointCloud2 messages
+const double PC2_ANGLE_MAX =  1.2;
+const double PC2_POINT_Z = 0.5;                  // Within [PC2_threshold_z_min,PC2_threshold_z_max]
+
+// Synthetic organized clouds, like those of a depth camera (D435 at 640x480)
+const unsigned int NR_ORGANIZED_MESSAGES = 8;    // Fewer messages since each message is large
+const unsigned int ORGANIZED_COLUMNS = 640;
+const unsigned int ORGANIZED_ROWS = 480;
+const double ORGANIZED_FOV_HALF = 43.5 / 180.0 * M_PI;  // Half the horizontal field of view
+const double ORGANIZED_ROW_SLOPE = 0.002;        // Vertical slope between two rows
+
+// Synthetic dense lidar sweeps, with the rings one after the other in a single row (about a million points)
+const unsigned int NR_SWEEP_MESSAGES = 4;        // Fewer messages since each message is large
+const unsigned int SWEEP_RINGS = 64;
+const unsigned int SWEEP_POINTS_PER_RING = 16384;
+const unsigned int SWEEP_BEAMS = 1024;           // Points per scan in the bank
+const double SWEEP_RING_SLOPE = 0.006;           // Vertical slope between two rings
+
+
+/* HELPERS */
+// Range of beam i in message m
+inline double syntheticRange(const unsigned int i,
+                             const unsigned int m,
+                             const unsigned int nr_objects)
+{
+  const unsigned int object = i / OBJECT_STRIDE_IN_POINTS;
+  if (object < nr_objects && i % OBJECT_STRIDE_IN_POINTS < OBJECT_WIDTH_IN_POINTS)
+  {
+    return OBJECT_RANGE + (m % NR_MESSAGES) * OBJECT_RANGE_DELTA;
+  }
+  return BACKGROUND_RANGE;
+}
+
+
+void createLaserScans(const unsigned int nr_beams,
+                      const unsigned int nr_objects,
+                      std::vector<sensor_msgs::LaserScan> * msgs)
+{
+  msgs->resize(NR_MESSAGES);
+  for (unsigned int m=0; m<NR_MESSAGES; ++m)
+  {
+    sensor_msgs::LaserScan & msg = (*msgs)[m];
+    msg.header.seq = m;
+    msg.header.stamp = ros::Time(FIRST_STAMP + m * MESSAGE_PERIOD);
+    msg.header.frame_id = SENSOR_FRAME;
+    msg.angle_increment = 2 * M_PI / nr_beams;
+    msg.angle_min = -M_PI;
+    msg.angle_max = M_PI - msg.angle_increment;
+    msg.time_increment = 0.0;
+    msg.scan_time = MESSAGE_PERIOD;
+    msg.range_min = 0.1;
+    msg.range_max = 20.0;
+    msg.ranges.resize(nr_beams);
+    for (unsigned int i=0; i<nr_beams; ++i)
+    {
+      msg.ranges[i] = syntheticRange(i, m, nr_objects);
+    }
+  }
+}
+
+
+void createPointClouds(const unsigned int nr_beams,
+                       const unsigned int nr_objects,
+                       std::vector<sensor_msgs::PointCloud2> * msgs)
+{
+  // One point (x,y,z as float32 and padding, like PCL) per beam
+  const unsigned int point_step = 16;
+  const double angle_increment = (PC2_ANGLE_MAX - PC2_ANGLE_MIN) / nr_beams;
+  const char * names[3] = {"x", "y", "z"};
+  
+  msgs->resize(NR_MESSAGES);
+  for (unsigned int m=0; m<NR_MESSAGES; ++m)
+  {
+    sensor_msgs::PointCloud2 & msg = (*msgs)[m];
+    msg.header.seq = m;
+    msg.header.stamp = ros::Time(FIRST_STAMP + m * MESSAGE_PERIOD);
+    msg.header.frame_id = SENSOR_FRAME;
+    msg.height = 1;
+    msg.width = nr_beams;
+    msg.fields.resize(3);
+    for (unsigned int f=0; f<3; ++f)
+    {
+      msg.fields[f].name = names[f];
+      msg.fields[f].offset = 4 * f;
+      msg.fields[f].datatype = sensor_msgs::PointField::FLOAT32;
+      msg.fields[f].count = 1;
+    }
+    msg.is_bigendian = false;
+    msg.point_step = point_step;
+    msg.row_step = point_step * nr_beams;
+    msg.is_dense = true;
+    msg.data.resize(msg.row_step);
+    for (unsigned int i=0; i<nr_beams; ++i)
+    {
+      const double angle = PC2_ANGLE_MIN + (i + 0.5) * angle_increment;
+      const double range = syntheticRange(i, m, nr_objects);
+      const float xyz[3] = {(float) (range * cos(angle)), (float) (range * sin(angle)), (float) PC2_POINT_Z};
+      memcpy(&msg.data[i * point_step], xyz, sizeof(xyz));
+    }
+  }
+}
+
+
+// One point per pixel; each column is a beam seen by all rows, the middle row being at height PC2_POINT_Z
+void createOrganizedPointClouds(const unsigned int nr_objects,
+                                std::vector<sensor_msgs::PointCloud2> * msgs)
+{
+  const unsigned int point_step = 16;
+  const double focal_length = (ORGANIZED_COLUMNS / 2) / tan(ORGANIZED_FOV_HALF);
+  const char * names[3] = {"x", "y", "z"};
+  
+  msgs->resize(NR_ORGANIZED_MESSAGES);
+  for (unsigned int m=0; m<NR_ORGANIZED_MESSAGES; ++m)
+  {
+    sensor_msgs::PointCloud2 & msg = (*msgs)[m];
+    msg.header.seq = m;
+    msg.header.stamp = ros::Time(FIRST_STAMP + m * MESSAGE_PERIOD);
+    msg.header.frame_id = SENSOR_FRAME;
+    msg.height = ORGANIZED_ROWS;
+    msg.width = ORGANIZED_COLUMNS;
+    msg.fields.resize(3);
+    for (unsigned int f=0; f<3; ++f)
+    {
+      msg.fields[f].name = names[f];
+      msg.fields[f].offset = 4 * f;
+      msg.fields[f].datatype = sensor_msgs::PointField::FLOAT32;
+      msg.fields[f].count = 1;
+    }
+    msg.is_bigendian = false;
+    msg.point_step = point_step;
+    msg.row_step = point_step * ORGANIZED_COLUMNS;
+    msg.is_dense = true;
+    msg.data.resize(msg.row_step * ORGANIZED_ROWS);
+    for (unsigned int r=0; r<ORGANIZED_ROWS; ++r)
+    {
+      for (unsigned int c=0; c<ORGANIZED_COLUMNS; ++c)
+      {
+        const double slope = (ORGANIZED_COLUMNS / 2 - (c + 0.5)) / focal_length;
+        const double depth = syntheticRange(c, m, nr_objects) / sqrt(1 + slope * slope);
+        const float xyz[3] = {(float) depth, 
+                              (float) (depth * slope), 
+                              (float) (PC2_POINT_Z + depth * ((int) ORGANIZED_ROWS / 2 - (int) r) * ORGANIZED_ROW_SLOPE)};
+        memcpy(&msg.data[r * msg.row_step + c * point_step], xyz, sizeof(xyz));
+      }
+    }
+  }
+}
+
+
+// One point per ring and azimuth, the rings in the middle being at height PC2_POINT_Z
+void createLidarSweeps(const unsigned int nr_objects,
+                       std::vector<sensor_msgs::PointCloud2> * msgs)
+{
+  const unsigned int point_step = 16;
+  const unsigned int nr_points = SWEEP_RINGS * SWEEP_POINTS_PER_RING;
+  const double angle_increment = (PC2_ANGLE_MAX - PC2_ANGLE_MIN) / SWEEP_POINTS_PER_RING;
+  const char * names[3] = {"x", "y", "z"};
+  
+  msgs->resize(NR_SWEEP_MESSAGES);
+  for (unsigned int m=0; m<NR_SWEEP_MESSAGES; ++m)
+  {
+    sensor_msgs::PointCloud2 & msg = (*msgs)[m];
+    msg.header.seq = m;
+    msg.header.stamp = ros::Time(FIRST_STAMP + m * MESSAGE_PERIOD);
+    msg.header.frame_id = SENSOR_FRAME;
+    msg.height = 1;
+    msg.width = nr_points;
+    msg.fields.resize(3);
+    for (unsigned int f=0; f<3; ++f)
+    {
+      msg.fields[f].name = names[f];
+      msg.fields[f].offset = 4 * f;
+      msg.fields[f].datatype = sensor_msgs::PointField::FLOAT32;
+      msg.fields[f].count = 1;
+    }
+    msg.is_bigendian = false;
+    msg.point_step = point_step;
+    msg.row_step = point_step * nr_points;
+    msg.is_dense = true;
+    msg.data.resize(msg.row_step);
+    for (unsigned int r=0; r<SWEEP_RINGS; ++r)
+    {
+      for (unsigned int c=0; c<SWEEP_POINTS_PER_RING; ++c)
+      {
+        const double angle = PC2_ANGLE_MIN + (c + 0.5) * angle_increment;
+        const double range = syntheticRange(c * SWEEP_BEAMS / SWEEP_POINTS_PER_RING, m, nr_objects);
+        const float xyz[3] = {(float) (range * cos(angle)), 
+                              (float) (range * sin(angle)), 
+                              (float) (PC2_POINT_Z + range * ((int) SWEEP_RINGS / 2 - (int) r) * SWEEP_RING_SLOPE)};
+        memcpy(&msg.data[(r * SWEEP_POINTS_PER_RING + c) * point_step], xyz, sizeof(xyz));
+      }
+    }
+  }
+}
+
+
+BankArgument createBankArgument(const unsigned int nr_beams, 
+                                const unsigned int nr_scans_in_bank)
+{
+  BankArgument bank_argument;
+  bank_argument.nr_scans_in_bank = nr_scans_in_bank;
+  bank_argument.points_per_scan = nr_beams;
+  bank_argument.topic_objects = "bench/moving_objects_arrays";
+  bank_argument.topic_ema = "bench/ema";
+  return bank_argument;
+}
+
+
+// Collects the duration of each call and reports the counters described at the top of this file
+class LatencyRecorder
+{
+private:
+  std::vector<double> samples_ns;
+  unsigned long nr_allocations_start;
+  std::chrono::steady_clock::time_point start;
+  
+public:
+  LatencyRecorder(benchmark::State & state)
+  {
+    // Avoid counting our own allocations
+    samples_ns.reserve(state.max_iterations);
+    nr_allocations_start = g_nr_allocations;
+  }
+  
+  inline void startCall()
+  {
+    start = std::chrono::steady_clock::now();
+  }
+  
+  inline void stopCall()
+  {
+    const std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    samples_ns.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  
+  void report(benchmark::State & state)
+  {
+    const unsigned long nr_allocations = g_nr_allocations - nr_allocations_start;
+    const unsigned int nr_samples = samples_ns.size();
+    if (nr_samples == 0)
+    {
+      return;
+    }
+    
+    double sum_ns = 0.0;
+    for (unsigned int i=0; i<nr_samples; ++i)
+    {
+      sum_ns += samples_ns[i];
+    }
+    
+    const unsigned int index_p50 = nr_samples / 2;
+    const unsigned int index_p99 = std::min(nr_samples - 1, (unsigned int) ceil(0.99 * nr_samples) - 1);
+    std::nth_element(samples_ns.begin(), samples_ns.begin() + index_p50, samples_ns.end());
+    const double p50_ns = samples_ns[index_p50];
+    std::nth_element(samples_ns.begin(), samples_ns.begin() + index_p99, samples_ns.end());
+    const double p99_ns = samples_ns[index_p99];
+    
+    state.counters["ns/scan"] = sum_ns / nr_samples;
+    state.counters["allocs/scan"] = (double) nr_allocations / nr_samples;
+    state.counters["p50_ns"] = p50_ns;
+    state.counters["p99_ns"] = p99_ns;
+    state.SetItemsProcessed(nr_samples);
+  }
+};
+
+
+/* BENCHMARKS */
+static void BM_Bank_addMessage_LaserScan(benchmark::State & state)
+{
+  const unsigned int nr_beams = state.range(0);
+  const unsigned int nr_scans_in_bank = state.range(1);
+  const unsigned int nr_objects = state.range(2);
+  
+  std::vector<sensor_msgs::LaserScan> msgs;
+  createLaserScans(nr_beams, nr_objects, &msgs);
+  
+  Bank bank(g_tf_buffer);
+  bank.init(createBankArgument(nr_beams, nr_scans_in_bank), &msgs[0]);
+  
+  unsigned int m = 1;
+  LatencyRecorder recorder(state);
+  for (auto _ : state)
+  {
+    recorder.startCall();
+    bank.addMessage(&msgs[m]);
+    recorder.stopCall();
+    m = (m + 1) % NR_MESSAGES;
+  }
+  recorder.report(state);
+}
+
+
+static void BM_Bank_addMessage_PointCloud2(benchmark::State & state)
+{
+  const unsigned int nr_beams = state.range(0);
+  const unsigned int nr_scans_in_bank = state.range(1);
+  const unsigned int nr_objects = state.range(2);
+  
+  std::vector<sensor_msgs::PointCloud2> msgs;
+  createPointClouds(nr_beams, nr_objects, &msgs);
+  
+  BankArgument bank_argument = createBankArgument(nr_beams, nr_scans_in_bank);
+  bank_argument.angle_min = PC2_ANGLE_MIN;
+  bank_argument.angle_max = PC2_ANGLE_MAX;
+  Bank bank(g_tf_buffer);
+  if (bank.init(bank_argument, &msgs[0]) != 0)
+  {
+    state.SkipWithError("Could not initialize the bank with a PointCloud2 message");
+    return;
+  }
+  
+  unsigned int m = 1;
+  LatencyRecorder recorder(state);
+  for (auto _ : state)
+  {
+    recorder.startCall();
+    bank.addMessage(&msgs[m]);
+    recorder.stopCall();
+    m = (m + 1) % NR_MESSAGES;
+  }
+  recorder.report(state);
+}
+
+
+// Organized clouds with 640 points per scan, binned by point or by column
+static void BM_Bank_addMessage_PointCloud2Organized(benchmark::State & state)
+{
+  const bool bin_by_column = state.range(0);
+  const unsigned int nr_scans_in_bank = 11;
+  const unsigned int nr_objects = 50;
+  
+  std::vector<sensor_msgs::PointCloud2> msgs;
+  createOrganizedPointClouds(nr_objects, &msgs);
+  
+  BankArgument bank_argument = createBankArgument(ORGANIZED_COLUMNS, nr_scans_in_bank);
+  bank_argument.angle_min = -ORGANIZED_FOV_HALF;
+  bank_argument.angle_max =  ORGANIZED_FOV_HALF;
+  bank_argument.PC2_bin_organized_cloud_by_column = bin_by_column;
+  Bank bank(g_tf_buffer);
+  if (bank.init(bank_argument, &msgs[0]) != 0)
+  {
+    state.SkipWithError("Could not initialize the bank with a PointCloud2 message");
+    return;
+  }
+  
+  unsigned int m = 1;
+  LatencyRecorder recorder(state);
+  for (auto _ : state)
+  {
+    recorder.startCall();
+    bank.addMessage(&msgs[m]);
+    recorder.stopCall();
+    m = (m + 1) % NR_ORGANIZED_MESSAGES;
+  }
+  recorder.report(state);
+}
+
+
+// Dense lidar sweeps with 1024 points per scan, binned by 1 to 8 threads
+static void BM_Bank_addMessage_PointCloud2Sweep(benchmark::State & state)
+{
+  const int nr_binning_threads = state.range(0);
+  const unsigned int nr_scans_in_bank = 11;
+  const unsigned int nr_objects = 50;
+  
+  std::vector<sensor_msgs::PointCloud2> msgs;
+  createLidarSweeps(nr_objects, &msgs);
+  
+  BankArgument bank_argument = createBankArgument(SWEEP_BEAMS, nr_scans_in_bank);
+  bank_argument.angle_min = PC2_ANGLE_MIN;
+  bank_argument.angle_max = PC2_ANGLE_MAX;
+  bank_argument.PC2_nr_binning_threads = nr_binning_threads;
+  Bank bank(g_tf_buffer);
+  if (bank.init(bank_argument, &msgs[0]) != 0)
+  {
+    state.SkipWithError("Could not initialize the bank with a PointCloud2 message");
+    return;
+  }
+  
+  unsigned int m = 1;
+  LatencyRecorder recorder(state);
+  for (auto _ : state)
+  {
+    recorder.startCall();
+    bank.addMessage(&msgs[m]);
+    recorder.stopCall();
+    m = (m + 1) % NR_SWEEP_MESSAGES;
+  }
+  recorder.report(state);
+}
+
+
+static void BM_Bank_findAndReportMovingObjects(benchmark::State & state)
+{
+  const unsigned int nr_beams = state.range(0);
+  const unsigned int nr_scans_in_bank = state.range(1);
+  const unsigned int nr_objects = state.range(2);
+  
+  std::vector<sensor_msgs::LaserScan> msgs;
+  createLaserScans(nr_beams, nr_objects, &msgs);
+  
+  // Fill the bank; finding objects does not alter it, so every call performs the same work
+  Bank bank(g_tf_buffer);
+  bank.init(createBankArgument(nr_beams, nr_scans_in_bank), &msgs[0]);
+  for (unsigned int m=1; m<nr_scans_in_bank; ++m)
+  {
+    bank.addMessage(&msgs[m]);
+  }
+  
+  LatencyRecorder recorder(state);
+  const unsigned long nr_message_allocations_start = bank.getNrMessageAllocations();
+  for (auto _ : state)
+  {
+    recorder.startCall();
+    bank.findAndReportMovingObjects();
+    recorder.stopCall();
+  }
+  recorder.report(state);
+  if (0 < state.iterations())
+  {
+    state.counters["message_allocs/scan"] = 
+      (double) (bank.getNrMessageAllocations() - nr_message_allocations_start) / state.iterations();
+  }
+}
+
+
+// 360 to 8192 beams, 2 to 64 scans in the bank and 0 to 500 objects (as long as they fit in the scan)
+static void bankArguments(benchmark::internal::Benchmark * b)
+{
+  const int nr_beams[] = {360, 1024, 8192};
+  const int nr_scans_in_bank[] = {2, 11, 64};
+  const int nr_objects[] = {0, 50, 500};
+  
+  b->ArgNames({"beams", "scans_in_bank", "objects"});
+  for (unsigned int i=0; i<sizeof(nr_beams)/sizeof(int); ++i)
+  {
+    for (unsigned int j=0; j<sizeof(nr_scans_in_bank)/sizeof(int); ++j)
+    {
+      for (unsigned int k=0; k<sizeof(nr_objects)/sizeof(int); ++k)
+      {
+        if (nr_objects[k] * (int) OBJECT_STRIDE_IN_POINTS <= nr_beams[i])
+        {
+          b->Args({nr_beams[i], nr_scans_in_bank[j], nr_objects[k]});
+        }
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_Bank_addMessage_LaserScan)->Apply(bankArguments);
+BENCHMARK(BM_Bank_addMessage_PointCloud2)->Apply(bankArguments);
+BENCHMARK(BM_Bank_addMessage_PointCloud2Organized)->ArgName("by_column")->Arg(0)->Arg(1);
+BENCHMARK(BM_Bank_addMessage_PointCloud2Sweep)->ArgName("threads")->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+BENCHMARK(BM_Bank_findAndReportMovingObjects)->Apply(bankArguments);
+
+
+/* ENTRY POINT */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "find_moving_objects_bench", ros::init_options::AnonymousName);
+  ros::NodeHandle node;
+  
+  // Static identity transforms between the frames used by the banks, so that no TF data must be broadcast
+  tf2_ros::Buffer tf_buffer;
+  {
+    BankArgument bank_argument;
+    const std::string parent_frames[3] = {bank_argument.map_frame, bank_argument.fixed_frame, bank_argument.base_frame};
+    const std::string child_frames[3] = {bank_argument.fixed_frame, bank_argument.base_frame, SENSOR_FRAME};
+    for (unsigned int i=0; i<3; ++i)
+    {
+      geometry_msgs::TransformStamped transform;
+      transform.header.frame_id = parent_frames[i];
+      transform.header.stamp = ros::Time(0);
+      transform.child_frame_id = child_frames[i];
+      transform.transform.translation.x = 0.0;
+      transform.transform.translation.y = 0.0;
+      transform.transform.translation.z = 0.0;
+      transform.transform.rotation.x = 0.0;
+      transform.transform.rotation.y = 0.0;
+      transform.transform.rotation.z = 0.0;
+      transform.transform.rotation.w = 1.0;
+      tf_buffer.setTransform(transform, "find_moving_objects_bench", true);
+    }
+  }
+  g_tf_buffer = &tf_buffer;
+  
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  
+  return 0;
+}
@@ -40,6 +40,7 @@
 #include <tf2_ros/transform_listener.h>
 #include <tf2_ros/message_filter.h>
 #include <message_filters/subscriber.h>
+#include <boost/function.hpp>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <sensor_msgs/LaserScan.h>
 
@@ -50,7 +51,9 @@
 /* C/C++ */
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <pthread.h>
+#include <unistd.h>
 
 // #ifdef LSARRAY
 // #include <omp.h>
@@ -98,6 +101,54 @@ double Bank::calculateConfidence(const MovingObject & mo,
 
 
 
+#ifdef LSARRAY
+/* PARALLEL BANK PROCESSING */
+// The banks and the message whose msgs are added to them
+typedef struct
+{
+  Bank * const * banks;
+  const find_moving_objects::LaserScanArray * msg;
+  bool find_objects;
+} BankTask;
+
+// Task run by the worker pool for bank i; 
+// the banks do not share any state except the TF buffer, which is thread safe, and read-only confidence parameters
+static void addMessageAndFindObjects(void * bank_task_ptr, const unsigned int i)
+{
+  const BankTask * bank_task = static_cast<const BankTask *>(bank_task_ptr);
+  
+  // Can message be added to bank?
+  if (bank_task->banks[i]->addMessage(&(bank_task->msg->msgs[i])) != 0)
+  {
+    // Adding message failed (should never happen for LaserScan)
+    return;
+  }
+  
+  // If so, then find and report objects
+  if (bank_task->find_objects)
+  {
+    bank_task->banks[i]->findAndReportMovingObjects();
+  }
+}
+#endif
+
+
+
+/* DETECTION THREAD */
+// The messages in the pipeline are heap-allocated shared pointers, keeping the messages alive until they are processed
+#ifdef LSARRAY
+typedef find_moving_objects::LaserScanArray PipelineMessage;
+#else
+typedef sensor_msgs::LaserScan PipelineMessage;
+#endif
+
+static void releaseMessage(void * message)
+{
+  delete static_cast<PipelineMessage::ConstPtr *>(message);
+}
+
+
+
 /* CONSTRUCTOR */
 #ifdef NODELET
 # ifdef LSARRAY
@@ -121,6 +172,8 @@ LaserScanInterpreterNode::LaserScanInterpreterNode()
   ros::Time::waitForValid();
 #endif
   
+  nr_dropped_messages_seen = 0;
+  tf_subscriber = NULL;
   tf_filter = NULL;
   tf_listener = NULL;
   tf_buffer = NULL;
@@ -149,6 +202,15 @@ LaserScanInterpreterNode::~LaserScanInterpreterNode()
 # endif
 #endif
 {
+  // Stop receiving msgs first, the callback uses the banks
+  if (tf_subscriber != NULL) tf_subscriber->unsubscribe();
+  if (tf_filter != NULL)     delete tf_filter;
+  if (tf_subscriber != NULL) delete tf_subscriber;
+  
+  // The detection and publishing threads use the banks
+  bank_pipeline.stop();
+  bank_publisher.stop();
+  
   int nr_banks = banks.size();
   for (int i=0; i<nr_banks; ++i)
   {
@@ -156,7 +218,7 @@ LaserScanInterpreterNode::~LaserScanInterpreterNode()
   }
   banks.clear();
 
-  if (tf_filter != NULL)   delete tf_filter;
+  if (tf_listener != NULL) delete tf_listener;
   if (tf_buffer != NULL)   delete tf_buffer;
 }
 
@@ -186,33 +248,30 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
      */
     case FIND_MOVING_OBJECTS:
     {
-#ifdef LSARRAY
-      // Consider the msgs of msg in parallel
-//       #pragma omp parallel for
-      for (int i=0; i<msg->msgs.size(); ++i)
+      // Hand the message over to the detection thread, if any
+      if (bank_pipeline.isStarted())
       {
-        // Can message be added to bank?
-        if (banks[i]->addMessage(&(msg->msgs[i])) != 0)
+        bank_pipeline.push(new PipelineMessage::ConstPtr(msg));
+        
+        // Has the detection thread fallen behind so that msgs have been dropped?
+        const unsigned long nr_dropped_messages = bank_pipeline.getNrDroppedMessages();
+        if (nr_dropped_messages_seen != nr_dropped_messages)
         {
-          // Adding message failed (should never happen for LaserScan), try the next one
-          continue;
+          nr_dropped_messages_seen = nr_dropped_messages;
+#ifdef NODELET
+          NODELET_WARN_THROTTLE(1.0, "The detection thread cannot keep up, %lu msgs have been dropped so far", 
+                                nr_dropped_messages);
+#endif
+#ifdef NODE
+          ROS_WARN_THROTTLE(1.0, "The detection thread cannot keep up, %lu msgs have been dropped so far", 
+                            nr_dropped_messages);
+#endif
         }
-
-        // If so, then find and report objects
-        banks[i]->findAndReportMovingObjects();
       }
-#else
-      // Can message be added to bank?
-      if (banks[0]->addMessage(&(*msg)) != 0) // De-reference ConstPtr object and take reference of result to get a 
-                                              // pointer to a PointCloud2 object
+      else
       {
-        // Adding message failed (should never happen for LaserScan)
-        break;
+        processMessage(msg.get(), true);
       }
-
-      // If so, then find and report objects
-      banks[0]->findAndReportMovingObjects();
-#endif
       break;
     }
       
@@ -240,6 +299,7 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
         // maintained valid, assuming that the new message contains the same number of messages in the array
         bank_arguments.resize(nr_msgs);
         banks.resize(nr_msgs);
+        startPublisher(nr_msgs);
         for (int i=0; i<nr_msgs; ++i)
         {
           // Create bank and start listening to tf data
@@ -247,6 +307,34 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
           
           // Copy first bank argument
           bank_arguments[i] = bank_arguments[0];
+          
+          // Let the publishing thread publish the messages of the bank
+          if (bank_publisher.isStarted())
+          {
+            banks[i]->setPublisher(&bank_publisher);
+          }
+        }
+        
+        // Start the threads that process the banks, one per bank unless limited by nr_threads or the number of CPUs
+        int nr_bank_threads = nr_msgs;
+        if (0 < nr_threads)
+        {
+          nr_bank_threads = std::min(nr_bank_threads, nr_threads);
+        }
+        else
+        {
+          nr_bank_threads = std::min(nr_bank_threads, std::max(1, (int) sysconf(_SC_NPROCESSORS_ONLN)));
+        }
+        if (bank_worker_pool.start(nr_bank_threads) != 0)
+        {
+#ifdef NODELET
+          NODELET_WARN("Could not start all threads, the banks are processed by %u threads", 
+                       bank_worker_pool.getNrThreads());
+#endif
+#ifdef NODE
+          ROS_WARN("Could not start all threads, the banks are processed by %u threads", 
+                   bank_worker_pool.getNrThreads());
+#endif
         }
         
         // Modify bank arguments
@@ -278,6 +366,13 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
       {
         banks.resize(1);
         banks[0] = new find_moving_objects::Bank(tf_buffer);
+        startPublisher(1);
+        
+        // Let the publishing thread publish the messages of the bank
+        if (bank_publisher.isStarted())
+        {
+          banks[0]->setPublisher(&bank_publisher);
+        }
       }
       
       // Init bank
@@ -310,14 +405,14 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
         // Calculate HZ
         const double hz = received_messages / elapsed_time;
         
-        // Set nr of messages in bank
-        const double nr_scans = optimize_nr_scans_in_bank * hz;
-        bank_arguments[0].nr_scans_in_bank = nr_scans - ((long) nr_scans) == 0.0 ? nr_scans + 1 : ceil(nr_scans);
-    
-        // Sanity check
-        if (bank_arguments[0].nr_scans_in_bank < 2)
+        // Set nr of messages in bank, at least 2
+        bank_arguments[0].nr_scans_in_bank = BankCore::getNrScansForTime(optimize_nr_scans_in_bank, hz);
+        
+        // The banks adapt it to the rate from now on, within the same bounds
+        if (0.0 < bank_arguments[0].adapt_nr_scans_in_bank_time &&
+            bank_arguments[0].max_nr_scans_in_bank < bank_arguments[0].nr_scans_in_bank)
         {
-          bank_arguments[0].nr_scans_in_bank = 2;
+          bank_arguments[0].nr_scans_in_bank = bank_arguments[0].max_nr_scans_in_bank;
         }
 
         // Update confidence roots and amplitude factor
@@ -370,6 +465,117 @@ void LaserScanInterpreterNode::laserScanCallback(const sensor_msgs::LaserScan::C
 
 
 
+/* PROCESS A MESSAGE, EITHER IN THE CALLBACK OR IN THE DETECTION THREAD */
+#ifdef LSARRAY
+# ifdef NODELET
+void LaserScanArrayInterpreterNodelet::processMessage(const find_moving_objects::LaserScanArray * msg, 
+                                                      const bool find_objects)
+# endif
+# ifdef NODE
+void LaserScanArrayInterpreterNode::processMessage(const find_moving_objects::LaserScanArray * msg, 
+                                                   const bool find_objects)
+# endif
+#else
+# ifdef NODELET
+void LaserScanInterpreterNodelet::processMessage(const sensor_msgs::LaserScan * msg, const bool find_objects)
+# endif
+# ifdef NODE
+void LaserScanInterpreterNode::processMessage(const sensor_msgs::LaserScan * msg, const bool find_objects)
+# endif
+#endif
+{
+#ifdef LSARRAY
+  // Consider the msgs of msg in parallel, each bank is only used by one thread
+  BankTask bank_task = {banks.data(), msg, find_objects};
+  bank_worker_pool.run(addMessageAndFindObjects, &bank_task, msg->msgs.size());
+#else
+  // Can message be added to bank?
+  if (banks[0]->addMessage(msg) != 0)
+  {
+    // Adding message failed (should never happen for LaserScan)
+    return;
+  }
+
+  // If so, then find and report objects
+  if (find_objects)
+  {
+    banks[0]->findAndReportMovingObjects();
+  }
+#endif
+}
+
+
+
+/* TASK OF THE DETECTION THREAD */
+#ifdef LSARRAY
+# ifdef NODELET
+void LaserScanArrayInterpreterNodelet::pipelineTask(void * interpreter, void * message, const bool is_newest)
+{
+  LaserScanArrayInterpreterNodelet * self = static_cast<LaserScanArrayInterpreterNodelet *>(interpreter);
+# endif
+# ifdef NODE
+void LaserScanArrayInterpreterNode::pipelineTask(void * interpreter, void * message, const bool is_newest)
+{
+  LaserScanArrayInterpreterNode * self = static_cast<LaserScanArrayInterpreterNode *>(interpreter);
+# endif
+#else
+# ifdef NODELET
+void LaserScanInterpreterNodelet::pipelineTask(void * interpreter, void * message, const bool is_newest)
+{
+  LaserScanInterpreterNodelet * self = static_cast<LaserScanInterpreterNodelet *>(interpreter);
+# endif
+# ifdef NODE
+void LaserScanInterpreterNode::pipelineTask(void * interpreter, void * message, const bool is_newest)
+{
+  LaserScanInterpreterNode * self = static_cast<LaserScanInterpreterNode *>(interpreter);
+# endif
+#endif
+  
+  // Older messages only update the banks when coalescing, objects are only reported for the newest one
+  self->processMessage(static_cast<PipelineMessage::ConstPtr *>(message)->get(), is_newest);
+}
+
+
+
+/* PUBLISHING THREAD, STARTED WHEN THE BANKS ARE CREATED */
+#ifdef NODELET
+# ifdef LSARRAY
+void LaserScanArrayInterpreterNodelet::startPublisher(const int nr_banks)
+# else
+void LaserScanInterpreterNodelet::startPublisher(const int nr_banks)
+# endif
+#endif
+#ifdef NODE
+# ifdef LSARRAY
+void LaserScanArrayInterpreterNode::startPublisher(const int nr_banks)
+# else
+void LaserScanInterpreterNode::startPublisher(const int nr_banks)
+# endif
+#endif
+{
+  // The publishing thread is only used together with the detection thread
+  const unsigned int nr_topics = Bank::getNrPublishedTopics(bank_arguments[0]);
+  if (!bank_pipeline.isStarted() || nr_topics == 0 || bank_publisher.isStarted())
+  {
+    return;
+  }
+  
+  // Room for the messages of all topics of all banks for each message that can be queued in the pipeline
+  const unsigned int capacity = 
+    nr_topics * nr_banks * std::max(1, bank_arguments[0].publish_buffer_size) * pipeline_buffer_size;
+  if (bank_publisher.start(capacity, bank_pipeline.getBackpressure() == BankPipeline::BLOCK) != 0)
+  {
+#ifdef NODELET
+    NODELET_WARN("Could not start the publishing thread, publishing messages in the detection thread");
+#endif
+#ifdef NODE
+    ROS_WARN("Could not start the publishing thread, publishing messages in the detection thread");
+#endif
+  }
+}
+
+
+
 /* ENTRY POINT FOR NODELET AND INIT FOR NODE */
 #ifdef NODELET
 # ifdef LSARRAY
@@ -398,6 +604,11 @@ void LaserScanInterpreterNode::onInit()
   BankArgument bank_argument;
   nh_priv.param("subscribe_topic", subscribe_topic, default_subscribe_topic);
   nh_priv.param("subscribe_buffer_size", subscribe_buffer_size, default_subscribe_buffer_size);
+#ifdef LSARRAY
+  nh_priv.param("nr_threads", nr_threads, default_nr_threads);
+#endif
+  nh_priv.param("pipeline_buffer_size", pipeline_buffer_size, default_pipeline_buffer_size);
+  nh_priv.param("pipeline_backpressure", pipeline_backpressure, default_pipeline_backpressure);
   nh_priv.param("ema_alpha", bank_argument.ema_alpha, default_ema_alpha);
   nh_priv.param("nr_scans_in_bank", bank_argument.nr_scans_in_bank, default_nr_scans_in_bank);
   nh_priv.param("object_threshold_edge_max_delta_range", bank_argument.object_threshold_edge_max_delta_range, default_object_threshold_edge_max_delta_range);
@@ -418,9 +629,16 @@ void LaserScanInterpreterNode::onInit()
   nh_priv.param("velocity_arrows_use_base_frame", bank_argument.velocity_arrows_use_base_frame, default_velocity_arrows_use_base_frame);
   nh_priv.param("velocity_arrows_use_fixed_frame", bank_argument.velocity_arrows_use_fixed_frame, default_velocity_arrows_use_fixed_frame);
   nh_priv.param("publish_objects", bank_argument.publish_objects, default_publish_objects);
+  nh_priv.param("publish_objects_compact", bank_argument.publish_objects_compact, default_publish_objects_compact);
+  nh_priv.param("objects_compact_use_sensor_frame", bank_argument.objects_compact_use_sensor_frame, default_objects_compact_use_sensor_frame);
+  nh_priv.param("objects_compact_use_base_frame", bank_argument.objects_compact_use_base_frame, default_objects_compact_use_base_frame);
+  nh_priv.param("objects_compact_use_fixed_frame", bank_argument.objects_compact_use_fixed_frame, default_objects_compact_use_fixed_frame);
   nh_priv.param("map_frame", bank_argument.map_frame, default_map_frame);
   nh_priv.param("fixed_frame", bank_argument.fixed_frame, default_fixed_frame);
   nh_priv.param("base_frame", bank_argument.base_frame, default_base_frame);
+  nh_priv.param("compute_in_map_frame", bank_argument.compute_in_map_frame, default_compute_in_map_frame);
+  nh_priv.param("compute_in_fixed_frame", bank_argument.compute_in_fixed_frame, default_compute_in_fixed_frame);
+  nh_priv.param("compute_in_base_frame", bank_argument.compute_in_base_frame, default_compute_in_base_frame);
   nh_priv.param("ns_velocity_arrows", bank_argument.velocity_arrow_ns, default_ns_velocity_arrows);
   nh_priv.param("ns_delta_position_lines", bank_argument.delta_position_line_ns, default_ns_delta_position_lines);
   nh_priv.param("ns_width_lines", bank_argument.width_line_ns, default_ns_width_lines);
@@ -430,19 +648,28 @@ void LaserScanInterpreterNode::onInit()
   nh_priv.param("topic_objects_delta_position_lines", bank_argument.topic_objects_delta_position_lines, default_topic_objects_delta_position_lines);
   nh_priv.param("topic_objects_width_lines", bank_argument.topic_objects_width_lines, default_topic_objects_width_lines);
   nh_priv.param("topic_objects", bank_argument.topic_objects, default_topic_objects);
+  nh_priv.param("topic_objects_compact", bank_argument.topic_objects_compact, default_topic_objects_compact);
   nh_priv.param("publish_buffer_size", bank_argument.publish_buffer_size, default_publish_buffer_size);
   
   // Add this as the first bank_argument
   bank_arguments.push_back(bank_argument);
   
   // Optimize bank size?
+  bool adapt_nr_scans_in_bank;
   nh_priv.param("optimize_nr_scans_in_bank", optimize_nr_scans_in_bank, default_optimize_nr_scans_in_bank);
+  nh_priv.param("adapt_nr_scans_in_bank", adapt_nr_scans_in_bank, default_adapt_nr_scans_in_bank);
+  nh_priv.param("max_nr_scans_in_bank", bank_arguments[0].max_nr_scans_in_bank, default_max_nr_scans_in_bank);
   nh_priv.param("max_confidence_for_dt_match", max_confidence_for_dt_match, default_max_confidence_for_dt_match);
   
-  // If optimize_nr_scans_in_bank != 0, then yes
+  // If optimize_nr_scans_in_bank != 0, then yes, 
+  // and if adapt_nr_scans_in_bank is set, then the banks keep covering that time if the rate of the topic changes
   if (optimize_nr_scans_in_bank != 0.0)
   {
     state = WAIT_FOR_FIRST_MESSAGE_HZ;
+    if (adapt_nr_scans_in_bank)
+    {
+      bank_arguments[0].adapt_nr_scans_in_bank_time = optimize_nr_scans_in_bank;
+    }
   }
   else
   {
@@ -452,34 +679,78 @@ void LaserScanInterpreterNode::onInit()
   // Delta width confidence factor
   nh_priv.param("delta_width_confidence_decrease_factor", width_factor, default_delta_width_confidence_decrease_factor);
   
-  // Set up target frames for message filter
-  tf_filter_target_frames.push_back(bank_argument.map_frame);
-  if (strcmp(bank_argument.map_frame.c_str(), bank_argument.fixed_frame.c_str()) != 0)
+  // Set up target frames for message filter, only the frames that the objects are computed in are waited for
+  if (bank_argument.compute_in_map_frame)
+  {
+    tf_filter_target_frames.push_back(bank_argument.map_frame);
+  }
+  if (bank_argument.compute_in_fixed_frame &&
+      std::find(tf_filter_target_frames.begin(), tf_filter_target_frames.end(), 
+                bank_argument.fixed_frame) == tf_filter_target_frames.end())
   {
     tf_filter_target_frames.push_back(bank_argument.fixed_frame);
   }
-  if (strcmp(bank_argument.map_frame.c_str(), bank_argument.base_frame.c_str()) != 0 &&
-      strcmp(bank_argument.fixed_frame.c_str(), bank_argument.base_frame.c_str()) != 0)
+  if (bank_argument.compute_in_base_frame &&
+      std::find(tf_filter_target_frames.begin(), tf_filter_target_frames.end(), 
+                bank_argument.base_frame) == tf_filter_target_frames.end())
   {
     tf_filter_target_frames.push_back(bank_argument.base_frame);
   }
   
-  // Create tf2 buffer, listener, subscriber and filter
+  // Start the detection thread?
+  if (0 < pipeline_buffer_size)
+  {
+    BankPipeline::Backpressure backpressure;
+    if (BankPipeline::parseBackpressure(pipeline_backpressure, &backpressure) != 0)
+    {
+#ifdef NODELET
+      NODELET_ERROR_STREAM("Unknown pipeline backpressure " << pipeline_backpressure << ", using drop_oldest");
+#endif
+#ifdef NODE
+      ROS_ERROR_STREAM("Unknown pipeline backpressure " << pipeline_backpressure << ", using drop_oldest");
+#endif
+      backpressure = BankPipeline::DROP_OLDEST;
+    }
+    
+    // The publishing thread is started once the number of banks is known
+    if (bank_pipeline.start(pipeline_buffer_size, backpressure, pipelineTask, releaseMessage, this) != 0)
+    {
+#ifdef NODELET
+      NODELET_WARN("Could not start the detection thread, processing messages in the callback");
+#endif
+#ifdef NODE
+      ROS_WARN("Could not start the detection thread, processing messages in the callback");
+#endif
+    }
+  }
+  
+  // Create tf2 buffer, listener, subscriber and, if any transform is needed, filter
   tf_buffer = new tf2_ros::Buffer;
   tf_listener = new tf2_ros::TransformListener(*tf_buffer);
 #ifdef LSARRAY
+  typedef find_moving_objects::LaserScanArray::ConstPtr MessageConstPtr;
   tf_subscriber = new message_filters::Subscriber<find_moving_objects::LaserScanArray>();
   tf_subscriber->subscribe(nh, subscribe_topic, subscribe_buffer_size);
-  tf_filter = new tf2_ros::MessageFilter<find_moving_objects::LaserScanArray>(*tf_subscriber, *tf_buffer, "", subscribe_buffer_size, 0);
+  if (!tf_filter_target_frames.empty())
+  {
+    tf_filter = new tf2_ros::MessageFilter<find_moving_objects::LaserScanArray>(*tf_subscriber, *tf_buffer, "", subscribe_buffer_size, 0);
+  }
 #else
+  typedef sensor_msgs::LaserScan::ConstPtr MessageConstPtr;
   tf_subscriber = new message_filters::Subscriber<sensor_msgs::LaserScan>();
   tf_subscriber->subscribe(nh, subscribe_topic, subscribe_buffer_size);
-  tf_filter = new tf2_ros::MessageFilter<sensor_msgs::LaserScan>(*tf_subscriber, *tf_buffer, "", subscribe_buffer_size, 0);
+  if (!tf_filter_target_frames.empty())
+  {
+    tf_filter = new tf2_ros::MessageFilter<sensor_msgs::LaserScan>(*tf_subscriber, *tf_buffer, "", subscribe_buffer_size, 0);
+  }
 #endif
-  tf_filter->setTargetFrames(tf_filter_target_frames);
+  if (tf_filter != NULL)
+  {
+    tf_filter->setTargetFrames(tf_filter_target_frames);
+  }
   
-  // Register callback in filter
-  tf_filter->registerCallback( boost::bind(
+  // Register callback in filter, or in the subscriber if only the sensor frame is used so that no transform is needed
+  const boost::function<void (const MessageConstPtr &)> callback = boost::bind(
 #ifdef NODELET
 # ifdef LSARRAY
           &LaserScanArrayInterpreterNodelet::laserScanArrayCallback,
@@ -494,7 +765,15 @@ void LaserScanInterpreterNode::onInit()
           &LaserScanInterpreterNode::laserScanCallback,
 # endif
 #endif
-          this, _1) );
+          this, _1);
+  if (tf_filter != NULL)
+  {
+    tf_filter->registerCallback(callback);
+  }
+  else
+  {
+    tf_subscriber->registerCallback(callback);
+  }
 }
 
 } // namespace find_moving_objects
@@ -0,0 +1,923 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2018, Andreas Gustavsson.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+* Author: Andreas Gustavsson
+*********************************************************************/
+
+/**
+ * This is a ROS node or nodelet that takes MovingObjectArray messages as input.
+ * When a new message is received, the node caches that message and 
+ * compares the objects it contains to the objects of the messages the 
+ * node has received from other senders. If an object has been detected
+ * by at least one other sender, then its confidence value is increased
+ * before the message is forwarded.
+ */
+
+
+/* ROS */
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <visualization_msgs/Marker.h>
+#include <visualization_msgs/MarkerArray.h>
+#include <boost/make_shared.hpp>
+
+#ifdef NODELET
+#include <pluginlib/class_list_macros.h>
+#endif
+
+/* C/C++ */
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+
+/* Local includes */
+#include <find_moving_objects/MovingObject.h>
+#include <find_moving_objects/MovingObjectArray.h>
+#include <find_moving_objects/MovingObjectsConfidenceEnhancer.h>
+
+
+#ifdef NODELET
+/* TELL ROS ABOUT THIS NODELET PLUGIN */
+PLUGINLIB_EXPORT_CLASS(find_moving_objects::MovingObjectsConfidenceEnhancerNodelet, nodelet::Nodelet)
+#endif
+
+
+namespace find_moving_objects
+{
+
+#define MIN(X,Y) (X<Y?X:Y)
+#define MAX(X,Y) (X>Y?X:Y)
+
+#define WL(W) std::setw(W) << std::left
+#define WR(W) std::setw(W) << std::right
+const double TWO_PI = 2 * M_PI;
+
+/* CLOSEST POINT MARKERS, A SCAN ALL AROUND THE SENSOR */
+const unsigned int points = 720;
+const double range_min = 0.0;
+const double range_max = 100.0;
+const double resolution = TWO_PI / points;
+const double inverted_resolution = points / TWO_PI;
+const double out_of_range = range_max + 10.0;
+
+
+
+/* CONSTRUCTOR */
+#ifdef NODELET
+MovingObjectsConfidenceEnhancerNodelet::MovingObjectsConfidenceEnhancerNodelet()
+#endif
+#ifdef NODE
+MovingObjectsConfidenceEnhancerNode::MovingObjectsConfidenceEnhancerNode()
+#endif
+: available_moa(false),
+  stop_moa_handler(false),
+  nr_dropped_messages(0),
+  closest_point_markers_seq(0),
+  velocity_arrows_seq(0),
+  moa_handler_is_started(false)
+{
+  sender_slots = boost::shared_ptr<const SenderSlots>(new SenderSlots());
+  pthread_mutex_init(&mutex_moa, NULL);
+  pthread_cond_init(&cond_moa, NULL);
+  
+  // Wait for time to become valid
+  ros::Time::waitForValid();
+  
+#ifdef NODE
+  onInit();
+#endif
+}
+
+
+
+/* DESTRUCTOR */
+#ifdef NODELET
+MovingObjectsConfidenceEnhancerNodelet::~MovingObjectsConfidenceEnhancerNodelet()
+#endif
+#ifdef NODE
+MovingObjectsConfidenceEnhancerNode::~MovingObjectsConfidenceEnhancerNode()
+#endif
+{
+  // No more messages
+  sub.shutdown();
+  
+  // Stop the worker thread
+  if (moa_handler_is_started)
+  {
+    pthread_mutex_lock(&mutex_moa);
+    stop_moa_handler = true;
+    pthread_cond_signal(&cond_moa);
+    pthread_mutex_unlock(&mutex_moa);
+    pthread_join(moa_handler, NULL);
+  }
+  
+  // Release the messages that were never evaluated
+  void * queued_message;
+  while ((queued_message = queue.pop()) != NULL)
+  {
+    delete static_cast<boost::shared_ptr<const SenderMessage> *>(queued_message);
+  }
+  
+  pthread_cond_destroy(&cond_moa);
+  pthread_mutex_destroy(&mutex_moa);
+}
+
+
+
+/* CALLBACK - USE EXTRA WORKER THREAD TO DO THE ACTUAL WORK */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::moaCallback(const find_moving_objects::MovingObjectArray::ConstPtr & msg)
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::moaCallback(const find_moving_objects::MovingObjectArray::ConstPtr & msg)
+#endif
+{
+  // Index the objects of the msg on their positions in the map frame, so that the worker thread only compares 
+  // objects of other senders to the ones close to them; a grid cell is as large as the largest matching distance
+  boost::shared_ptr<ObjectGrid> grid;
+  const unsigned int nr_objects = msg->objects.size();
+  if (0 < nr_objects)
+  {
+    grid = boost::make_shared<ObjectGrid>();
+    if (grid->init(threshold_max_delta_position) == 0)
+    {
+      for (unsigned int j=0; j<nr_objects; ++j)
+      {
+        grid->insert(msg->objects[j].position_in_map_frame.x, msg->objects[j].position_in_map_frame.y, j);
+      }
+      grid->finalize();
+    }
+    else
+    {
+      // Compare with all objects
+      grid.reset();
+    }
+  }
+  
+  // The names of sending nodes are saved so that we can keep messages apart, they are only used in this function
+  std::unordered_map<std::string, unsigned int>::const_iterator sender = sender_indices.find(msg->origin_node_name);
+  const bool is_new_sender = (sender == sender_indices.end());
+  const unsigned int sender_index = is_new_sender ? sender_slots->size() : sender->second;
+  
+  // The msg and its grid are not modified once they are in a slot or in the queue
+  boost::shared_ptr<SenderMessage> sender_message = boost::make_shared<SenderMessage>();
+  sender_message->msg = msg; // Only the pointer is copied, the msg itself is shared with the sender
+  sender_message->grid = grid;
+  sender_message->sender_index = sender_index;
+  
+  if (is_new_sender)
+  {
+    // If sender is not in list of known senders, then give it a slot in a new table of slots, 
+    // the worker thread may still be using the current one
+    boost::shared_ptr<SenderSlots> slots = boost::make_shared<SenderSlots>(*sender_slots);
+    slots->push_back(boost::make_shared<SenderSlot>());
+    slots->back()->latest = sender_message;
+    boost::atomic_store(&sender_slots, boost::shared_ptr<const SenderSlots>(slots));
+    sender_indices[msg->origin_node_name] = sender_index;
+  }
+  else
+  {
+    // Replace the cached message 
+    boost::atomic_store(&(*sender_slots)[sender_index]->latest, 
+                        boost::shared_ptr<const SenderMessage>(sender_message));
+  }
+  
+  // CS start
+  pthread_mutex_lock(&mutex_moa);
+  
+  // Queue the msg for evaluation, unless the queue is full
+  boost::shared_ptr<const SenderMessage> * queued_message = new boost::shared_ptr<const SenderMessage>(sender_message);
+  const bool is_queued = queue.push(queued_message);
+  if (is_queued)
+  {
+    // Signal that a new message is available
+    available_moa = true;
+    pthread_cond_signal(&cond_moa);
+  }
+  
+  // CS end
+  pthread_mutex_unlock(&mutex_moa);
+  
+  // The worker thread has fallen behind by a whole queue; the msg is dropped rather than waited for, since waiting 
+  // would block the thread calling this callback (in a nodelet manager, also the callbacks of other nodelets), and 
+  // the subscriber queue would then drop msgs instead. The msg is still the latest one of its sender above.
+  if (!is_queued)
+  {
+    delete queued_message;
+    ++nr_dropped_messages;
+#ifdef NODELET
+    NODELET_WARN_THROTTLE(1.0, "The queue of msgs to evaluate is full, %lu msgs have been dropped so far", 
+                          nr_dropped_messages);
+#endif
+#ifdef NODE
+    ROS_WARN_THROTTLE(1.0, "The queue of msgs to evaluate is full, %lu msgs have been dropped so far", 
+                      nr_dropped_messages);
+#endif
+  }
+  
+  /*
+   * Now, the slots of the senders are up-to-date, and the newly arrived msg is queued.
+   * The mutex is only needed for waiting and signalling, and is only taken once per msg by this callback and once per 
+   * batch by the worker thread. The queue is lock-free and the slots are read and written with atomic operations: 
+   * the worker thread takes a batch of queued msgs, loads the latest msg of every sender once, as a consistent 
+   * snapshot, and then evaluates the msgs of the batch against that snapshot in parallel without taking any lock.
+   * The results are published by the worker thread afterwards, in the order in which the msgs of the batch arrived.
+   * This allows the cache of msgs to be updated even if the worker thread is currently doing some evaluation.
+   * Every queued msg is evaluated; a msg is only dropped, and counted, if the queue is full, which is sized using 
+   * queue_size.
+   * 
+   * When the sender is a nodelet in the same manager as this nodelet, then the msgs are received without being 
+   * serialized, and the cached ConstPtrs point to the very msgs that the sender published.
+   */
+}
+
+
+
+/* WORKER THREAD */
+#ifdef NODELET
+void * MovingObjectsConfidenceEnhancerNodelet::moaHandlerBody(void * enhancer)
+{
+  static_cast<MovingObjectsConfidenceEnhancerNodelet *>(enhancer)->handleMovingObjectArrays();
+  return NULL;
+}
+
+void MovingObjectsConfidenceEnhancerNodelet::handleMovingObjectArrays()
+#endif
+#ifdef NODE
+void * MovingObjectsConfidenceEnhancerNode::moaHandlerBody(void * enhancer)
+{
+  static_cast<MovingObjectsConfidenceEnhancerNode *>(enhancer)->handleMovingObjectArrays();
+  return NULL;
+}
+
+void MovingObjectsConfidenceEnhancerNode::handleMovingObjectArrays()
+#endif
+{
+  const unsigned int capacity = queue.getCapacity();
+  
+  // Spin
+  while (true)
+  {
+    // CS start - wait for a message to arrive
+    pthread_mutex_lock(&mutex_moa);
+    // Wait for message to be available
+    while (!available_moa && !stop_moa_handler)
+    {
+      pthread_cond_wait(&cond_moa, &mutex_moa);
+    }
+    // Exit?
+    if (stop_moa_handler)
+    {
+      pthread_mutex_unlock(&mutex_moa);
+      break;
+    }
+    // The queue is emptied below, messages queued after this point make the callback set the flag again
+    available_moa = false;
+    
+    // CS end
+    pthread_mutex_unlock(&mutex_moa);
+    
+    // Take the queued messages in batches, until the queue is empty
+    while (true)
+    {
+      batch.clear();
+      void * queued_message;
+      while (batch.size() < capacity && (queued_message = queue.pop()) != NULL)
+      {
+        batch.push_back(static_cast<boost::shared_ptr<const SenderMessage> *>(queued_message));
+      }
+      if (batch.empty())
+      {
+        break;
+      }
+      
+      // Snapshot of the latest message of every sender, which will not be modified while the batch is evaluated
+      const boost::shared_ptr<const SenderSlots> slots = boost::atomic_load(&sender_slots);
+      const unsigned int nr_senders = slots->size();
+      snapshot.resize(nr_senders);
+      for (unsigned int i=0; i<nr_senders; ++i)
+      {
+        snapshot[i] = boost::atomic_load(&(*slots)[i]->latest);
+      }
+      
+      // Evaluate the messages of the batch in parallel, each one in a workspace of its own
+      evaluation_pool.run(evaluateTask, this, batch.size());
+      
+      // Publish the results in the order in which the messages were received, and release the queued messages
+      const unsigned int nr_batch_messages = batch.size();
+      for (unsigned int i=0; i<nr_batch_messages; ++i)
+      {
+        publishEvaluation(**batch[i], &workspaces[i]);
+        delete batch[i];
+      }
+    }
+  }
+}
+
+
+
+/* TASK OF THE EVALUATION THREADS */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::evaluateTask(void * enhancer, const unsigned int index)
+{
+  MovingObjectsConfidenceEnhancerNodelet * self = static_cast<MovingObjectsConfidenceEnhancerNodelet *>(enhancer);
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::evaluateTask(void * enhancer, const unsigned int index)
+{
+  MovingObjectsConfidenceEnhancerNode * self = static_cast<MovingObjectsConfidenceEnhancerNode *>(enhancer);
+#endif
+  self->evaluateMessage(**self->batch[index], &self->workspaces[index]);
+}
+
+
+
+/* INIT THE MARKERS OF A WORKSPACE */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::initWorkspace(EvaluationWorkspace * workspace)
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::initWorkspace(EvaluationWorkspace * workspace)
+#endif
+{
+  if (publish_objects_closest_points_markers)
+  {
+    workspace->msg_objects_closest_point_markers = boost::make_shared<sensor_msgs::LaserScan>();
+    workspace->msg_objects_closest_point_markers->angle_min = -M_PI;
+    workspace->msg_objects_closest_point_markers->angle_max = M_PI;
+    workspace->msg_objects_closest_point_markers->angle_increment = resolution;
+    workspace->msg_objects_closest_point_markers->time_increment = 0.0;
+    workspace->msg_objects_closest_point_markers->scan_time = 0.0;
+    workspace->msg_objects_closest_point_markers->range_min = range_min;
+    workspace->msg_objects_closest_point_markers->range_max = range_max;
+    workspace->msg_objects_closest_point_markers->intensities.resize(points);
+    workspace->msg_objects_closest_point_markers->ranges.resize(points);
+    for (unsigned int i=0; i<points; ++i)
+    {
+      workspace->msg_objects_closest_point_markers->ranges[i] = out_of_range;
+      workspace->msg_objects_closest_point_markers->intensities[i] = 0.0;
+    }
+  }
+  if (publish_objects_velocity_arrows)
+  {
+    workspace->msg_objects_velocity_arrow.ns = "fused_velocity_arrow";
+    workspace->msg_objects_velocity_arrow.type = visualization_msgs::Marker::ARROW;
+    workspace->msg_objects_velocity_arrow.action = visualization_msgs::Marker::ADD;
+    //       workspace->msg_objects_velocity_arrow.pose.position.x = 0.0;
+    //       workspace->msg_objects_velocity_arrow.pose.position.y = 0.0;
+    //       workspace->msg_objects_velocity_arrow.pose.position.z = 0.0;
+    //       workspace->msg_objects_velocity_arrow.pose.orientation.x = 0.0;
+    //       workspace->msg_objects_velocity_arrow.pose.orientation.y = 0.0;
+    //       workspace->msg_objects_velocity_arrow.pose.orientation.z = 0.0;
+    workspace->msg_objects_velocity_arrow.pose.orientation.w = 1.0;
+    workspace->msg_objects_velocity_arrow.scale.x = 0.05; // shaft diameter
+    workspace->msg_objects_velocity_arrow.scale.y = 0.1;  // arrow head diameter
+    //       workspace->msg_objects_velocity_arrow.scale.z = 0.0;
+    //       workspace->msg_objects_velocity_arrow.color.r = 0.0;
+    //       workspace->msg_objects_velocity_arrow.color.g = 0.0;
+    //       workspace->msg_objects_velocity_arrow.color.b = 0.0;
+    workspace->msg_objects_velocity_arrow.color.a = 1.0;
+    workspace->msg_objects_velocity_arrow.lifetime = ros::Duration(0.4);
+    workspace->msg_objects_velocity_arrow.frame_locked = true;
+    workspace->msg_objects_velocity_arrow.points.resize(2);
+    workspace->msg_objects_velocity_arrow.points[0].z = 0.0;
+    workspace->msg_objects_velocity_arrow.points[1].z = 0.0;
+  }
+}
+
+
+
+/* EVALUATE A MESSAGE AGAINST THE SNAPSHOT OF THE MESSAGES OF THE OTHER SENDERS */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::evaluateMessage(const SenderMessage & message, EvaluationWorkspace * workspace)
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::evaluateMessage(const SenderMessage & message, EvaluationWorkspace * workspace)
+#endif
+{
+  const double threshold_max_delta_position_line_squared = threshold_max_delta_position * 
+                                                           threshold_max_delta_position;
+  const double threshold_max_delta_velocity_squared = threshold_max_delta_velocity * threshold_max_delta_velocity;
+  
+  // Local message pointers, the snapshot is shared by the evaluations of the batch
+  const find_moving_objects::MovingObjectArray::ConstPtr & msg_sender = message.msg;
+  const unsigned int sender_index = message.sender_index;
+  const unsigned int nr_senders = snapshot.size();
+  find_moving_objects::MovingObjectArray::ConstPtr msg_other;
+  boost::shared_ptr<const ObjectGrid> grid_other;
+  
+  // Buffer of this evaluation, and its result
+  std::vector<unsigned int> & candidates = workspace->candidates;
+  workspace->moa.reset();
+  
+  /* msg_sender points to the msg to evaluate, which comes from the sender with index sender_index */
+  
+  if (print_received_objects)
+  {
+    std::ostringstream stream;
+    stream << "Received moving objects from " << msg_sender->origin_node_name \
+           << " (sender " << sender_index+1 << "/" << nr_senders << "):" << std::endl \
+           << *msg_sender << std::endl;
+    std::string string = stream.str();
+#ifdef NODELET
+    NODELET_DEBUG("%s", string.c_str());
+#endif
+#ifdef NODE
+    ROS_DEBUG("%s", string.c_str());
+#endif
+  }
+  
+  // Look at each object and see if we can find an appropriate object in the snapshot of each other sender
+  // Make sure there are objects in the received msg
+  const unsigned int nr_sender_objects = msg_sender->objects.size();
+  if (0 < nr_sender_objects)
+  {
+    // Init output msg, a new one for each received msg since it is not modified after it has been published
+    const find_moving_objects::MovingObjectArray::Ptr moa = 
+      boost::make_shared<find_moving_objects::MovingObjectArray>();
+    moa->objects.reserve(nr_sender_objects);
+    moa->origin_node_name = node_name;
+    
+    /* 
+     * Only send objects included in the current msg!
+     * Any other object should already have been reported!
+     */
+    
+    // Sender stamp
+    const double sender_stamp = msg_sender->objects[0].header.stamp.toSec();
+    
+    // Loop over each object in the incoming msg
+    unsigned int nr_objects = 0; // Count of objects to send
+    for (unsigned int j=0; j<nr_sender_objects; ++j)
+    {
+      // Local pointer to the jth sender object
+      const find_moving_objects::MovingObject * sender_mo = & (msg_sender->objects[j]);
+      
+      // Keep track of how many other senders have a matching object and the sum of the confidences
+      unsigned int nr_matching_senders = 0;
+      double confidence_sum = 0.0;
+      
+      // Loop over each sender
+      for (unsigned int i=0; i<nr_senders; ++i)
+      {
+        // Make sure we are not looking at our own sender/message
+        if (i != sender_index)
+        {
+          // Point to the other message in the snapshot
+          msg_other = snapshot[i]->msg;
+          grid_other = snapshot[i]->grid;
+          
+          // Get number of objects reported by the other sender
+          const unsigned int nr_other_objects = msg_other->objects.size();
+
+          // Make sure there are objects in the other msg
+          if (0 < nr_other_objects)
+          {
+            // Other stamp
+            const double other_stamp = msg_other->objects[0].header.stamp.toSec();
+            
+            // Compare stamps to see if objects occur with low enough difference in time
+            if (fabs(sender_stamp - other_stamp) < threshold_max_delta_time_for_different_sources)
+            {                
+              // Candidates for a corresponding object, the objects that are close enough in the XY plane
+              candidates.clear();
+              if (grid_other)
+              {
+                grid_other->query(sender_mo->position_in_map_frame.x, sender_mo->position_in_map_frame.y, 
+                                  &candidates);
+              }
+              else
+              {
+                for (unsigned int k=0; k<nr_other_objects; ++k)
+                {
+                  candidates.push_back(k);
+                }
+              }
+              
+              // Loop over the candidates to find the first corresponding one
+              const unsigned int nr_candidates = candidates.size();
+              unsigned int k_match = nr_other_objects;
+              for (unsigned int c=0; c<nr_candidates; ++c)
+              {
+                // Local pointer to the kth sender object, unless an earlier one already matches
+                const unsigned int k = candidates[c];
+                if (k_match <= k)
+                {
+                  continue;
+                }
+                const find_moving_objects::MovingObject * other_mo = & (msg_other->objects[k]);
+                
+                // Compare position and velocity in global frame (assume this frame is the same for all sources)
+                const double dx = sender_mo->position_in_map_frame.x - other_mo->position_in_map_frame.x;
+                const double dy = sender_mo->position_in_map_frame.y - other_mo->position_in_map_frame.y;
+                const double dz = ignore_z_map_coordinate_for_position ?
+                                  0.0 :
+                                  sender_mo->position_in_map_frame.z - other_mo->position_in_map_frame.z;
+                const double dp2 = dx*dx + dy*dy + dz*dz;
+                
+                const double dvx = sender_mo->velocity_in_map_frame.x - other_mo->velocity_in_map_frame.x;
+                const double dvy = sender_mo->velocity_in_map_frame.y - other_mo->velocity_in_map_frame.y;
+                const double dvz = sender_mo->velocity_in_map_frame.z - other_mo->velocity_in_map_frame.z;
+                const double dv2  = dvx*dvx + dvy*dvy + dvz*dvz;
+                
+//                   ROS_WARN_STREAM("dp2 = " << dp2 << "  (" << threshold_max_delta_position_line_squared << ")   dv2 = "
+//                      << dv2 << "  (" << threshold_max_delta_velocity_squared << ")");
+                
+                // Are the objects quite the same?
+                if (dp2 < threshold_max_delta_position_line_squared &&
+                    dv2 < threshold_max_delta_velocity_squared)
+                {
+                  k_match = k;
+                }
+              }
+              
+              // Adapt confidence accordingly
+              if (k_match < nr_other_objects)
+              {
+                // We found another sender that has a message sent within the given time threshold and with an
+                // object matching the current one
+                nr_matching_senders++;
+                confidence_sum += msg_other->objects[k_match].confidence;
+              }
+            }
+          }
+        }
+      }
+      
+#ifdef NODELET
+      NODELET_DEBUG_STREAM("Increasing confidence of object based on " << nr_matching_senders << " matching senders");
+#endif
+#ifdef NODE
+      ROS_DEBUG_STREAM("Increasing confidence of object based on " << nr_matching_senders << " matching senders");
+#endif
+      
+      // Update confidence of object for the object in the output msg
+      double confidence = sender_mo->confidence;
+      if (0 < nr_matching_senders)
+      {
+        confidence += confidence_sum / nr_matching_senders;
+        
+        // Put confidence inside [0,1]
+        confidence = MIN(1.0, confidence);
+        confidence = MAX(0.0, confidence);
+      }
+      
+      // Add object to output moa if confidence is high enough
+      if (threshold_min_confidence <= confidence)
+      {
+        moa->objects.push_back(*sender_mo);
+        nr_objects++;
+        moa->objects.back().confidence = confidence;
+      }
+    }
+          
+    // The moa msg is published by the worker thread, in the order in which the msgs were received
+    if (0 < nr_objects)
+    {
+      workspace->moa = moa;
+    }
+  }
+}
+
+
+
+/* PUBLISH THE RESULT OF AN EVALUATION, IN THE WORKER THREAD */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::publishEvaluation(const SenderMessage & message, 
+                                                               EvaluationWorkspace * workspace)
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::publishEvaluation(const SenderMessage & message, 
+                                                            EvaluationWorkspace * workspace)
+#endif
+{
+  // Do we have any objects?
+  if (!workspace->moa)
+  {
+    return;
+  }
+  const find_moving_objects::MovingObjectArray::ConstPtr & msg_sender = message.msg;
+  const find_moving_objects::MovingObjectArray::Ptr & moa = workspace->moa;
+  const unsigned int nr_objects = moa->objects.size();
+  
+  // Msgs of this evaluation
+  sensor_msgs::LaserScan::Ptr & msg_objects_closest_point_markers = workspace->msg_objects_closest_point_markers;
+  visualization_msgs::Marker & msg_objects_velocity_arrow = workspace->msg_objects_velocity_arrow;
+  
+  // Send moa msg
+  if (publish_objects)
+  {
+    pub_moaf.publish(moa);
+  }
+
+  // Publish closest point markers, unless no one subscribes to them
+  if (publish_objects_closest_points_markers && 0 < pub_objects_closest_point_markers.getNumSubscribers())
+  {
+    // Update sequence number and stamp
+    msg_objects_closest_point_markers->header.seq = ++closest_point_markers_seq;
+    msg_objects_closest_point_markers->header.stamp = moa->objects[0].header.stamp;
+    
+    // Use sensor frame
+    msg_objects_closest_point_markers->header.frame_id = moa->objects[0].header.frame_id;
+    
+    // Vector for remembering which range indices have been marked
+    std::vector<int> indices;
+    unsigned int nr_indices = 0;
+    for (unsigned int a=0; a<nr_objects; ++a)
+    {
+      // Calculate angle in sensor frame where object is to be found
+      double angle = moa->objects[a].angle_for_closest_distance; // Angle in [-PI,PI], hopefully
+      angle += M_PI; // Shift by PI with intention to start with 0 angle in the direction of the negative x axis
+      // Put angle in [0, 2PI) so that index can be calculated
+      if (angle < 0 || TWO_PI <= angle)
+      {
+        angle -= floor(angle / TWO_PI) * TWO_PI;
+      }
+      
+      // Calculate index
+      int index = angle * inverted_resolution;
+      
+      // Save range index
+      indices.push_back(index);
+      nr_indices++;
+      
+      // Mark closest point
+      msg_objects_closest_point_markers->ranges[index] = moa->objects[a].closest_distance;
+    }
+    
+    // Publish
+    pub_objects_closest_point_markers.publish(msg_objects_closest_point_markers);
+    
+    // Reset ranges, in a copy if the published msg is still held by a subscriber
+    if (!msg_objects_closest_point_markers.unique())
+    {
+      msg_objects_closest_point_markers = 
+        boost::make_shared<sensor_msgs::LaserScan>(*msg_objects_closest_point_markers);
+    }
+    for (unsigned k=0; k<nr_indices; ++k)
+    {
+      msg_objects_closest_point_markers->ranges[indices[k]] = out_of_range;
+    }
+  }
+  
+  // Publish velocity arrows, unless no one subscribes to them
+  if (publish_objects_velocity_arrows && 0 < pub_objects_velocity_arrows.getNumSubscribers())
+  {
+    msg_objects_velocity_arrow.header.seq = ++velocity_arrows_seq;
+    visualization_msgs::MarkerArray::Ptr msg_objects_velocity_arrows = 
+      boost::make_shared<visualization_msgs::MarkerArray>();
+    msg_objects_velocity_arrows->markers.reserve(nr_objects);
+    
+    for (unsigned int a=0; a<nr_objects; ++a)
+    {
+      msg_objects_velocity_arrow.header.stamp = moa->objects[a].header.stamp;
+      if (velocity_arrows_use_sensor_frame)
+      {
+        msg_objects_velocity_arrow.header.frame_id = moa->objects[a].header.frame_id;
+        msg_objects_velocity_arrow.points[0].x = moa->objects[a].position.x;
+        msg_objects_velocity_arrow.points[0].y = moa->objects[a].position.y;
+        msg_objects_velocity_arrow.points[1].x = moa->objects[a].position.x + moa->objects[a].velocity.x;
+        msg_objects_velocity_arrow.points[1].y = moa->objects[a].position.y + moa->objects[a].velocity.y;
+      }
+      else if (velocity_arrows_use_base_frame)
+      {
+        msg_objects_velocity_arrow.header.frame_id = moa->objects[a].base_frame;
+        msg_objects_velocity_arrow.points[0].x = moa->objects[a].position_in_base_frame.x;
+        msg_objects_velocity_arrow.points[0].y = moa->objects[a].position_in_base_frame.y;
+        msg_objects_velocity_arrow.points[1].x = moa->objects[a].position_in_base_frame.x + 
+                                                 moa->objects[a].velocity_in_base_frame.x;
+        msg_objects_velocity_arrow.points[1].y = moa->objects[a].position_in_base_frame.y + 
+                                                 moa->objects[a].velocity_in_base_frame.y;
+      }
+      else if (velocity_arrows_use_fixed_frame)
+      {
+        msg_objects_velocity_arrow.header.frame_id = moa->objects[a].fixed_frame;
+        msg_objects_velocity_arrow.points[0].x = moa->objects[a].position_in_fixed_frame.x;
+        msg_objects_velocity_arrow.points[0].y = moa->objects[a].position_in_fixed_frame.y;
+        msg_objects_velocity_arrow.points[1].x = moa->objects[a].position_in_fixed_frame.x + 
+                                                 moa->objects[a].velocity_in_fixed_frame.x;
+        msg_objects_velocity_arrow.points[1].y = moa->objects[a].position_in_fixed_frame.y + 
+                                                moa->objects[a].velocity_in_fixed_frame.y;
+      }
+      else // map frame
+      {
+        msg_objects_velocity_arrow.header.frame_id = moa->objects[a].map_frame;
+        msg_objects_velocity_arrow.points[0].x = moa->objects[a].position_in_map_frame.x;
+        msg_objects_velocity_arrow.points[0].y = moa->objects[a].position_in_map_frame.y;
+        msg_objects_velocity_arrow.points[1].x = moa->objects[a].position_in_map_frame.x + 
+                                                 moa->objects[a].velocity_in_map_frame.x;
+        msg_objects_velocity_arrow.points[1].y = moa->objects[a].position_in_map_frame.y + 
+                                                 moa->objects[a].velocity_in_map_frame.y;
+      }
+      msg_objects_velocity_arrow.id = a;
+      
+      // Color of the arrow represents the confidence black=low, white=high
+      float adapted_confidence = moa->objects[a].confidence;
+      if (velocity_arrows_use_full_gray_scale && threshold_min_confidence < 1)
+      {
+        adapted_confidence = (moa->objects[a].confidence - threshold_min_confidence) / 
+                             (1 - threshold_min_confidence);
+      }
+      msg_objects_velocity_arrow.color.r = adapted_confidence;
+      msg_objects_velocity_arrow.color.g = adapted_confidence;
+      msg_objects_velocity_arrow.color.b = adapted_confidence;
+      
+      // Add to array of markers
+      msg_objects_velocity_arrows->markers.push_back(msg_objects_velocity_arrow);
+      
+      // Update namespace of velocity arrow
+      msg_objects_velocity_arrows->markers[a].ns.append(msg_sender->origin_node_name);
+    }
+    
+    // Publish the msg
+    pub_objects_velocity_arrows.publish(msg_objects_velocity_arrows);
+  }
+  
+  // Here, the moa msg is released unless a subscriber still holds it
+  workspace->moa.reset();
+}
+
+
+
+/* ENTRY POINT FOR NODELET AND INIT FOR NODE */
+#ifdef NODELET
+void MovingObjectsConfidenceEnhancerNodelet::onInit()
+{
+  // Node handles
+  nh = getNodeHandle();
+  nh_priv = getPrivateNodeHandle();
+  node_name = getName();
+#endif
+#ifdef NODE
+void MovingObjectsConfidenceEnhancerNode::onInit()
+{
+  // Node handles
+  nh = ros::NodeHandle();
+  nh_priv = ros::NodeHandle("~");
+  node_name = ros::this_node::getName();
+#endif
+  
+  // Read parameters
+  bool velocity_arrows_use_sensor_frame_param;
+  bool velocity_arrows_use_base_frame_param;
+  bool velocity_arrows_use_fixed_frame_param;
+  std::string topic_moving_objects_enhanced;
+  std::string topic_objects_velocity_arrows;
+  std::string topic_objects_closest_points_markers;
+  int publish_buffer_size;
+  nh_priv.param("subscribe_topic", subscribe_topic, default_subscribe_topic);
+  nh_priv.param("subscribe_buffer_size", subscribe_buffer_size, default_subscribe_buffer_size);
+  nh_priv.param("verbose", verbose, default_verbose);
+  nh_priv.param("print_received_objects", print_received_objects, default_print_received_objects);
+  nh_priv.param("publish_objects", publish_objects, default_publish_objects);
+  nh_priv.param("publish_objects_closest_points_markers", publish_objects_closest_points_markers, default_publish_objects_closest_points_markers);
+  nh_priv.param("publish_objects_velocity_arrows", publish_objects_velocity_arrows, default_publish_objects_velocity_arrows);
+  nh_priv.param("velocity_arrows_use_full_gray_scale", velocity_arrows_use_full_gray_scale, default_velocity_arrows_use_full_gray_scale);
+  nh_priv.param("velocity_arrows_use_sensor_frame", velocity_arrows_use_sensor_frame_param, default_velocity_arrows_use_sensor_frame);
+  nh_priv.param("velocity_arrows_use_base_frame", velocity_arrows_use_base_frame_param, default_velocity_arrows_use_base_frame);
+  nh_priv.param("velocity_arrows_use_fixed_frame", velocity_arrows_use_fixed_frame_param, default_velocity_arrows_use_fixed_frame);
+  nh_priv.param("threshold_min_confidence", threshold_min_confidence, default_threshold_min_confidence);
+  nh_priv.param("threshold_max_delta_time_for_different_sources", threshold_max_delta_time_for_different_sources, default_threshold_max_delta_time_for_different_sources);
+  nh_priv.param("threshold_max_delta_position", threshold_max_delta_position, default_threshold_max_delta_position);
+  nh_priv.param("threshold_max_delta_velocity", threshold_max_delta_velocity, default_threshold_max_delta_velocity);
+  nh_priv.param("ignore_z_map_coordinate_for_position", ignore_z_map_coordinate_for_position, default_ignore_z_map_coordinate_for_position);
+  nh_priv.param("topic_moving_objects_enhanced", topic_moving_objects_enhanced, default_topic_moving_objects_enhanced);
+  nh_priv.param("topic_objects_velocity_arrows", topic_objects_velocity_arrows, default_topic_objects_velocity_arrows);
+  nh_priv.param("topic_objects_closest_points_markers", topic_objects_closest_points_markers, default_topic_objects_closest_points_markers);
+  nh_priv.param("publish_buffer_size", publish_buffer_size, default_publish_buffer_size);
+  nh_priv.param("queue_size", queue_size, default_queue_size);
+  nh_priv.param("nr_threads", nr_threads, default_nr_threads);
+  
+  // Only one frame is used for the velocity arrows
+  velocity_arrows_use_sensor_frame = false;
+  velocity_arrows_use_base_frame = false;
+  velocity_arrows_use_fixed_frame = false;
+  if      (velocity_arrows_use_sensor_frame_param)
+    velocity_arrows_use_sensor_frame = true;
+  else if (velocity_arrows_use_base_frame_param)
+    velocity_arrows_use_base_frame = true;
+  else if (velocity_arrows_use_fixed_frame_param)
+    velocity_arrows_use_fixed_frame = true;
+  
+  // Init publishers
+  pub_moaf = nh.advertise<find_moving_objects::MovingObjectArray>(topic_moving_objects_enhanced,
+                                                                  publish_buffer_size);
+  pub_objects_velocity_arrows = nh.advertise<visualization_msgs::MarkerArray>(topic_objects_velocity_arrows,
+                                                                              publish_buffer_size);
+  pub_objects_closest_point_markers = nh.advertise<sensor_msgs::LaserScan>(topic_objects_closest_points_markers,
+                                                                           publish_buffer_size);
+  
+  // Queue of received msgs and one workspace per msg of a batch
+  if (queue.init(std::max(1, queue_size)) != 0)
+  {
+#ifdef NODELET
+    NODELET_ERROR("Failed to create the queue of MovingObjectArray messages");
+#endif
+#ifdef NODE
+    ROS_ERROR("Failed to create the queue of MovingObjectArray messages");
+#endif
+    ROS_BREAK();
+  }
+  const unsigned int capacity = queue.getCapacity();
+  batch.reserve(capacity);
+  workspaces.resize(capacity);
+  for (unsigned int i=0; i<capacity; ++i)
+  {
+    initWorkspace(&workspaces[i]);
+  }
+  
+  // Threads evaluating the msgs of a batch, the worker thread being one of them
+  int nr_evaluation_threads = 0 < nr_threads ? nr_threads : std::max(1, (int) sysconf(_SC_NPROCESSORS_ONLN));
+  nr_evaluation_threads = std::min(nr_evaluation_threads, (int) capacity);
+  if (evaluation_pool.start(nr_evaluation_threads) != 0)
+  {
+#ifdef NODELET
+    NODELET_WARN("Could not start all threads, the messages are evaluated by %u threads", 
+                 evaluation_pool.getNrThreads());
+#endif
+#ifdef NODE
+    ROS_WARN("Could not start all threads, the messages are evaluated by %u threads", 
+             evaluation_pool.getNrThreads());
+#endif
+  }
+  
+  // MovingObjectArray handler thread
+  if (pthread_create(&moa_handler, NULL, moaHandlerBody, this))
+  {
+#ifdef NODELET
+    NODELET_ERROR("Failed to create thread for handling MovingObjectArray messages");
+#endif
+#ifdef NODE
+    ROS_ERROR("Failed to create thread for handling MovingObjectArray messages");
+#endif
+    ROS_BREAK();
+  }
+  moa_handler_is_started = true;
+  
+  // Subscribe to interpreter results
+  sub = nh.subscribe(subscribe_topic, 
+                     subscribe_buffer_size, 
+#ifdef NODELET
+                     &MovingObjectsConfidenceEnhancerNodelet::moaCallback,
+#endif
+#ifdef NODE
+                     &MovingObjectsConfidenceEnhancerNode::moaCallback,
+#endif
+                     this);
+}
+
+} // namespace find_moving_objects
+
+
+
+#ifdef NODE
+using namespace find_moving_objects;
+
+/* ENTRY POINT */
+int main(int argc, char** argv)
+{  
+  // Init ROS
+  ros::init(argc, argv, "mo_confidence_enhancer", ros::init_options::AnonymousName);
+  
+  // Create and init node object
+  MovingObjectsConfidenceEnhancerNode enhancer;
+  
+  // Start main ROS loop
+  ros::spin();
+  
+  return 0;
+}
+#endif